@@ -0,0 +1,11 @@
+# writes OUTPUT, a header defining OK_BUILD_ID as a hash of every source under SOURCE_DIR. the image cache mixes it into
+# its keys, so an image cached by one build is never run by another
+file(GLOB_RECURSE sources ${SOURCE_DIR}/*.cpp ${SOURCE_DIR}/*.hpp)
+list(SORT sources)
+set(hashes "")
+foreach(source IN LISTS sources)
+  file(SHA256 ${source} hash)
+  string(APPEND hashes ${hash})
+endforeach()
+string(SHA256 build_id "${hashes}")
+file(WRITE ${OUTPUT} "#define OK_BUILD_ID \"${build_id}\"\n")
@@ -0,0 +1,17 @@
+# cmake -DINTERPRETER=<okc> -DEXECUTABLE=<built script> -DSCRIPT=<script.ok> -P compare_output.cmake
+# fails unless the executable okc --emit-c built from the script prints and exits as the interpreter running it does
+execute_process(COMMAND ${INTERPRETER} ${SCRIPT}
+    OUTPUT_VARIABLE expected_output
+    ERROR_VARIABLE expected_error
+    RESULT_VARIABLE expected_result
+)
+execute_process(COMMAND ${EXECUTABLE}
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error
+    RESULT_VARIABLE result
+)
+if(NOT output STREQUAL expected_output OR NOT error STREQUAL expected_error OR NOT result STREQUAL expected_result)
+  message(FATAL_ERROR "${EXECUTABLE} does not match ${SCRIPT}\n"
+      "expected (exit ${expected_result}):\n${expected_output}${expected_error}\n"
+      "got (exit ${result}):\n${output}${error}")
+endif()
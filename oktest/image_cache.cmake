@@ -0,0 +1,43 @@
+# cmake -DINTERPRETER=<okc> -DSCRIPT=<script.ok> -DOTHER=<another script.ok> -DCACHE_DIR=<dir> -P image_cache.cmake
+# runs the script with OK_CACHE_DIR set through a miss, a hit and an image of the other script cached under its name,
+# which has to miss and be written again. it has to print what it prints without the cache every time
+file(REMOVE_RECURSE ${CACHE_DIR})
+unset(ENV{OK_CACHE_DIR})
+execute_process(COMMAND ${INTERPRETER} ${SCRIPT} OUTPUT_VARIABLE expected RESULT_VARIABLE expected_result)
+set(ENV{OK_CACHE_DIR} ${CACHE_DIR})
+
+function (run_cached what)
+  execute_process(COMMAND ${INTERPRETER} ${SCRIPT} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+  if(NOT output STREQUAL expected OR NOT result STREQUAL expected_result)
+    message(FATAL_ERROR "${what}: ${SCRIPT} exited with ${result} after printing\n${output}\n"
+        "instead of exiting with ${expected_result} after printing\n${expected}")
+  endif()
+  file(GLOB images ${CACHE_DIR}/*.okb)
+  list(LENGTH images count)
+  if(NOT count EQUAL 1)
+    message(FATAL_ERROR "${what}: expected one cached image, found ${count}")
+  endif()
+  set(image ${images} PARENT_SCOPE)
+endfunction()
+
+run_cached("miss")
+file(SHA256 ${image} written)
+file(TIMESTAMP ${image} written_at "%s")
+
+# a hit leaves the image alone, one written again is renamed over it at a later second
+execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 1.1)
+run_cached("hit")
+file(TIMESTAMP ${image} read_at "%s")
+if(NOT read_at STREQUAL written_at)
+  message(FATAL_ERROR "hit: the cached image was written again")
+endif()
+
+execute_process(COMMAND ${INTERPRETER} -c ${OTHER} -o ${image} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "invalidation: can't compile ${OTHER}")
+endif()
+run_cached("invalidation")
+file(SHA256 ${image} rewritten)
+if(NOT rewritten STREQUAL written)
+  message(FATAL_ERROR "invalidation: the image of ${OTHER} was not replaced")
+endif()
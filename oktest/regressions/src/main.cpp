@@ -23,12 +23,29 @@ struct run_result
   std::string std_err;
 };
 
-run_result run_oklang(const std::string_view path, const std::string_view okpath)
+run_result run_oklang(std::string_view path, const std::string_view okpath)
 {
   std::stringstream cmd;
   std::string stdout_file = "out.log";
   std::string stderr_file = "err.log";
-  cmd << "\"" << okpath << "\" " << "\"" << path << "\" > " << stdout_file << " 2> " << stderr_file;
+  const auto interpreter = [&]()
+  {
+    cmd << "\"" << okpath << "\" ";
+    // extra interpreter flags for running the suite under another configuration, e.g. OKTEST_FLAGS=--jit=1
+    if(const char* flags = std::getenv("OKTEST_FLAGS"); flags != nullptr)
+      cmd << flags << " ";
+  };
+  // OKTEST_COMPILE=1 compiles each script to an image with okc -c and runs the image instead, a compile error stops
+  // there and is what the test sees
+  const char* compile = std::getenv("OKTEST_COMPILE");
+  if(compile != nullptr && *compile != '\0' && std::filesystem::path{path}.extension() == ".ok")
+  {
+    interpreter();
+    cmd << "-c \"" << path << "\" -o image.okb > " << stdout_file << " 2> " << stderr_file << " && ";
+    path = "image.okb";
+  }
+  interpreter();
+  cmd << "\"" << path << "\" > " << stdout_file << " 2> " << stderr_file;
 
   std::string cmd_str = cmd.str();
   int ret = system(cmd_str.c_str());
@@ -112,11 +129,14 @@ int main(int argc, char** argv)
 
   for(auto& entry : std::filesystem::recursive_directory_iterator(tests_path))
   {
-    if(entry.path().extension() == ".ok")
+    // compiled images are binary, what they are expected to do is next to them in a .expect file
+    const auto compiled = entry.path().extension() == ".okb";
+    if(entry.path().extension() == ".ok" || compiled)
     {
       std::string test_path = entry.path();
 
-      auto tc = parse_test_file(test_path);
+      auto tc = parse_test_file(compiled ? std::filesystem::path{entry.path()}.replace_extension(".expect")
+                                         : entry.path());
       auto rr = run_oklang(test_path, okpath);
 
       if(tc.expected_error.has_value())
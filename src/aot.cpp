@@ -0,0 +1,27 @@
+#include "aot.hpp"
+#include "image.hpp"
+#include "vm.hpp"
+#include "vm_stack.hpp"
+#include <print>
+
+namespace ok
+{
+  int aot::run(std::span<const byte> p_image, std::span<const jit_code::native_type> p_natives)
+  {
+    ok::vm vm;
+    ok::vm_guard guard{&vm};
+    vm.init();
+    const auto functions = image::read(&vm, p_image);
+    if(functions.empty() || functions.size() != p_natives.size())
+    {
+      std::println(stderr, "corrupt script image");
+      return to_utype(vm::interpret_result::runtime_error);
+    }
+    for(size_t i = 0; i < functions.size(); ++i)
+    {
+      functions[i]->jitted = new jit_code;
+      functions[i]->jitted->native = p_natives[i];
+    }
+    return to_utype(vm.execute(functions.front()));
+  }
+} // namespace ok
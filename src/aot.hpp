@@ -0,0 +1,42 @@
+#ifndef OK_AOT_HPP
+#define OK_AOT_HPP
+
+#include "chunk.hpp"
+#include "jit.hpp"
+#include "value.hpp"
+#include <span>
+
+// what the c++ okc --emit-c writes is made of. each function it writes has the parameters of jit_code::native_type
+// named slots, top, constants, out_top and limit, and a label per instruction. leaving hands the instruction at p_at
+// to the interpreter with the stack as it is
+#define OK_AOT_LEAVE(p_at)                                                                                             \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    *out_top = top;                                                                                                    \
+    return p_at;                                                                                                       \
+  } while(false)
+#define OK_AOT_GUARD(p_condition, p_at)                                                                                \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if(!(p_condition))                                                                                                 \
+      OK_AOT_LEAVE(p_at);                                                                                              \
+  } while(false)
+#define OK_AOT_PUSH(p_value, p_at)                                                                                     \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    OK_AOT_GUARD(top < limit, p_at);                                                                                   \
+    *top++ = (p_value);                                                                                                \
+  } while(false)
+#define OK_AOT_NUMBERS(p_lhs, p_rhs) (OK_IS_VALUE_NUMBER(p_lhs) && OK_IS_VALUE_NUMBER(p_rhs))
+
+namespace ok
+{
+  struct aot
+  {
+    // reads the script back from p_image, gives function i p_natives[i] as its machine code and runs it. returns the
+    // vm::interpret_result as the exit code
+    static int run(std::span<const byte> p_image, std::span<const jit_code::native_type> p_natives);
+  };
+} // namespace ok
+
+#endif // OK_AOT_HPP
@@ -4,15 +4,43 @@
 #include "operator.hpp"
 #include "token.hpp"
 #include "utility.hpp"
-#include <list>
+#include <format>
 #include <memory>
+#include <memory_resource>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace ok::ast
 {
+  // nodes of a compilation are bump allocated from its arena and go away with it in one shot, destroying a node only
+  // runs its destructor
+  using arena = std::pmr::monotonic_buffer_resource;
+
+  struct node_deleter
+  {
+    template <typename T>
+    void operator()(T* p_node) const
+    {
+      std::destroy_at(p_node);
+    }
+  };
+
+  template <typename T>
+  using ptr = std::unique_ptr<T, node_deleter>;
+
+  // children are contiguous, in the same arena as their parent
+  template <typename T>
+  using list = std::pmr::vector<ptr<T>>;
+
+  template <typename T, typename... Args>
+  ptr<T> make(std::pmr::memory_resource* p_arena, Args&&... p_args)
+  {
+    return ptr<T>{new(p_arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(p_args)...)};
+  }
+
   // TODO: statements
   enum class node_type
   {
@@ -83,12 +111,12 @@ namespace ok::ast
       return m_type;
     }
 
-    inline std::string token_literal() const
+    inline std::string_view token_literal() const
     {
       return m_token.raw_literal;
     }
 
-    inline token get_token() const
+    inline const token& get_token() const
     {
       return m_token;
     }
@@ -238,7 +266,7 @@ namespace ok::ast
   class program : public node
   {
   public:
-    program(std::list<std::unique_ptr<statement>>&& p_statements)
+    program(list<statement>&& p_statements)
         : node(node_type::nt_program, p_statements.empty() ? token{} : p_statements.front()->get_token()),
           m_statements(std::move(p_statements))
     {
@@ -256,13 +284,18 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::list<std::unique_ptr<statement>>& get_statements() const
+    const list<statement>& get_statements() const
+    {
+      return m_statements;
+    }
+
+    list<statement>& get_statements()
     {
       return m_statements;
     }
 
   private:
-    std::list<std::unique_ptr<statement>> m_statements;
+    list<statement> m_statements;
   };
 
   /**
@@ -272,7 +305,7 @@ namespace ok::ast
   class binding : public node
   {
   public:
-    binding(token p_tok, const std::string& p_name, binding_modifier p_modifiers = binding_modifier::bm_none)
+    binding(token p_tok, std::string_view p_name, binding_modifier p_modifiers = binding_modifier::bm_none)
         : node(node_type::nt_binding, p_tok), m_name(p_name), m_modifiers(p_modifiers)
     {
     }
@@ -304,7 +337,7 @@ namespace ok::ast
   class identifier_expression : public expression
   {
   public:
-    identifier_expression(token p_tok, const std::string& p_value)
+    identifier_expression(token p_tok, std::string_view p_value)
         : expression(node_type::nt_identifier_expr, p_tok), m_value(p_value)
     {
     }
@@ -344,7 +377,7 @@ namespace ok::ast
 
     std::string to_string() override
     {
-      return m_token.raw_literal;
+      return m_token.raw_literal.empty() ? std::format("{}", m_value) : std::string{m_token.raw_literal};
     }
 
     double get_value() const
@@ -359,7 +392,7 @@ namespace ok::ast
   class string_expression : public expression
   {
   public:
-    string_expression(token p_tok, const std::string& p_value)
+    string_expression(token p_tok, std::string_view p_value)
         : expression(node_type::nt_string_expr, p_tok), m_value(p_value)
     {
     }
@@ -392,7 +425,7 @@ namespace ok::ast
 
     std::string to_string() override
     {
-      return m_token.raw_literal;
+      return std::string{m_token.raw_literal};
     }
 
     bool get_value() const
@@ -420,7 +453,7 @@ namespace ok::ast
   class prefix_unary_expression : public expression
   {
   public:
-    prefix_unary_expression(token p_tok, const operator_type& p_operator, std::unique_ptr<expression> p_right)
+    prefix_unary_expression(token p_tok, const operator_type& p_operator, ptr<expression> p_right)
         : expression(node_type::nt_prefix_expr, p_tok), m_operator(validate_unary_prefix_operator(p_operator)),
           m_right(std::move(p_right))
     {
@@ -433,7 +466,12 @@ namespace ok::ast
       return ss.str();
     }
 
-    inline const std::unique_ptr<expression>& get_right() const
+    inline const ptr<expression>& get_right() const
+    {
+      return m_right;
+    }
+
+    inline ptr<expression>& get_right()
     {
       return m_right;
     }
@@ -445,7 +483,7 @@ namespace ok::ast
 
   private:
     operator_type m_operator;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_right;
 
   private:
     static inline operator_type validate_unary_prefix_operator(operator_type p_op)
@@ -469,7 +507,7 @@ namespace ok::ast
   class postfix_unary_expression : public expression
   {
   public:
-    postfix_unary_expression(token p_tok, const operator_type p_operator, std::unique_ptr<expression> p_left)
+    postfix_unary_expression(token p_tok, const operator_type p_operator, ptr<expression> p_left)
         : expression(node_type::nt_postfix_unary_expr, p_tok), m_operator(validate_unary_postfix_operator(p_operator)),
           m_left(std::move(p_left))
     {
@@ -482,7 +520,7 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_left() const
+    const ptr<expression>& get_left() const
     {
       return m_left;
     }
@@ -494,7 +532,7 @@ namespace ok::ast
 
   private:
     operator_type m_operator;
-    std::unique_ptr<expression> m_left;
+    ptr<expression> m_left;
 
   private:
     static inline operator_type validate_unary_postfix_operator(operator_type p_op)
@@ -516,8 +554,8 @@ namespace ok::ast
   public:
     infix_binary_expression(token p_tok,
                             const operator_type p_operator,
-                            std::unique_ptr<expression> p_left,
-                            std::unique_ptr<expression> p_right)
+                            ptr<expression> p_left,
+                            ptr<expression> p_right)
         : expression(node_type::nt_infix_binary_expr, p_tok), m_operator(p_operator), m_left(std::move(p_left)),
           m_right(std::move(p_right))
     {
@@ -530,12 +568,22 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_left() const
+    const ptr<expression>& get_left() const
     {
       return m_left;
     }
 
-    const std::unique_ptr<expression>& get_right() const
+    ptr<expression>& get_left()
+    {
+      return m_left;
+    }
+
+    const ptr<expression>& get_right() const
+    {
+      return m_right;
+    }
+
+    ptr<expression>& get_right()
     {
       return m_right;
     }
@@ -547,8 +595,8 @@ namespace ok::ast
 
   private:
     operator_type m_operator;
-    std::unique_ptr<expression> m_left;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_left;
+    ptr<expression> m_right;
 
   private:
     static inline operator_type validate_binary_infix_operator(operator_type p_op)
@@ -577,10 +625,7 @@ namespace ok::ast
   class assign_expression : public expression
   {
   public:
-    assign_expression(token p_tok,
-                      operator_type p_assign_type,
-                      std::unique_ptr<expression> p_left,
-                      std::unique_ptr<expression> p_right)
+    assign_expression(token p_tok, operator_type p_assign_type, ptr<expression> p_left, ptr<expression> p_right)
         : expression(node_type::nt_assign_expr, p_tok), m_left(std::move(p_left)), m_right(std::move(p_right))
     {
     }
@@ -592,25 +637,32 @@ namespace ok::ast
       return ss.str();
     }
 
-    std::unique_ptr<expression>& get_left()
+    const ptr<expression>& get_left() const
+    {
+      return m_left;
+    }
+
+    ptr<expression>& get_left()
     {
       return m_left;
     }
 
-    std::unique_ptr<expression>& get_right()
+    const ptr<expression>& get_right() const
+    {
+      return m_right;
+    }
+
+    ptr<expression>& get_right()
     {
       return m_right;
     }
 
   private:
-    std::unique_ptr<expression> m_left;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_left;
+    ptr<expression> m_right;
 
   protected:
-    assign_expression(node_type p_nt,
-                      token p_tok,
-                      std::unique_ptr<expression> p_left,
-                      std::unique_ptr<expression> p_right)
+    assign_expression(node_type p_nt, token p_tok, ptr<expression> p_left, ptr<expression> p_right)
         : expression(p_nt, p_tok), m_left(std::move(p_left)), m_right(std::move(p_right))
     {
     }
@@ -621,8 +673,8 @@ namespace ok::ast
   public:
     compound_assign_expression(token p_tok,
                                operator_type p_assign_type,
-                               std::unique_ptr<expression> p_left,
-                               std::unique_ptr<expression> p_right)
+                               ptr<expression> p_left,
+                               ptr<expression> p_right)
         : assign_expression(node_type::nt_compound_assign_expr, p_tok, std::move(p_left), std::move(p_right))
     {
     }
@@ -659,7 +711,7 @@ namespace ok::ast
   class call_expression : public expression
   {
   public:
-    call_expression(token p_tok, std::unique_ptr<expression> p_fun, std::list<std::unique_ptr<expression>>&& p_args)
+    call_expression(token p_tok, ptr<expression> p_fun, list<expression>&& p_args)
         : expression(node_type::nt_call_expr, p_tok), m_function(std::move(p_fun)), m_arguments(std::move(p_args))
     {
     }
@@ -678,28 +730,35 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_callable() const
+    const ptr<expression>& get_callable() const
     {
       return m_function;
     }
 
-    const std::list<std::unique_ptr<expression>>& get_arguments() const
+    ptr<expression>& get_callable()
+    {
+      return m_function;
+    }
+
+    const list<expression>& get_arguments() const
+    {
+      return m_arguments;
+    }
+
+    list<expression>& get_arguments()
     {
       return m_arguments;
     }
 
   private:
-    std::unique_ptr<expression> m_function;
-    std::list<std::unique_ptr<expression>> m_arguments;
+    ptr<expression> m_function;
+    list<expression> m_arguments;
   };
 
   class conditional_expression : public expression
   {
   public:
-    conditional_expression(token p_tok,
-                           std::unique_ptr<expression> p_expr,
-                           std::unique_ptr<expression> p_left,
-                           std::unique_ptr<expression> p_right)
+    conditional_expression(token p_tok, ptr<expression> p_expr, ptr<expression> p_left, ptr<expression> p_right)
         : expression(node_type::nt_conditional_expr, p_tok), m_expression(std::move(p_expr)), m_left(std::move(p_left)),
           m_right(std::move(p_right))
     {
@@ -713,15 +772,15 @@ namespace ok::ast
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
-    std::unique_ptr<expression> m_left;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_expression;
+    ptr<expression> m_left;
+    ptr<expression> m_right;
   };
 
   class operator_expression : public expression
   {
   public:
-    operator_expression(token p_tok, std::unique_ptr<expression> p_left, std::unique_ptr<expression> p_right)
+    operator_expression(token p_tok, ptr<expression> p_left, ptr<expression> p_right)
         : expression(node_type::nt_operator_expr, p_tok), m_left(std::move(p_left)), m_right(std::move(p_right))
     {
     }
@@ -734,17 +793,17 @@ namespace ok::ast
     }
 
   private:
-    std::unique_ptr<expression> m_left;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_left;
+    ptr<expression> m_right;
   };
 
   class access_expression : public expression
   {
   public:
     access_expression(token p_tok,
-                      std::unique_ptr<expression> p_target,
-                      std::unique_ptr<identifier_expression> p_property,
-                      std::list<std::unique_ptr<expression>>&& p_args = {},
+                      ptr<expression> p_target,
+                      ptr<identifier_expression> p_property,
+                      list<expression>&& p_args = {},
                       bool p_is_invoke = false)
         : expression(node_type::nt_access_expr, p_tok), m_target(std::move(p_target)),
           m_property(std::move(p_property)), m_arguments(std::move(p_args)), m_is_invoke(p_is_invoke)
@@ -758,12 +817,17 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_target() const
+    const ptr<expression>& get_target() const
+    {
+      return m_target;
+    }
+
+    ptr<expression>& get_target()
     {
       return m_target;
     }
 
-    const std::unique_ptr<identifier_expression>& get_property() const
+    const ptr<identifier_expression>& get_property() const
     {
       return m_property;
     }
@@ -773,7 +837,12 @@ namespace ok::ast
       return m_is_invoke;
     }
 
-    const std::list<std::unique_ptr<expression>>& get_arguments_list() const
+    const list<expression>& get_arguments_list() const
+    {
+      return m_arguments;
+    }
+
+    list<expression>& get_arguments_list()
     {
       return m_arguments;
     }
@@ -784,10 +853,10 @@ namespace ok::ast
     }
 
   private:
-    std::unique_ptr<expression> m_target;
-    std::unique_ptr<identifier_expression> m_property;
-    // std::unique_ptr<expression> m_value;
-    std::list<std::unique_ptr<expression>> m_arguments;
+    ptr<expression> m_target;
+    ptr<identifier_expression> m_property;
+    // ptr<expression> m_value;
+    list<expression> m_arguments;
     bool m_is_invoke = false;
   };
 
@@ -800,7 +869,7 @@ namespace ok::ast
 
     std::string to_string() override
     {
-      return m_token.raw_literal;
+      return std::string{m_token.raw_literal};
     }
   };
 
@@ -808,8 +877,8 @@ namespace ok::ast
   {
   public:
     super_expression(token p_tok,
-                     std::unique_ptr<identifier_expression> p_method,
-                     std::list<std::unique_ptr<expression>>&& p_args = {},
+                     ptr<identifier_expression> p_method,
+                     list<expression>&& p_args = {},
                      bool p_is_invoke = false)
         : expression(node_type::nt_super_expr, p_tok), m_method(std::move(p_method)), m_arguments(std::move(p_args)),
           m_is_invoke(p_is_invoke)
@@ -823,12 +892,17 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<identifier_expression>& get_method() const
+    const ptr<identifier_expression>& get_method() const
     {
       return m_method;
     }
 
-    const std::list<std::unique_ptr<expression>>& get_arguments() const
+    const list<expression>& get_arguments() const
+    {
+      return m_arguments;
+    }
+
+    list<expression>& get_arguments()
     {
       return m_arguments;
     }
@@ -839,15 +913,15 @@ namespace ok::ast
     }
 
   private:
-    std::unique_ptr<identifier_expression> m_method;
-    std::list<std::unique_ptr<expression>> m_arguments;
+    ptr<identifier_expression> m_method;
+    list<expression> m_arguments;
     bool m_is_invoke = false;
   };
 
   class array_expression : public expression
   {
   public:
-    array_expression(token p_tok, std::list<std::unique_ptr<expression>>&& p_elements)
+    array_expression(token p_tok, list<expression>&& p_elements)
         : expression(node_type::nt_array_expr, p_tok), m_elements(std::move(p_elements))
     {
     }
@@ -866,20 +940,24 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::list<std::unique_ptr<expression>>& get_elements() const
+    const list<expression>& get_elements() const
+    {
+      return m_elements;
+    }
+
+    list<expression>& get_elements()
     {
       return m_elements;
     }
 
   private:
-    std::list<std::unique_ptr<expression>> m_elements;
+    list<expression> m_elements;
   };
 
   class map_expression : public expression
   {
   public:
-    map_expression(token p_tok,
-                   std::unordered_map<std::unique_ptr<expression>, std::unique_ptr<expression>>&& p_entries)
+    map_expression(token p_tok, std::unordered_map<ptr<expression>, ptr<expression>>&& p_entries)
         : expression(node_type::nt_map_expr, p_tok), m_entries(std::move(p_entries))
     {
     }
@@ -898,19 +976,19 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unordered_map<std::unique_ptr<expression>, std::unique_ptr<expression>>& get_entries() const
+    const std::unordered_map<ptr<expression>, ptr<expression>>& get_entries() const
     {
       return m_entries;
     }
 
   private:
-    std::unordered_map<std::unique_ptr<expression>, std::unique_ptr<expression>> m_entries;
+    std::unordered_map<ptr<expression>, ptr<expression>> m_entries;
   };
 
   class subscript_expression : public expression
   {
   public:
-    subscript_expression(token p_tok, std::unique_ptr<expression> p_left, std::unique_ptr<expression> p_right)
+    subscript_expression(token p_tok, ptr<expression> p_left, ptr<expression> p_right)
         : expression(node_type::nt_subscript_expr, p_tok)
     {
     }
@@ -923,8 +1001,8 @@ namespace ok::ast
     }
 
   private:
-    std::unique_ptr<expression> m_left;
-    std::unique_ptr<expression> m_right;
+    ptr<expression> m_left;
+    ptr<expression> m_right;
   };
 
   /**
@@ -947,7 +1025,7 @@ namespace ok::ast
   class expression_statement : public statement
   {
   public:
-    expression_statement(token p_tok, std::unique_ptr<expression> p_expr)
+    expression_statement(token p_tok, ptr<expression> p_expr)
         : statement(node_type::nt_expression_statement_stmt, p_tok), m_expression(std::move(p_expr))
     {
     }
@@ -957,19 +1035,24 @@ namespace ok::ast
       return m_expression == nullptr ? "" : m_expression->to_string();
     }
 
-    const std::unique_ptr<expression>& get_expression() const
+    const ptr<expression>& get_expression() const
+    {
+      return m_expression;
+    }
+
+    ptr<expression>& get_expression()
     {
       return m_expression;
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
+    ptr<expression> m_expression;
   };
 
   class print_statement : public statement
   {
   public:
-    print_statement(token p_tok, std::unique_ptr<expression> p_expr)
+    print_statement(token p_tok, ptr<expression> p_expr)
         : statement(node_type::nt_print_stmt, p_tok), m_expression(std::move(p_expr))
     {
     }
@@ -980,19 +1063,24 @@ namespace ok::ast
       return "print" + (m_expression == nullptr ? std::string("null") : m_expression->to_string());
     }
 
-    const std::unique_ptr<expression>& get_expression() const
+    const ptr<expression>& get_expression() const
+    {
+      return m_expression;
+    }
+
+    ptr<expression>& get_expression()
     {
       return m_expression;
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
+    ptr<expression> m_expression;
   };
 
   class block_statement : public statement
   {
   public:
-    block_statement(token p_tok, std::list<std::unique_ptr<statement>>&& p_statements)
+    block_statement(token p_tok, list<statement>&& p_statements)
         : statement(node_type::nt_block_stmt, p_tok), m_statements(std::move(p_statements))
     {
     }
@@ -1011,22 +1099,24 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::list<std::unique_ptr<statement>>& get_statement() const
+    const list<statement>& get_statement() const
+    {
+      return m_statements;
+    }
+
+    list<statement>& get_statement()
     {
       return m_statements;
     }
 
   private:
-    std::list<std::unique_ptr<statement>> m_statements;
+    list<statement> m_statements;
   };
 
   class if_statement : public statement
   {
   public:
-    if_statement(token p_tok,
-                 std::unique_ptr<expression> p_expr,
-                 std::unique_ptr<statement> p_consequences,
-                 std::unique_ptr<statement> p_alternative)
+    if_statement(token p_tok, ptr<expression> p_expr, ptr<statement> p_consequences, ptr<statement> p_alternative)
         : statement(node_type::nt_if_stmt, p_tok), m_expression(std::move(p_expr)),
           m_consequence(std::move(p_consequences)), m_alternative(std::move(p_alternative))
     {
@@ -1042,31 +1132,46 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_expression() const
+    const ptr<expression>& get_expression() const
     {
       return m_expression;
     }
 
-    const std::unique_ptr<statement>& get_consequence() const
+    ptr<expression>& get_expression()
+    {
+      return m_expression;
+    }
+
+    const ptr<statement>& get_consequence() const
+    {
+      return m_consequence;
+    }
+
+    ptr<statement>& get_consequence()
     {
       return m_consequence;
     }
 
-    const std::unique_ptr<statement>& get_alternative() const
+    const ptr<statement>& get_alternative() const
+    {
+      return m_alternative;
+    }
+
+    ptr<statement>& get_alternative()
     {
       return m_alternative;
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
-    std::unique_ptr<statement> m_consequence;
-    std::unique_ptr<statement> m_alternative;
+    ptr<expression> m_expression;
+    ptr<statement> m_consequence;
+    ptr<statement> m_alternative;
   };
 
   class while_statement : public statement
   {
   public:
-    while_statement(token p_tok, std::unique_ptr<expression> p_expr, std::unique_ptr<statement> p_body)
+    while_statement(token p_tok, ptr<expression> p_expr, ptr<statement> p_body)
         : statement(node_type::nt_while_stmt, p_tok), m_expression(std::move(p_expr)), m_body(std::move(p_body))
     {
     }
@@ -1079,29 +1184,39 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_expression() const
+    const ptr<expression>& get_expression() const
     {
       return m_expression;
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    ptr<expression>& get_expression()
+    {
+      return m_expression;
+    }
+
+    const ptr<statement>& get_body() const
+    {
+      return m_body;
+    }
+
+    ptr<statement>& get_body()
     {
       return m_body;
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
-    std::unique_ptr<statement> m_body;
+    ptr<expression> m_expression;
+    ptr<statement> m_body;
   };
 
   class for_statement : public statement
   {
   public:
     for_statement(token p_tok,
-                  std::unique_ptr<statement> p_body,
-                  std::unique_ptr<statement> p_initializer = nullptr,
-                  std::unique_ptr<expression> p_condition = nullptr,
-                  std::unique_ptr<expression> p_increment = nullptr)
+                  ptr<statement> p_body,
+                  ptr<statement> p_initializer = nullptr,
+                  ptr<expression> p_condition = nullptr,
+                  ptr<expression> p_increment = nullptr)
         : statement(node_type::nt_for_stmt, p_tok), m_body(std::move(p_body)), m_initializer(std::move(p_initializer)),
           m_condition(std::move(p_condition)), m_increment(std::move(p_increment))
     {
@@ -1117,31 +1232,51 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    const ptr<statement>& get_body() const
     {
       return m_body;
     }
 
-    const std::unique_ptr<statement>& get_initializer() const
+    ptr<statement>& get_body()
+    {
+      return m_body;
+    }
+
+    const ptr<statement>& get_initializer() const
+    {
+      return m_initializer;
+    }
+
+    ptr<statement>& get_initializer()
     {
       return m_initializer;
     }
 
-    const std::unique_ptr<expression>& get_condition() const
+    const ptr<expression>& get_condition() const
     {
       return m_condition;
     }
 
-    const std::unique_ptr<expression>& get_increment() const
+    ptr<expression>& get_condition()
+    {
+      return m_condition;
+    }
+
+    const ptr<expression>& get_increment() const
+    {
+      return m_increment;
+    }
+
+    ptr<expression>& get_increment()
     {
       return m_increment;
     }
 
   private:
-    std::unique_ptr<statement> m_body;
-    std::unique_ptr<statement> m_initializer;
-    std::unique_ptr<expression> m_condition;
-    std::unique_ptr<expression> m_increment;
+    ptr<statement> m_body;
+    ptr<statement> m_initializer;
+    ptr<expression> m_condition;
+    ptr<expression> m_increment;
   };
 
   class control_flow_statement : public statement
@@ -1187,7 +1322,7 @@ namespace ok::ast
 
     std::string to_string() override
     {
-      return m_token.raw_literal;
+      return std::string{m_token.raw_literal};
     }
 
     cftype get_control_flow_type() const
@@ -1202,7 +1337,7 @@ namespace ok::ast
   class return_statement : public statement
   {
   public:
-    return_statement(token p_tok, std::unique_ptr<expression> p_expr = nullptr)
+    return_statement(token p_tok, ptr<expression> p_expr = nullptr)
         : statement(node_type::nt_return_stmt, p_tok), m_expression(std::move(p_expr))
     {
     }
@@ -1214,19 +1349,24 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_expression() const
+    const ptr<expression>& get_expression() const
+    {
+      return m_expression;
+    }
+
+    ptr<expression>& get_expression()
     {
       return m_expression;
     }
 
   private:
-    std::unique_ptr<expression> m_expression;
+    ptr<expression> m_expression;
   };
 
   class try_statement : public statement
   {
   public:
-    try_statement(token p_tok, std::unique_ptr<statement> p_body)
+    try_statement(token p_tok, ptr<statement> p_body)
         : statement(node_type::nt_try_stmt, p_tok), m_body(std::move(p_body))
     {
     }
@@ -1238,19 +1378,24 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    const ptr<statement>& get_body() const
+    {
+      return m_body;
+    }
+
+    ptr<statement>& get_body()
     {
       return m_body;
     }
 
   private:
-    std::unique_ptr<statement> m_body;
+    ptr<statement> m_body;
   };
 
   class catch_statement : public statement
   {
   public:
-    catch_statement(token p_tok, std::unique_ptr<binding> p_binding, std::unique_ptr<statement> p_body)
+    catch_statement(token p_tok, ptr<binding> p_binding, ptr<statement> p_body)
         : statement(node_type::nt_catch_stmt, p_tok), m_binding(std::move(p_binding)), m_body(std::move(p_body))
     {
     }
@@ -1262,25 +1407,30 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<binding>& get_binding() const
+    const ptr<binding>& get_binding() const
     {
       return m_binding;
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    const ptr<statement>& get_body() const
+    {
+      return m_body;
+    }
+
+    ptr<statement>& get_body()
     {
       return m_body;
     }
 
   private:
-    std::unique_ptr<binding> m_binding;
-    std::unique_ptr<statement> m_body;
+    ptr<binding> m_binding;
+    ptr<statement> m_body;
   };
 
   class finalize_statement : public statement
   {
   public:
-    finalize_statement(token p_tok, std::unique_ptr<statement> p_body)
+    finalize_statement(token p_tok, ptr<statement> p_body)
         : statement(node_type::nt_finalize_stmt, p_tok), m_body(std::move(p_body))
     {
     }
@@ -1292,13 +1442,18 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    const ptr<statement>& get_body() const
+    {
+      return m_body;
+    }
+
+    ptr<statement>& get_body()
     {
       return m_body;
     }
 
   private:
-    std::unique_ptr<statement> m_body;
+    ptr<statement> m_body;
   };
 
   /**
@@ -1309,8 +1464,8 @@ namespace ok::ast
   {
   public:
     let_declaration(token p_tok,
-                    std::unique_ptr<binding> p_binding,
-                    std::unique_ptr<expression> p_value,
+                    ptr<binding> p_binding,
+                    ptr<expression> p_value,
                     declaration_modifier p_mods = declaration_modifier::dm_none)
         : declaration(node_type::nt_let_decl, p_tok, p_mods), m_binding(std::move(p_binding)),
           m_value(std::move(p_value))
@@ -1324,28 +1479,33 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<expression>& get_value() const
+    const ptr<expression>& get_value() const
+    {
+      return m_value;
+    }
+
+    ptr<expression>& get_value()
     {
       return m_value;
     }
 
-    const std::unique_ptr<binding>& get_binding() const
+    const ptr<binding>& get_binding() const
     {
       return m_binding;
     }
 
   private:
-    std::unique_ptr<binding> m_binding;
-    std::unique_ptr<expression> m_value;
+    ptr<binding> m_binding;
+    ptr<expression> m_value;
   };
 
   class function_declaration : public declaration
   {
   public:
     function_declaration(token p_tok,
-                         std::unique_ptr<statement> p_body,
-                         std::unique_ptr<binding> p_binding = nullptr,
-                         std::list<std::unique_ptr<binding>>&& p_parameatres = {},
+                         ptr<statement> p_body,
+                         ptr<binding> p_binding = nullptr,
+                         list<binding>&& p_parameatres = {},
                          declaration_modifier p_mods = declaration_modifier::dm_none)
         : declaration(node_type::nt_function_decl, p_tok, p_mods), m_binding(std::move(p_binding)),
           m_parameters(std::move(p_parameatres)), m_body(std::move(p_body))
@@ -1369,25 +1529,30 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<binding>& get_binding() const
+    const ptr<binding>& get_binding() const
     {
       return m_binding;
     }
 
-    const std::list<std::unique_ptr<binding>>& get_parameters() const
+    const list<binding>& get_parameters() const
     {
       return m_parameters;
     }
 
-    const std::unique_ptr<statement>& get_body() const
+    const ptr<statement>& get_body() const
+    {
+      return m_body;
+    }
+
+    ptr<statement>& get_body()
     {
       return m_body;
     }
 
   private:
-    std::unique_ptr<binding> m_binding;
-    std::list<std::unique_ptr<binding>> m_parameters;
-    std::unique_ptr<statement> m_body;
+    ptr<binding> m_binding;
+    list<binding> m_parameters;
+    ptr<statement> m_body;
   };
 
   class class_declaration : public declaration
@@ -1395,15 +1560,15 @@ namespace ok::ast
   public:
     struct method_declaration
     {
-      std::unique_ptr<function_declaration> function;
+      ptr<function_declaration> function;
       unique_overridable_operator_type type;
     };
 
   public:
     class_declaration(token p_tok,
-                      std::unique_ptr<binding> p_identifier,
-                      std::list<method_declaration>&& p_methods,
-                      std::unique_ptr<identifier_expression> p_super = nullptr,
+                      ptr<binding> p_identifier,
+                      std::pmr::vector<method_declaration>&& p_methods,
+                      ptr<identifier_expression> p_super = nullptr,
                       declaration_modifier p_mods = declaration_modifier::dm_none)
         : declaration(node_type::nt_class_decl, p_tok, p_mods), m_binding(std::move(p_identifier)),
           m_methods(std::move(p_methods)), m_super(std::move(p_super))
@@ -1425,25 +1590,30 @@ namespace ok::ast
       return ss.str();
     }
 
-    const std::unique_ptr<binding>& get_binding() const
+    const ptr<binding>& get_binding() const
     {
       return m_binding;
     }
 
-    const std::list<method_declaration>& get_methods() const
+    const std::pmr::vector<method_declaration>& get_methods() const
+    {
+      return m_methods;
+    }
+
+    std::pmr::vector<method_declaration>& get_methods()
     {
       return m_methods;
     }
 
-    const std::unique_ptr<identifier_expression>& get_super() const
+    const ptr<identifier_expression>& get_super() const
     {
       return m_super;
     }
 
   private:
-    std::unique_ptr<binding> m_binding;
-    std::list<method_declaration> m_methods;
-    std::unique_ptr<identifier_expression> m_super;
+    ptr<binding> m_binding;
+    std::pmr::vector<method_declaration> m_methods;
+    ptr<identifier_expression> m_super;
   };
 
   /**
@@ -0,0 +1,338 @@
+#include "c_emitter.hpp"
+#include "image.hpp"
+#include "object.hpp"
+#include "utility.hpp"
+#include <format>
+
+namespace ok
+{
+  namespace
+  {
+    const char* arithmetic_operator(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_add:
+      case opcode::op_add_nn:
+      case opcode::op_add_unchecked:
+      case opcode::op_add_rr:
+      case opcode::op_add_rk:
+        return "+";
+      case opcode::op_subtract:
+      case opcode::op_subtract_nn:
+      case opcode::op_subtract_unchecked:
+      case opcode::op_subtract_rr:
+      case opcode::op_subtract_rk:
+        return "-";
+      case opcode::op_multiply:
+      case opcode::op_multiply_nn:
+      case opcode::op_multiply_unchecked:
+      case opcode::op_multiply_rr:
+      case opcode::op_multiply_rk:
+        return "*";
+      default:
+        return "/";
+      }
+    }
+
+    const char* compare_operator(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_greater:
+      case opcode::op_greater_nn:
+      case opcode::op_greater_unchecked:
+      case opcode::op_greater_rr_jump:
+      case opcode::op_greater_rk_jump:
+        return ">";
+      case opcode::op_greater_equal:
+      case opcode::op_greater_equal_nn:
+      case opcode::op_greater_equal_unchecked:
+      case opcode::op_greater_equal_rr_jump:
+      case opcode::op_greater_equal_rk_jump:
+        return ">=";
+      case opcode::op_less:
+      case opcode::op_less_nn:
+      case opcode::op_less_unchecked:
+      case opcode::op_less_rr_jump:
+      case opcode::op_less_rk_jump:
+        return "<";
+      case opcode::op_less_equal:
+      case opcode::op_less_equal_nn:
+      case opcode::op_less_equal_unchecked:
+      case opcode::op_less_equal_rr_jump:
+      case opcode::op_less_equal_rk_jump:
+        return "<=";
+      default:
+        return "==";
+      }
+    }
+
+    // the body of one native function, nullopt when a jump lands between instructions
+    std::optional<std::string> emit_function(const chunk& p_chunk)
+    {
+      const auto& code = p_chunk.code;
+      std::vector<bool> starts(code.size(), false);
+      for(size_t offset = 0; offset < code.size(); offset += instruction_length(p_chunk, offset))
+        starts[offset] = true;
+
+      std::string entry = "    switch(offset)\n    {\n";
+      std::string body;
+      for(size_t offset = 0; offset < code.size();)
+      {
+        const auto op = static_cast<opcode>(code[offset]);
+        const auto next = offset + instruction_length(p_chunk, offset);
+        const auto short_operand = [&](size_t p_at = 1) -> uint32_t { return code[offset + p_at]; };
+        const auto long_operand = [&](size_t p_at = 1) { return decode_int<uint32_t, 3>(code, offset + p_at); };
+        bool valid_target = true;
+        const auto jump_to = [&](size_t p_target)
+        {
+          valid_target = valid_target && p_target < code.size() && starts[p_target];
+          return p_target;
+        };
+        entry += std::format("    case {0}:\n      goto at_{0};\n", offset);
+        body += std::format("  at_{}: // {}\n  {{\n", offset, opcode_to_string(op));
+
+        switch(op)
+        {
+        case opcode::op_get_local:
+        case opcode::op_get_local_long:
+        // the rest of the sequence a superinstruction stands for follows it
+        case opcode::op_get_local_get_local_add:
+        case opcode::op_get_local_constant_less_jump:
+        case opcode::op_get_local_constant_add_set_local_pop:
+          body += std::format("    OK_AOT_PUSH(slots[{}], {});\n",
+                              op == opcode::op_get_local_long ? long_operand() : short_operand(),
+                              offset);
+          break;
+        case opcode::op_set_local:
+        case opcode::op_set_local_long:
+          body += std::format("    slots[{}] = top[-1];\n",
+                              op == opcode::op_set_local ? short_operand() : long_operand());
+          break;
+        case opcode::op_constant:
+        case opcode::op_constant_long:
+          body += std::format("    OK_AOT_PUSH(constants[{}], {});\n",
+                              op == opcode::op_constant ? short_operand() : long_operand(),
+                              offset);
+          break;
+        case opcode::op_null:
+        case opcode::op_true:
+        case opcode::op_false:
+          body += std::format("    OK_AOT_PUSH(value_t{{{}}}, {});\n",
+                              op == opcode::op_null ? "" : op == opcode::op_true ? "true" : "false",
+                              offset);
+          break;
+        case opcode::op_pop:
+          body += "    --top;\n";
+          break;
+        case opcode::op_pop_n:
+          body += std::format("    top -= {};\n", short_operand());
+          break;
+        case opcode::op_add:
+        case opcode::op_subtract:
+        case opcode::op_multiply:
+        case opcode::op_divide:
+        case opcode::op_add_nn:
+        case opcode::op_subtract_nn:
+        case opcode::op_multiply_nn:
+        case opcode::op_divide_nn:
+        case opcode::op_add_unchecked:
+        case opcode::op_subtract_unchecked:
+        case opcode::op_multiply_unchecked:
+        case opcode::op_divide_unchecked:
+        {
+          // the verifier already proved the operands of the unchecked forms, dividing by zero is left to the
+          // interpreter to report
+          const auto unchecked = op == opcode::op_add_unchecked || op == opcode::op_subtract_unchecked ||
+                                 op == opcode::op_multiply_unchecked || op == opcode::op_divide_unchecked;
+          const auto* arithmetic = arithmetic_operator(op);
+          if(!unchecked)
+            body += std::format("    OK_AOT_GUARD(OK_AOT_NUMBERS(top[-2], top[-1]), {});\n", offset);
+          if(*arithmetic == '/')
+            body += std::format("    OK_AOT_GUARD(OK_VALUE_AS_NUMBER(top[-1]) != 0, {});\n", offset);
+          body += std::format(
+              "    OK_VALUE_AS_NUMBER(top[-2]) = OK_VALUE_AS_NUMBER(top[-2]) {} OK_VALUE_AS_NUMBER(top[-1]);\n"
+              "    --top;\n",
+              arithmetic);
+          break;
+        }
+        case opcode::op_greater:
+        case opcode::op_greater_equal:
+        case opcode::op_less:
+        case opcode::op_less_equal:
+        case opcode::op_greater_nn:
+        case opcode::op_greater_equal_nn:
+        case opcode::op_less_nn:
+        case opcode::op_less_equal_nn:
+        case opcode::op_greater_unchecked:
+        case opcode::op_greater_equal_unchecked:
+        case opcode::op_less_unchecked:
+        case opcode::op_less_equal_unchecked:
+        case opcode::op_equal:
+          body += std::format("    OK_AOT_GUARD(OK_AOT_NUMBERS(top[-2], top[-1]), {});\n"
+                              "    top[-2] = value_t{{OK_VALUE_AS_NUMBER(top[-2]) {} OK_VALUE_AS_NUMBER(top[-1])}};\n"
+                              "    --top;\n",
+                              offset,
+                              compare_operator(op));
+          break;
+        case opcode::op_not:
+          body += std::format("    OK_AOT_GUARD(OK_IS_VALUE_BOOL(top[-1]), {});\n"
+                              "    OK_VALUE_AS_BOOL(top[-1]) = !OK_VALUE_AS_BOOL(top[-1]);\n",
+                              offset);
+          break;
+        case opcode::op_negate:
+          body += std::format("    OK_AOT_GUARD(OK_IS_VALUE_NUMBER(top[-1]), {});\n"
+                              "    OK_VALUE_AS_NUMBER(top[-1]) = -OK_VALUE_AS_NUMBER(top[-1]);\n",
+                              offset);
+          break;
+        case opcode::op_conditional_jump:
+        case opcode::op_conditional_truthy_jump:
+          body += std::format("    OK_AOT_GUARD(OK_IS_VALUE_BOOL(top[-1]), {});\n"
+                              "    if({}OK_VALUE_AS_BOOL(*--top))\n"
+                              "      goto at_{};\n",
+                              offset,
+                              op == opcode::op_conditional_jump ? "!" : "",
+                              jump_to(next + long_operand()));
+          break;
+        case opcode::op_jump:
+          body += std::format("    goto at_{};\n", jump_to(next + long_operand()));
+          break;
+        case opcode::op_loop:
+          body += std::format("    goto at_{};\n", jump_to(next - long_operand()));
+          break;
+        case opcode::op_add_rr:
+        case opcode::op_add_rk:
+        case opcode::op_subtract_rr:
+        case opcode::op_subtract_rk:
+        case opcode::op_multiply_rr:
+        case opcode::op_multiply_rk:
+        case opcode::op_divide_rr:
+        case opcode::op_divide_rk:
+        {
+          // [op][dst][lhs][rhs][stub x3], a miss runs the register instruction in the interpreter which takes the stub
+          const auto constant_rhs = op == opcode::op_add_rk || op == opcode::op_subtract_rk ||
+                                    op == opcode::op_multiply_rk || op == opcode::op_divide_rk;
+          if(constant_rhs && !OK_IS_VALUE_NUMBER(p_chunk.constants[short_operand(3)]))
+          {
+            body += std::format("    OK_AOT_LEAVE({});\n", offset);
+            break;
+          }
+          const auto lhs = std::format("slots[{}]", short_operand(2));
+          const auto rhs = std::format("{}[{}]", constant_rhs ? "constants" : "slots", short_operand(3));
+          const auto* arithmetic = arithmetic_operator(op);
+          body += std::format("    OK_AOT_GUARD(OK_AOT_NUMBERS({}, {}), {});\n", lhs, rhs, offset);
+          if(*arithmetic == '/')
+            body += std::format("    OK_AOT_GUARD(OK_VALUE_AS_NUMBER({}) != 0, {});\n", rhs, offset);
+          body += std::format("    slots[{}] = value_t{{OK_VALUE_AS_NUMBER({}) {} OK_VALUE_AS_NUMBER({})}};\n",
+                              short_operand(1),
+                              lhs,
+                              arithmetic,
+                              rhs);
+          break;
+        }
+        case opcode::op_greater_rr_jump:
+        case opcode::op_greater_rk_jump:
+        case opcode::op_greater_equal_rr_jump:
+        case opcode::op_greater_equal_rk_jump:
+        case opcode::op_less_rr_jump:
+        case opcode::op_less_rk_jump:
+        case opcode::op_less_equal_rr_jump:
+        case opcode::op_less_equal_rk_jump:
+        {
+          // [op][lhs][rhs][exit x3][stub x3], jumps to exit when the compare fails
+          const auto constant_rhs = op == opcode::op_greater_rk_jump || op == opcode::op_greater_equal_rk_jump ||
+                                    op == opcode::op_less_rk_jump || op == opcode::op_less_equal_rk_jump;
+          if(constant_rhs && !OK_IS_VALUE_NUMBER(p_chunk.constants[short_operand(2)]))
+          {
+            body += std::format("    OK_AOT_LEAVE({});\n", offset);
+            break;
+          }
+          const auto lhs = std::format("slots[{}]", short_operand(1));
+          const auto rhs = std::format("{}[{}]", constant_rhs ? "constants" : "slots", short_operand(2));
+          body += std::format("    OK_AOT_GUARD(OK_AOT_NUMBERS({0}, {1}), {2});\n"
+                              "    if(!(OK_VALUE_AS_NUMBER({0}) {3} OK_VALUE_AS_NUMBER({1})))\n"
+                              "      goto at_{4};\n",
+                              lhs,
+                              rhs,
+                              offset,
+                              compare_operator(op),
+                              jump_to(next + long_operand(3)));
+          break;
+        }
+        default:
+          // calls, globals, properties, upvalues, printing and returns all go through the interpreter
+          body += std::format("    OK_AOT_LEAVE({});\n", offset);
+          break;
+        }
+        if(!valid_target)
+          return std::nullopt;
+        body += "  }\n";
+        offset = next;
+      }
+      // running off the end can not happen, every chunk ends with a return
+      entry += "    default:\n      OK_AOT_LEAVE(offset);\n    }\n";
+      return entry + body + "  OK_AOT_LEAVE(offset);\n";
+    }
+  } // namespace
+
+  std::optional<std::string> c_emitter::emit(const function_object* p_script, std::string_view p_source_name)
+  {
+    // the image is built into the executable, nothing ever checks it against a source
+    const auto bytes = image::write(p_script, {});
+    if(!bytes)
+      return std::nullopt;
+    const auto functions = image::functions(p_script);
+
+    std::string source = std::format("// generated by okc --emit-c from {}, build it against the okrt library\n"
+                                     "#include \"aot.hpp\"\n"
+                                     "\n"
+                                     "namespace\n"
+                                     "{{\n"
+                                     "  using namespace ok;\n",
+                                     p_source_name);
+    for(size_t i = 0; i < functions.size(); ++i)
+    {
+      const auto body = emit_function(functions[i]->associated_chunk);
+      if(!body)
+        return std::nullopt;
+      source += std::format("\n"
+                            "  // {}\n"
+                            "  uint32_t function_{}(value_t* slots,\n"
+                            "                      value_t* top,\n"
+                            "                      const value_t* constants,\n"
+                            "                      value_t** out_top,\n"
+                            "                      uint32_t offset,\n"
+                            "                      const value_t* limit)\n"
+                            "  {{\n"
+                            "{}"
+                            "  }}\n",
+                            std::string_view{functions[i]->name->chars, functions[i]->name->length},
+                            i,
+                            *body);
+    }
+
+    source += "\n  const jit_code::native_type natives[] = {\n";
+    for(size_t i = 0; i < functions.size(); ++i)
+      source += std::format("      function_{},\n", i);
+    source += "  };\n\n  const byte image[] = {";
+    for(size_t i = 0; i < bytes->size(); ++i)
+      source += std::format("{}{},", i % 20 == 0 ? "\n      " : " ", static_cast<uint32_t>((*bytes)[i]));
+    source += std::format("\n  }};\n"
+                          "}} // namespace\n"
+                          "\n"
+                          "extern \"C\" int ok_script_main()\n"
+                          "{{\n"
+                          "  return ok::aot::run(image, natives);\n"
+                          "}}\n"
+                          "\n"
+                          "// define OK_AOT_NO_MAIN to build the script into a shared object\n"
+                          "#if !defined(OK_AOT_NO_MAIN)\n"
+                          "int main()\n"
+                          "{{\n"
+                          "  return ok_script_main();\n"
+                          "}}\n"
+                          "#endif\n");
+    return source;
+  }
+} // namespace ok
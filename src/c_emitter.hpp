@@ -0,0 +1,23 @@
+#ifndef OK_C_EMITTER_HPP
+#define OK_C_EMITTER_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ok
+{
+  struct function_object;
+
+  // translates a compiled script to c++ for okc --emit-c. each function becomes a native function with the templates
+  // of jit::compile written out as source, entered at any instruction through a switch. everything else, calls and
+  // objects included, leaves to the vm the source links against through the okrt library. the functions themselves
+  // are embedded as an image
+  struct c_emitter
+  {
+    // nullopt when the script can not be written as an image or jumps somewhere that is not an instruction
+    static std::optional<std::string> emit(const function_object* p_script, std::string_view p_source_name);
+  };
+} // namespace ok
+
+#endif // OK_C_EMITTER_HPP
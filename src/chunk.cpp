@@ -0,0 +1,103 @@
+#include "chunk.hpp"
+#include "object.hpp"
+
+namespace ok
+{
+  size_t instruction_length(const chunk& p_chunk, size_t p_offset)
+  {
+    ASSERT(p_offset < p_chunk.code.size());
+    constexpr size_t set_if_compare_size = 8; // function pointer trailing every set_if instruction
+    switch(static_cast<opcode>(p_chunk.code[p_offset]))
+    {
+    case opcode::op_pop_n:
+    case opcode::op_constant:
+    case opcode::op_call:
+    case opcode::op_convert_method:
+    case opcode::op_get_super:
+    case opcode::op_get_global:
+    case opcode::op_set_global:
+    case opcode::op_get_local:
+    case opcode::op_set_local:
+    case opcode::op_get_upvalue:
+    case opcode::op_set_upvalue:
+    case opcode::op_get_property:
+    case opcode::op_set_property:
+    case opcode::op_get_local_get_local_add:
+    case opcode::op_get_local_constant_less_jump:
+    case opcode::op_get_local_constant_add_set_local_pop:
+      return 2;
+    case opcode::op_define_global: // identifier then the declaration flags
+    case opcode::op_method:
+    case opcode::op_special_method:
+    case opcode::op_invoke:
+    case opcode::op_invoke_super:
+      return 3;
+    case opcode::op_constant_long:
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+    case opcode::op_conditional_jump_leave:
+    case opcode::op_conditional_truthy_jump_leave:
+    case opcode::op_jump:
+    case opcode::op_loop:
+    case opcode::op_get_super_long:
+    case opcode::op_get_global_long:
+    case opcode::op_set_global_long:
+    case opcode::op_get_local_long:
+    case opcode::op_set_local_long:
+    case opcode::op_get_upvalue_long:
+    case opcode::op_set_upvalue_long:
+    case opcode::op_get_property_long:
+    case opcode::op_set_property_long:
+      return 4;
+    case opcode::op_class:
+    case opcode::op_define_global_long:
+    case opcode::op_method_long:
+    case opcode::op_invoke_long:
+    case opcode::op_invoke_super_long:
+      return 5;
+    case opcode::op_class_long:
+    case opcode::op_add_rr:
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rr:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rr:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rr:
+    case opcode::op_divide_rk:
+      return 7;
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rr_jump:
+    case opcode::op_less_equal_rk_jump:
+      return 9;
+    case opcode::op_set_if_global:
+    case opcode::op_set_if_local:
+    case opcode::op_set_if_upvalue:
+    case opcode::op_set_if_property:
+      return 2 + set_if_compare_size;
+    case opcode::op_set_if_global_long:
+    case opcode::op_set_if_local_long:
+    case opcode::op_set_if_upvalue_long:
+    case opcode::op_set_if_property_long:
+      return 4 + set_if_compare_size;
+    case opcode::op_closure:
+    {
+      // op_closure, then the function as an op_constant(_long) instruction, then 4 bytes per upvalue
+      const auto const_offset = p_offset + 1;
+      uint32_t index;
+      if(static_cast<opcode>(p_chunk.code[const_offset]) == opcode::op_constant)
+        index = p_chunk.code[const_offset + 1];
+      else
+        index = decode_int<uint32_t, 3>(p_chunk.code, const_offset + 1);
+      const auto fun = OK_VALUE_AS_FUNCTION_OBJECT(p_chunk.constants[index]);
+      return 1 + instruction_length(p_chunk, const_offset) + fun->upvalues * 4;
+    }
+    default:
+      return 1;
+    }
+  }
+} // namespace ok
@@ -5,14 +5,24 @@
 #include "utility.hpp"
 #include "value.hpp"
 #include "vm_stack.hpp"
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <memory>
 #include <print>
 #include <span>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace ok
 {
+  namespace ast
+  {
+    class function_declaration;
+  }
+
   enum class variable_declaration_flags : uint8_t
   {
     vdf_none = 0,
@@ -37,6 +47,7 @@ namespace ok
     variable_declaration decl;
     int depth;
     bool is_captured = false;
+    ast::function_declaration* inlinable = nullptr; // immutable local function whose calls get inlined
   };
 
   using byte = uint8_t;
@@ -156,6 +167,57 @@ namespace ok
     op_set_property_long,
     op_set_if_property,
     op_set_if_property_long,
+
+    // quickened, never emitted by the compiler. the vm rewrites the generic instruction in place after it sees number
+    // operands and rewrites it back on a type miss, so they must stay the same size as the generic ones
+    op_add_nn,
+    op_subtract_nn,
+    op_multiply_nn,
+    op_divide_nn,
+    op_greater_nn,
+    op_greater_equal_nn,
+    op_less_nn,
+    op_less_equal_nn,
+
+    // unchecked, emitted by optimizer::specialize_numbers where both operands are proven numbers and checked by the
+    // verifier, the vm does not test the operand tags
+    op_add_unchecked,
+    op_subtract_unchecked,
+    op_multiply_unchecked,
+    op_divide_unchecked,
+    op_greater_unchecked,
+    op_greater_equal_unchecked,
+    op_less_unchecked,
+    op_less_equal_unchecked,
+
+    // superinstructions, written by the optimizer over the first op_get_local of the sequence they stand for. the rest
+    // of the sequence is left in place, so on a type miss they behave as that op_get_local and the vm carries on
+    // through the original instructions. they have the same size as op_get_local
+    op_get_local_get_local_add,              // op_get_local, op_get_local, op_add
+    op_get_local_constant_less_jump,         // op_get_local, op_constant, op_less, op_conditional_jump
+    op_get_local_constant_add_set_local_pop, // op_get_local, op_constant, op_add, op_set_local, op_pop
+
+    // register instructions, emitted by optimizer::allocate_registers. they address the frame's slots directly, _rr
+    // forms take two slots and _rk forms a slot and a number constant
+    // [op][dst][lhs][rhs][stub x3] for the arithmetic, [op][lhs][rhs][exit x3][stub x3] for the compare and jumps that
+    // jump to exit when the compare fails. on a type miss the vm pushes both operands and jumps to the stub, a copy of
+    // the stack instructions they replaced appended to the chunk that jumps back when it is done
+    op_add_rr,
+    op_add_rk,
+    op_subtract_rr,
+    op_subtract_rk,
+    op_multiply_rr,
+    op_multiply_rk,
+    op_divide_rr,
+    op_divide_rk,
+    op_greater_rr_jump,
+    op_greater_rk_jump,
+    op_greater_equal_rr_jump,
+    op_greater_equal_rk_jump,
+    op_less_rr_jump,
+    op_less_rk_jump,
+    op_less_equal_rr_jump,
+    op_less_equal_rk_jump,
   };
   constexpr uint32_t op_constant_max_count = UINT8_MAX;
   constexpr uint32_t uint24_max = (1 << 24) - 1;
@@ -163,6 +225,141 @@ namespace ok
   constexpr uint32_t op__global_max_count = UINT8_MAX;
   constexpr uint32_t op__global_long_max_count = uint24_max;
 
+  // the bytes of a chunk. the compiler grows its own, image::read points them at the code of a mapped image instead,
+  // kept alive by the owner. writes in place go to the mapping, which is private so the kernel copies a page on its
+  // first write. anything that changes the size copies the code out of the mapping first
+  class code_buffer
+  {
+  public:
+    code_buffer() = default;
+    // a copy always owns its bytes
+    code_buffer(const code_buffer& p_other) : m_bytes(p_other.begin(), p_other.end())
+    {
+    }
+    code_buffer(code_buffer&&) noexcept = default;
+    code_buffer& operator=(const code_buffer& p_other)
+    {
+      if(this != &p_other)
+        assign(p_other.begin(), p_other.end());
+      return *this;
+    }
+    code_buffer& operator=(code_buffer&&) noexcept = default;
+
+    void view(std::span<byte> p_bytes, std::shared_ptr<const void> p_owner)
+    {
+      m_bytes.clear();
+      m_view = p_bytes;
+      m_owner = std::move(p_owner);
+    }
+
+    size_t size() const
+    {
+      return is_view() ? m_view.size() : m_bytes.size();
+    }
+
+    bool empty() const
+    {
+      return size() == 0;
+    }
+
+    byte* data()
+    {
+      return is_view() ? m_view.data() : m_bytes.data();
+    }
+
+    const byte* data() const
+    {
+      return is_view() ? m_view.data() : m_bytes.data();
+    }
+
+    byte* begin()
+    {
+      return data();
+    }
+
+    byte* end()
+    {
+      return data() + size();
+    }
+
+    const byte* begin() const
+    {
+      return data();
+    }
+
+    const byte* end() const
+    {
+      return data() + size();
+    }
+
+    byte& operator[](size_t p_index)
+    {
+      return data()[p_index];
+    }
+
+    const byte& operator[](size_t p_index) const
+    {
+      return data()[p_index];
+    }
+
+    void push_back(byte p_byte)
+    {
+      own();
+      m_bytes.push_back(p_byte);
+    }
+
+    template <typename Iterator>
+    void insert(const byte* p_position, Iterator p_first, Iterator p_last)
+    {
+      const auto at = p_position - data();
+      own();
+      m_bytes.insert(m_bytes.begin() + at, p_first, p_last);
+    }
+
+    void append_range(std::span<const byte> p_bytes)
+    {
+      insert(end(), p_bytes.begin(), p_bytes.end());
+    }
+
+    template <typename Iterator>
+    void assign(Iterator p_first, Iterator p_last)
+    {
+      std::vector<byte> bytes(p_first, p_last); // may point into the mapping
+      m_view = {};
+      m_owner.reset();
+      m_bytes = std::move(bytes);
+    }
+
+    void reserve(size_t p_size)
+    {
+      own();
+      m_bytes.reserve(p_size);
+    }
+
+    void clear()
+    {
+      m_view = {};
+      m_owner.reset();
+      m_bytes.clear();
+    }
+
+  private:
+    bool is_view() const
+    {
+      return m_owner != nullptr;
+    }
+
+    void own()
+    {
+      if(is_view())
+        assign(m_view.begin(), m_view.end());
+    }
+
+    std::vector<byte> m_bytes;
+    std::span<byte> m_view;
+    std::shared_ptr<const void> m_owner;
+  };
+
   // TODO(Qais): add sized writes, i.e. the constant write should be dependant on constant_index_type. and so on
   // Update: done needs testing and maybe templating
   struct chunk
@@ -187,6 +384,15 @@ namespace ok
       write_offset(p_offset, p_bytes.size());
     }
 
+    // an instruction and its operand bytes in one go
+    template <size_t N>
+    inline void write(const opcode p_opcode, const std::array<byte, N>& p_operands, const size_t p_offset)
+    {
+      code.push_back(to_utype(p_opcode));
+      code.insert(code.end(), p_operands.begin(), p_operands.end());
+      write_offset(p_offset, N + 1);
+    }
+
     inline void patch(const std::span<const byte> p_bytes, const size_t p_position)
     {
       ASSERT(p_position < code.size());
@@ -196,22 +402,19 @@ namespace ok
 
     inline void write_constant(const value_t p_value, const size_t p_offset)
     {
-      constants.push_back(p_value);
-      const auto index = constants.size() - 1;
+      const auto index = find_or_add_constant(p_value);
       if(index < op_constant_max_count + 1)
       {
-        write(opcode::op_constant, p_offset);
-        write(index, p_offset);
+        write(opcode::op_constant, std::array{static_cast<byte>(index)}, p_offset);
       }
       else if(index < op_constant_long_max_count + 1)
       {
-        write(opcode::op_constant_long, p_offset);
         const auto span = encode_int<size_t, 3>(index);
 #if defined(PARANOID)
         for(auto s : span)
           TRACELN("byte: {}", (uint8_t)s);
 #endif
-        write(span, p_offset); // 3 bytes since it is uint24
+        write(opcode::op_constant_long, span, p_offset); // 3 bytes since it is uint24
       }
       // TODO(Qais): else error: out of constants
     }
@@ -221,8 +424,10 @@ namespace ok
     uint32_t add_identifier(const value_t p_global, const size_t p_offset)
     {
       ASSERT(p_global.type == value_type::object_val);
-      identifiers.push_back(p_global);
-      const auto index = identifiers.size() - 1;
+      auto [it, added] = identifier_indices.try_emplace(p_global.as.pointer, identifiers.size());
+      if(added)
+        identifiers.push_back(p_global);
+      const auto index = it->second;
       if(index < op__global_max_count + 1)
       {
         // write(is_define ? opcode::op_define_global : opcode::op_get_global, p_offset);
@@ -245,8 +450,7 @@ namespace ok
 
     inline uint32_t add_constant(const value_t p_value, const size_t p_offset)
     {
-      constants.push_back(p_value);
-      const auto index = constants.size() - 1;
+      const auto index = find_or_add_constant(p_value);
       if(index < op_constant_max_count + 1)
       {
         write(index, p_offset);
@@ -266,6 +470,37 @@ namespace ok
       // ASSERT(false);
     }
 
+    // the slot p_value already has in the table, or a new one. numbers match by bit pattern and objects by address,
+    // which for strings is by content since they are interned
+    inline uint32_t find_or_add_constant(const value_t p_value)
+    {
+      uint32_t* known = nullptr;
+      if(OK_IS_VALUE_NUMBER(p_value))
+      {
+        const auto bits = std::bit_cast<uint64_t>(OK_VALUE_AS_NUMBER(p_value));
+        known = &number_indices.try_emplace(bits, UINT32_MAX).first->second;
+      }
+      else if(OK_IS_VALUE_OBJECT(p_value))
+      {
+        known = &object_indices.try_emplace(p_value.as.pointer, UINT32_MAX).first->second;
+      }
+      if(known != nullptr && *known != UINT32_MAX)
+        return *known;
+      constants.push_back(p_value);
+      const uint32_t index = constants.size() - 1;
+      if(known != nullptr)
+        *known = index;
+      return index;
+    }
+
+    // the lookups are only needed while the chunk is being compiled
+    inline void release_indices()
+    {
+      number_indices = {};
+      object_indices = {};
+      identifier_indices = {};
+    }
+
     inline void write_offset(const size_t p_offset, const size_t range_count = 1)
     {
       if(offsets.empty())
@@ -292,7 +527,7 @@ namespace ok
       return 0; // couldnt find it!
     }
 
-    std::vector<byte> code;
+    code_buffer code;
     value_array constants;
     value_array identifiers;
     // std::vector<local> m_locals;
@@ -302,6 +537,282 @@ namespace ok
       size_t reps;
     };
     std::vector<offset_with_rep> offsets;
+    // where each constant and identifier is in its table, so a repeated one reuses its slot
+    std::unordered_map<uint64_t, uint32_t> number_indices;
+    std::unordered_map<const void*, uint32_t> object_indices;
+    std::unordered_map<const void*, uint32_t> identifier_indices;
   };
+
+  constexpr std::string_view opcode_to_string(opcode p_op)
+  {
+    using namespace std::string_view_literals;
+    switch(p_op)
+    {
+    case opcode::op_invalid:
+      return "op_invalid"sv;
+    case opcode::op_pop:
+      return "op_pop"sv;
+    case opcode::op_pop_n:
+      return "op_pop_n"sv;
+    case opcode::op_constant:
+      return "op_constant"sv;
+    case opcode::op_constant_long:
+      return "op_constant_long"sv;
+    case opcode::op_conditional_jump:
+      return "op_conditional_jump"sv;
+    case opcode::op_conditional_truthy_jump:
+      return "op_conditional_truthy_jump"sv;
+    case opcode::op_conditional_jump_leave:
+      return "op_conditional_jump_leave"sv;
+    case opcode::op_conditional_truthy_jump_leave:
+      return "op_conditional_truthy_jump_leave"sv;
+    case opcode::op_jump:
+      return "op_jump"sv;
+    case opcode::op_loop:
+      return "op_loop"sv;
+    case opcode::op_call:
+      return "op_call"sv;
+    case opcode::op_closure:
+      return "op_closure"sv;
+    case opcode::op_class:
+      return "op_class"sv;
+    case opcode::op_class_long:
+      return "op_class_long"sv;
+    case opcode::op_method:
+      return "op_method"sv;
+    case opcode::op_method_long:
+      return "op_method_long"sv;
+    case opcode::op_special_method:
+      return "op_special_method"sv;
+    case opcode::op_convert_method:
+      return "op_convert_method"sv;
+    case opcode::op_invoke:
+      return "op_invoke"sv;
+    case opcode::op_invoke_long:
+      return "op_invoke_long"sv;
+    case opcode::op_inherit:
+      return "op_inherit"sv;
+    case opcode::op_get_super:
+      return "op_get_super"sv;
+    case opcode::op_get_super_long:
+      return "op_get_super_long"sv;
+    case opcode::op_invoke_super:
+      return "op_invoke_super"sv;
+    case opcode::op_invoke_super_long:
+      return "op_invoke_super_long"sv;
+    case opcode::op_save_slot:
+      return "op_save_slot"sv;
+    case opcode::op_push_saved_slot:
+      return "op_push_saved_slot"sv;
+    case opcode::op_not:
+      return "op_not"sv;
+    case opcode::op_additive:
+      return "op_additive"sv;
+    case opcode::op_negate:
+      return "op_negate"sv;
+    case opcode::op_add:
+      return "op_add"sv;
+    case opcode::op_tiled:
+      return "op_tiled"sv;
+    case opcode::op_preincrement:
+      return "op_preincrement"sv;
+    case opcode::op_predecrement:
+      return "op_predecrement"sv;
+    case opcode::op_postincrement:
+      return "op_postincrement"sv;
+    case opcode::op_postdecrement:
+      return "op_postdecrement"sv;
+    case opcode::op_subtract:
+      return "op_subtract"sv;
+    case opcode::op_multiply:
+      return "op_multiply"sv;
+    case opcode::op_divide:
+      return "op_divide"sv;
+    case opcode::op_modulo:
+      return "op_modulo"sv;
+    case opcode::op_xor:
+      return "op_xor"sv;
+    case opcode::op_or:
+      return "op_or"sv;
+    case opcode::op_and:
+      return "op_and"sv;
+    case opcode::op_shift_left:
+      return "op_shift_left"sv;
+    case opcode::op_shift_right:
+      return "op_shift_right"sv;
+    case opcode::op_equal:
+      return "op_equal"sv;
+    case opcode::op_not_equal:
+      return "op_not_equal"sv;
+    case opcode::op_greater:
+      return "op_greater"sv;
+    case opcode::op_less:
+      return "op_less"sv;
+    case opcode::op_greater_equal:
+      return "op_greater_equal"sv;
+    case opcode::op_less_equal:
+      return "op_less_equal"sv;
+    case opcode::op_add_assign:
+      return "op_add_assign"sv;
+    case opcode::op_subtract_assign:
+      return "op_subtract_assign"sv;
+    case opcode::op_multiply_assign:
+      return "op_multiply_assign"sv;
+    case opcode::op_divide_assign:
+      return "op_divide_assign"sv;
+    case opcode::op_modulo_assign:
+      return "op_modulo_assign"sv;
+    case opcode::op_and_assign:
+      return "op_and_assign"sv;
+    case opcode::op_xor_assign:
+      return "op_xor_assign"sv;
+    case opcode::op_or_assign:
+      return "op_or_assign"sv;
+    case opcode::op_shift_left_assign:
+      return "op_shift_left_assign"sv;
+    case opcode::op_shift_right_assign:
+      return "op_shift_right_assign"sv;
+    case opcode::op_as:
+      return "op_as"sv;
+    case opcode::op_null:
+      return "op_null"sv;
+    case opcode::op_true:
+      return "op_true"sv;
+    case opcode::op_false:
+      return "op_false"sv;
+    case opcode::op_print:
+      return "op_print"sv;
+    case opcode::op_return:
+      return "op_return"sv;
+    case opcode::op_define_global:
+      return "op_define_global"sv;
+    case opcode::op_define_global_long:
+      return "op_define_global_long"sv;
+    case opcode::op_get_global:
+      return "op_get_global"sv;
+    case opcode::op_get_global_long:
+      return "op_get_global_long"sv;
+    case opcode::op_set_global:
+      return "op_set_global"sv;
+    case opcode::op_set_global_long:
+      return "op_set_global_long"sv;
+    case opcode::op_set_if_global:
+      return "op_set_if_global"sv;
+    case opcode::op_set_if_global_long:
+      return "op_set_if_global_long"sv;
+    case opcode::op_get_local:
+      return "op_get_local"sv;
+    case opcode::op_get_local_long:
+      return "op_get_local_long"sv;
+    case opcode::op_set_local:
+      return "op_set_local"sv;
+    case opcode::op_set_local_long:
+      return "op_set_local_long"sv;
+    case opcode::op_set_if_local:
+      return "op_set_if_local"sv;
+    case opcode::op_set_if_local_long:
+      return "op_set_if_local_long"sv;
+    case opcode::op_get_upvalue:
+      return "op_get_upvalue"sv;
+    case opcode::op_get_upvalue_long:
+      return "op_get_upvalue_long"sv;
+    case opcode::op_set_upvalue:
+      return "op_set_upvalue"sv;
+    case opcode::op_set_upvalue_long:
+      return "op_set_upvalue_long"sv;
+    case opcode::op_set_if_upvalue:
+      return "op_set_if_upvalue"sv;
+    case opcode::op_set_if_upvalue_long:
+      return "op_set_if_upvalue_long"sv;
+    case opcode::op_close_upvalue:
+      return "op_close_upvalue"sv;
+    case opcode::op_get_property:
+      return "op_get_property"sv;
+    case opcode::op_get_property_long:
+      return "op_get_property_long"sv;
+    case opcode::op_set_property:
+      return "op_set_property"sv;
+    case opcode::op_set_property_long:
+      return "op_set_property_long"sv;
+    case opcode::op_set_if_property:
+      return "op_set_if_property"sv;
+    case opcode::op_set_if_property_long:
+      return "op_set_if_property_long"sv;
+    case opcode::op_add_nn:
+      return "op_add_nn"sv;
+    case opcode::op_subtract_nn:
+      return "op_subtract_nn"sv;
+    case opcode::op_multiply_nn:
+      return "op_multiply_nn"sv;
+    case opcode::op_divide_nn:
+      return "op_divide_nn"sv;
+    case opcode::op_greater_nn:
+      return "op_greater_nn"sv;
+    case opcode::op_greater_equal_nn:
+      return "op_greater_equal_nn"sv;
+    case opcode::op_less_nn:
+      return "op_less_nn"sv;
+    case opcode::op_less_equal_nn:
+      return "op_less_equal_nn"sv;
+    case opcode::op_add_unchecked:
+      return "op_add_unchecked"sv;
+    case opcode::op_subtract_unchecked:
+      return "op_subtract_unchecked"sv;
+    case opcode::op_multiply_unchecked:
+      return "op_multiply_unchecked"sv;
+    case opcode::op_divide_unchecked:
+      return "op_divide_unchecked"sv;
+    case opcode::op_greater_unchecked:
+      return "op_greater_unchecked"sv;
+    case opcode::op_greater_equal_unchecked:
+      return "op_greater_equal_unchecked"sv;
+    case opcode::op_less_unchecked:
+      return "op_less_unchecked"sv;
+    case opcode::op_less_equal_unchecked:
+      return "op_less_equal_unchecked"sv;
+    case opcode::op_get_local_get_local_add:
+      return "op_get_local_get_local_add"sv;
+    case opcode::op_get_local_constant_less_jump:
+      return "op_get_local_constant_less_jump"sv;
+    case opcode::op_get_local_constant_add_set_local_pop:
+      return "op_get_local_constant_add_set_local_pop"sv;
+    case opcode::op_add_rr:
+      return "op_add_rr"sv;
+    case opcode::op_add_rk:
+      return "op_add_rk"sv;
+    case opcode::op_subtract_rr:
+      return "op_subtract_rr"sv;
+    case opcode::op_subtract_rk:
+      return "op_subtract_rk"sv;
+    case opcode::op_multiply_rr:
+      return "op_multiply_rr"sv;
+    case opcode::op_multiply_rk:
+      return "op_multiply_rk"sv;
+    case opcode::op_divide_rr:
+      return "op_divide_rr"sv;
+    case opcode::op_divide_rk:
+      return "op_divide_rk"sv;
+    case opcode::op_greater_rr_jump:
+      return "op_greater_rr_jump"sv;
+    case opcode::op_greater_rk_jump:
+      return "op_greater_rk_jump"sv;
+    case opcode::op_greater_equal_rr_jump:
+      return "op_greater_equal_rr_jump"sv;
+    case opcode::op_greater_equal_rk_jump:
+      return "op_greater_equal_rk_jump"sv;
+    case opcode::op_less_rr_jump:
+      return "op_less_rr_jump"sv;
+    case opcode::op_less_rk_jump:
+      return "op_less_rk_jump"sv;
+    case opcode::op_less_equal_rr_jump:
+      return "op_less_equal_rr_jump"sv;
+    case opcode::op_less_equal_rk_jump:
+      return "op_less_equal_rk_jump"sv;
+    }
+    return "unknown"sv;
+  }
+
+  // size in bytes of the instruction starting at p_offset including its operands
+  size_t instruction_length(const chunk& p_chunk, size_t p_offset);
 } // namespace ok
 #endif // OK_CHUNK_HPP
\ No newline at end of file
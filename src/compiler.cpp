@@ -1,6 +1,7 @@
 #include "compiler.hpp"
 #include "ast.hpp"
 #include "chunk.hpp"
+#include "constant_folder.hpp"
 #include "constants.hpp"
 #include "copy.hpp"
 #include "debug.hpp"
@@ -8,11 +9,13 @@
 #include "macros.hpp"
 #include "object.hpp"
 #include "operator.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
 #include "token.hpp"
 #include "utf8.hpp"
 #include "utility.hpp"
 #include "value.hpp"
+#include "verifier.hpp"
 #include "vm.hpp"
 #include "vm_stack.hpp"
 #include <algorithm>
@@ -50,6 +53,104 @@ namespace ok
     Class* cls;
   };
 
+  // operator overloads, print and conversion methods run user code from instructions that are not calls
+  static bool declares_user_operators(const ast::statement* p_statement)
+  {
+    if(p_statement == nullptr)
+      return false;
+    switch(p_statement->get_type())
+    {
+    case ast::node_type::nt_block_stmt:
+      return std::ranges::any_of(((const ast::block_statement*)p_statement)->get_statement(),
+                                 [](const auto& p_inner) { return declares_user_operators(p_inner.get()); });
+    case ast::node_type::nt_if_stmt:
+    {
+      const auto if_stmt = (const ast::if_statement*)p_statement;
+      return declares_user_operators(if_stmt->get_consequence().get()) ||
+             declares_user_operators(if_stmt->get_alternative().get());
+    }
+    case ast::node_type::nt_while_stmt:
+      return declares_user_operators(((const ast::while_statement*)p_statement)->get_body().get());
+    case ast::node_type::nt_for_stmt:
+      return declares_user_operators(((const ast::for_statement*)p_statement)->get_body().get());
+    case ast::node_type::nt_function_decl:
+      return declares_user_operators(((const ast::function_declaration*)p_statement)->get_body().get());
+    case ast::node_type::nt_class_decl:
+      return std::ranges::any_of(((const ast::class_declaration*)p_statement)->get_methods(),
+                                 [](const auto& p_method)
+                                 {
+                                   using enum unique_overridable_operator_type;
+                                   return (p_method.type != uoot_method && p_method.type != uoot_ctor &&
+                                           p_method.type != uoot_dtor) ||
+                                          declares_user_operators(p_method.function->get_body().get());
+                                 });
+    default:
+      return false;
+    }
+  }
+
+  // bytecode a body is likely to take, so its chunk is reserved once instead of growing a few bytes at a time
+  static constexpr size_t estimated_statement_size = 16;
+  static size_t estimate_code_size(const ast::statement* p_body)
+  {
+    if(p_body == nullptr)
+      return 0;
+    if(p_body->get_type() != ast::node_type::nt_block_stmt)
+      return estimated_statement_size;
+    return ((const ast::block_statement*)p_body)->get_statement().size() * estimated_statement_size;
+  }
+
+  std::span<const compiler::compare_function> compiler::set_if_compare_functions()
+  {
+    static constexpr compare_function functions[] = {is_primitive};
+    return functions;
+  }
+
+  // the operand trailing a set_if, the compare's index in set_if_compare_functions plus one. an address would differ
+  // from one run to the next, so an image would have to patch it
+  static uint64_t set_if_operand(uint64_t p_set_if_compare)
+  {
+    const auto functions = compiler::set_if_compare_functions();
+    const auto it = std::ranges::find(functions, (compiler::compare_function)p_set_if_compare);
+    ASSERT(it != functions.end());
+    return it - functions.begin() + 1;
+  }
+
+  compiler& compiler::operator=(compiler&& p_other) noexcept
+  {
+    if(this == &p_other)
+      return *this;
+    // everything that points into the old arenas goes before them
+    m_inline_arguments.clear();
+    m_lazy_functions.clear();
+    m_constant_globals.clear();
+    m_program.reset();
+
+    m_arenas = std::move(p_other.m_arenas);
+    m_source = std::move(p_other.m_source);
+    m_vm = p_other.m_vm;
+    m_options = p_other.m_options;
+    m_function_contexts = std::move(p_other.m_function_contexts);
+    m_class_contexts = std::move(p_other.m_class_contexts);
+    m_constant_globals = std::move(p_other.m_constant_globals);
+    m_constant_global_count = p_other.m_constant_global_count;
+    m_constant_global_limit = p_other.m_constant_global_limit;
+    m_program = std::move(p_other.m_program);
+    m_retain_ast = p_other.m_retain_ast;
+    m_lazy_functions = std::move(p_other.m_lazy_functions);
+    m_conditional_depth = p_other.m_conditional_depth;
+    m_inline_arguments = std::move(p_other.m_inline_arguments);
+    m_user_operators = p_other.m_user_operators;
+    m_loop_stack = std::move(p_other.m_loop_stack);
+    m_errors = std::move(p_other.m_errors);
+    m_parse_errors = std::move(p_other.m_parse_errors);
+    m_compiled = p_other.m_compiled;
+    m_locals_count = p_other.m_locals_count;
+    m_scope_depth = p_other.m_scope_depth;
+    m_class_id = p_other.m_class_id;
+    return *this;
+  }
+
   function_object* compiler::compile(vm* p_vm,
                                      const std::string_view p_filename,
                                      const std::string_view p_src,
@@ -57,20 +158,45 @@ namespace ok
   {
     m_compiled = true;
     m_vm = p_vm;
-    lexer lx;
-    auto arr = lx.lex(p_src);
+    // tokens and so the ast view the source, lazy bodies compile after the caller let go of it
+    const auto src = m_options.lazy_functions ? std::string_view{m_source.assign(p_src)} : p_src;
 #ifdef PARANOID
     TRACELN("lexer output: {{");
-    for(auto tok : arr)
+    for(auto tok : lexer{}.lex(src))
       TRACELN("token: type: '{}', raw: '{}'", token_type_to_string(tok.type), tok.raw_literal);
     TRACELN("\n}}");
 #endif
-    parser prs{arr, p_filename, p_src};
-    auto root = prs.parse_program();
-    m_parse_errors = prs.get_errors();
-    if(!m_parse_errors.errs.empty() || root == nullptr)
-      return nullptr;
-    TRACELN("{}", root->to_string());
+    lexer lx;
+    lx.start(src);
+    auto* arena = m_arenas.emplace_back(std::make_unique<ast::arena>()).get();
+    parser prs{lx, arena, p_filename, src};
+    ast::ptr<ast::program> root;
+    if(!m_options.stream_declarations)
+    {
+      root = prs.parse_program();
+      m_parse_errors = prs.get_errors();
+      if(!m_parse_errors.errs.empty() || root == nullptr)
+        return nullptr;
+      if(m_options.constant_folding)
+      {
+        constant_folder::fold(*root, arena);
+      }
+      m_user_operators =
+          m_vm->has_user_operators() ||
+          std::ranges::any_of(root->get_statements(),
+                              [](const auto& p_statement) { return declares_user_operators(p_statement.get()); });
+      TRACELN("{}", root->to_string());
+    }
+    else
+    {
+      if(src.empty())
+        return nullptr; // as parse_program does
+      // the declarations arent all known up front, any 'operator' at all in the source counts, even in a comment
+      m_user_operators = m_vm->has_user_operators() || src.find("operator") != std::string_view::npos;
+      m_program = ast::make<ast::program>(arena, ast::list<ast::statement>(arena));
+      // the declarations go to an arena of their own that is reset after each one, m_program keeps the first
+      prs.set_arena(m_arenas.emplace_back(std::make_unique<ast::arena>()).get());
+    }
     // top level script function
     {
       get_vm_gc().guard_value(value_t{copy{(object*)p_function_name}});
@@ -80,8 +206,30 @@ namespace ok
            compile_function::type::script});
       get_vm_gc().letgo_value();
       scope_guard<compiler> guard{&compiler::begin_scope, &compiler::end_scope, this};
-      compile(root.get());
+      if(root != nullptr)
+      {
+        current_chunk()->code.reserve(root->get_statements().size() * estimated_statement_size);
+        compile(root.get());
+      }
+      else
+        compile_declarations(prs);
       emit_return(0);
+      optimize_function();
+    }
+    if(root == nullptr)
+    {
+      m_parse_errors = prs.get_errors();
+      if(!m_parse_errors.errs.empty())
+        return nullptr;
+    }
+    else if(!m_lazy_functions.empty())
+    {
+      m_program = std::move(root);
+    }
+    else
+    {
+      root = nullptr;
+      m_arenas.clear();
     }
 #ifdef PARANOID
     debug::disassembler::disassemble_chunk(*current_chunk(), current_function().function->name->chars);
@@ -188,6 +336,34 @@ namespace ok
     }
   }
 
+  // compiles every top level declaration right after it is parsed and frees its ast, so memory follows the largest
+  // declaration and not the whole script. the ones the compiler kept pointers into (constant global literals,
+  // inlinable and lazy functions) move to m_program instead, along with the arena they were parsed into
+  void compiler::compile_declarations(parser& p_parser)
+  {
+    while(!p_parser.at_end())
+    {
+      auto statement = p_parser.parse_top_level_declaration();
+      // after a parse error keep parsing to report the rest, but the ast may have holes so nothing more compiles
+      if(statement == nullptr || !p_parser.get_errors().errs.empty())
+        continue;
+      if(m_options.constant_folding)
+        constant_folder::fold(statement, p_parser.get_arena());
+      m_retain_ast = false;
+      compile(statement.get());
+      if(m_retain_ast)
+      {
+        m_program->get_statements().push_back(std::move(statement));
+        p_parser.set_arena(m_arenas.emplace_back(std::make_unique<ast::arena>()).get());
+      }
+      else
+      {
+        statement = nullptr;
+        m_arenas.back()->release();
+      }
+    }
+  }
+
   void compiler::compile(ast::expression_statement* p_expr_stmt)
   {
     const auto& expr = p_expr_stmt->get_expression();
@@ -455,6 +631,126 @@ namespace ok
     return (p_vdf & variable_declaration_flags::vdf_mutable) != variable_declaration_flags::vdf_none;
   }
 
+  // calls to a function whose body is a single expression of at most this many nodes get inlined
+  constexpr size_t inline_node_budget = 16;
+
+  // only what reads the parameters, so the body means the same wherever it is pasted and never calls itself. the
+  // parameters are replaced by the arguments so nothing may assign them
+  static bool fits_inline_budget(const ast::expression* p_expr,
+                                 const ast::list<ast::binding>& p_params,
+                                 size_t& p_budget)
+  {
+    if(p_budget == 0)
+      return false;
+    --p_budget;
+    switch(p_expr->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+    case ast::node_type::nt_string_expr:
+    case ast::node_type::nt_boolean_expr:
+    case ast::node_type::nt_null_expr:
+      return true;
+    case ast::node_type::nt_identifier_expr:
+    {
+      const auto& name = ((const ast::identifier_expression*)p_expr)->get_value();
+      return std::ranges::any_of(p_params, [&](const auto& p_param) { return p_param->get_name() == name; });
+    }
+    case ast::node_type::nt_prefix_expr:
+    {
+      const auto prefix = (const ast::prefix_unary_expression*)p_expr;
+      const auto op = prefix->get_operator();
+      return op != operator_type::op_plus_plus && op != operator_type::op_minus_minus &&
+             fits_inline_budget(prefix->get_right().get(), p_params, p_budget);
+    }
+    case ast::node_type::nt_infix_binary_expr:
+    {
+      const auto infix = (const ast::infix_binary_expression*)p_expr;
+      return fits_inline_budget(infix->get_left().get(), p_params, p_budget) &&
+             fits_inline_budget(infix->get_right().get(), p_params, p_budget);
+    }
+    case ast::node_type::nt_access_expr:
+    {
+      const auto access = (const ast::access_expression*)p_expr;
+      return !access->is_invoke() && fits_inline_budget(access->get_target().get(), p_params, p_budget);
+    }
+    default:
+      return false;
+    }
+  }
+
+  // the expression a function body boils down to, '-> return e;', '{ return e; }', '-> e;' or '{ e; }'. p_returns is
+  // false for the last two, the call then evaluates to null
+  static ast::expression* inline_expression(ast::function_declaration* p_function, bool& p_returns)
+  {
+    auto body = p_function->get_body().get();
+    if(body->get_type() == ast::node_type::nt_block_stmt)
+    {
+      auto& statements = ((ast::block_statement*)body)->get_statement();
+      if(statements.size() != 1)
+        return nullptr;
+      body = statements.front().get();
+    }
+
+    ast::expression* expr = nullptr;
+    if(body->get_type() == ast::node_type::nt_return_stmt)
+      expr = ((ast::return_statement*)body)->get_expression().get();
+    else if(body->get_type() == ast::node_type::nt_expression_statement_stmt)
+      expr = ((ast::expression_statement*)body)->get_expression().get();
+    p_returns = body->get_type() == ast::node_type::nt_return_stmt;
+
+    size_t budget = inline_node_budget;
+    if(expr == nullptr || !fits_inline_budget(expr, p_function->get_parameters(), budget))
+      return nullptr;
+    return expr;
+  }
+
+  // whether p_expr reads the parameters in the order they are declared, p_next is the first one it may still read
+  static bool reads_in_order(const ast::expression* p_expr, const ast::list<ast::binding>& p_params, size_t& p_next)
+  {
+    switch(p_expr->get_type())
+    {
+    case ast::node_type::nt_identifier_expr:
+    {
+      const auto& name = ((const ast::identifier_expression*)p_expr)->get_value();
+      const auto param =
+          std::ranges::find_if(p_params, [&](const auto& p_param) { return p_param->get_name() == name; });
+      if(param == p_params.end())
+        return true;
+      const size_t index = param - p_params.begin();
+      if(index + 1 < p_next)
+        return false; // reading the last one again is fine, one before it is not
+      p_next = index + 1;
+      return true;
+    }
+    case ast::node_type::nt_prefix_expr:
+      return reads_in_order(((const ast::prefix_unary_expression*)p_expr)->get_right().get(), p_params, p_next);
+    case ast::node_type::nt_infix_binary_expr:
+    {
+      const auto infix = (const ast::infix_binary_expression*)p_expr;
+      return reads_in_order(infix->get_left().get(), p_params, p_next) &&
+             reads_in_order(infix->get_right().get(), p_params, p_next);
+    }
+    case ast::node_type::nt_access_expr:
+      return reads_in_order(((const ast::access_expression*)p_expr)->get_target().get(), p_params, p_next);
+    default:
+      return true;
+    }
+  }
+
+  static bool is_literal(const ast::expression* p_expr)
+  {
+    switch(p_expr->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+    case ast::node_type::nt_string_expr:
+    case ast::node_type::nt_boolean_expr:
+    case ast::node_type::nt_null_expr:
+      return true;
+    default:
+      return false;
+    }
+  }
+
   void compiler::compile(ast::let_declaration* p_let_decl)
   {
     const auto& str_ident = p_let_decl->get_binding()->get_name();
@@ -471,6 +767,13 @@ namespace ok
     const auto declmods = p_let_decl->get_modifiers();
     const auto bindmods = p_let_decl->get_binding()->get_modifiers();
     declare_variable({str_ident, vdf_from_bm(bindmods)}, offset, is_global(declmods));
+
+    if(is_global(declmods) || m_scope_depth == 0)
+    {
+      const auto& value = p_let_decl->get_value();
+      const auto literal = is_mutable(vdf_from_bm(bindmods)) || !is_literal(value.get()) ? nullptr : value.get();
+      define_constant_global(str_ident, !is_mutable(vdf_from_bm(bindmods)), literal, nullptr);
+    }
   }
 
   void compiler::compile(ast::function_declaration* p_function_declaration)
@@ -489,11 +792,30 @@ namespace ok
     auto opt = declare_variable_late({str_name, vdf_from_bm(bindmods)}, binding->get_offset(), is_global(declmods));
     // auto opt = declare_variable(str_name, ident->get_offset());
 
-    do_compile_function(p_function_declaration, compile_function::type::function);
+    closure_object* closure = nullptr;
+    const auto constant = opt.has_value() && !is_mutable(vdf_from_bm(bindmods)) && can_be_constant_global();
+    do_compile_function(p_function_declaration, compile_function::type::function, constant ? &closure : nullptr);
+
+    bool returns;
+    const auto inlinable = m_options.inlining && !is_mutable(vdf_from_bm(bindmods)) &&
+                                   inline_expression(p_function_declaration, returns) != nullptr
+                               ? p_function_declaration
+                               : nullptr;
+    if(!opt.has_value() && inlinable != nullptr)
+    {
+      const auto index = resolve_local(str_name, offset, current_context());
+      if(index != UINT32_MAX)
+      {
+        get_locals()[index].inlinable = inlinable;
+        m_retain_ast = true;
+      }
+    }
 
     if(opt.has_value())
     {
       declare_global(opt.value(), vdf_from_bm(bindmods), offset);
+      define_constant_global(
+          str_name, !is_mutable(vdf_from_bm(bindmods)), nullptr, closure, closure != nullptr ? inlinable : nullptr);
       // auto res = opt.value();
       // if(res > UINT8_MAX)
       // {
@@ -509,7 +831,9 @@ namespace ok
     }
   }
 
-  void compiler::do_compile_function(ast::function_declaration* p_function_declaration, compile_function::type p_type)
+  void compiler::do_compile_function(ast::function_declaration* p_function_declaration,
+                                     compile_function::type p_type,
+                                     closure_object** p_out_closure)
   {
     auto& binding = p_function_declaration->get_binding();
     if(binding == nullptr)
@@ -529,16 +853,23 @@ namespace ok
     get_vm_gc().letgo_value();
     scope_guard<compiler> guard{&compiler::begin_scope, &compiler::end_scope, this};
 
-    for(const auto& param : params)
+    if(!defer_function_body(p_function_declaration, p_type))
     {
-      declare_variable({param->get_name(), vdf_from_bm(param->get_modifiers())}, param->get_offset(), false);
+      compile_function_body(p_function_declaration);
     }
-    compile(p_function_declaration->get_body().get());
-    emit_return(p_function_declaration->get_offset());
     auto fun = current_function();
-    fun.function->arity = params.size();
     auto ups = m_function_contexts.back().upvalues;
     pop_function_context();
+    if(p_out_closure != nullptr && fun.function->upvalues == 0)
+    {
+      // nothing to capture, so the closure op_closure would make is the same every time
+      get_vm_gc().guard_value(value_t{copy{(object*)fun.function}});
+      *p_out_closure = new_tobject<closure_object>(
+          fun.function, m_vm->get_builtin_class(object_type::obj_closure), m_vm->get_objects_list());
+      get_vm_gc().letgo_value();
+      current_chunk()->write_constant(value_t{copy{(object*)*p_out_closure}}, binding->get_offset());
+      return;
+    }
     current_chunk()->write(opcode::op_closure, binding->get_offset());
     current_chunk()->write_constant(value_t{copy{(object*)fun.function}}, binding->get_offset());
     auto& ctx = m_function_contexts.back();
@@ -550,6 +881,251 @@ namespace ok
     }
   }
 
+  void compiler::compile_function_body(ast::function_declaration* p_function_declaration)
+  {
+    const auto& params = p_function_declaration->get_parameters();
+    current_chunk()->code.reserve(estimate_code_size(p_function_declaration->get_body().get()));
+    for(const auto& param : params)
+    {
+      declare_variable({param->get_name(), vdf_from_bm(param->get_modifiers())}, param->get_offset(), false);
+    }
+    compile(p_function_declaration->get_body().get());
+    emit_return(p_function_declaration->get_offset());
+    optimize_function();
+    current_function().function->arity = params.size();
+  }
+
+  namespace
+  {
+    // the names a function body reads or writes that it does not declare itself, so they resolve outside of it. a
+    // scope opens wherever the compiler may open one, a declaration is seen from where it is to the end of it, and
+    // anything unsure counts as free, which at worst captures a variable that is never used
+    class free_names
+    {
+    public:
+      // false for a node the compiler may not know
+      bool collect(const ast::node* p_node);
+
+      std::vector<std::string> names;
+
+    private:
+      bool collect_all(const auto& p_nodes)
+      {
+        return std::ranges::all_of(p_nodes, [this](const auto& p_node) { return collect(p_node.get()); });
+      }
+
+      bool collect_scoped(std::initializer_list<const ast::node*> p_nodes)
+      {
+        m_scopes.emplace_back();
+        const auto collected = std::ranges::all_of(p_nodes, [this](const auto* p_node) { return collect(p_node); });
+        m_scopes.pop_back();
+        return collected;
+      }
+
+      bool collect_function(const ast::function_declaration* p_function)
+      {
+        m_scopes.emplace_back();
+        for(const auto& param : p_function->get_parameters())
+          m_scopes.back().push_back(param->get_name());
+        const auto collected = collect(p_function->get_body().get());
+        m_scopes.pop_back();
+        return collected;
+      }
+
+      void declare(const std::string& p_name, ast::declaration_modifier p_modifiers)
+      {
+        // a glob is not a local, reads of it after the declaration still resolve outside
+        if(!m_scopes.empty() && !is_global(p_modifiers))
+          m_scopes.back().push_back(p_name);
+      }
+
+      void use(const std::string& p_name)
+      {
+        const auto declared = std::ranges::any_of(m_scopes,
+                                                  [&](const auto& p_scope)
+                                                  { return std::ranges::find(p_scope, p_name) != p_scope.end(); });
+        if(!declared && std::ranges::find(names, p_name) == names.end())
+          names.push_back(p_name);
+      }
+
+      std::vector<std::vector<std::string>> m_scopes;
+    };
+
+    bool free_names::collect(const ast::node* p_node)
+    {
+      if(p_node == nullptr)
+        return true;
+      switch(p_node->get_type())
+      {
+      case ast::node_type::nt_number_expr:
+      case ast::node_type::nt_string_expr:
+      case ast::node_type::nt_boolean_expr:
+      case ast::node_type::nt_null_expr:
+      case ast::node_type::nt_empty_stmt:
+      case ast::node_type::nt_control_flow_stmt:
+        return true;
+      case ast::node_type::nt_this_expr:
+        use("this");
+        return true;
+      case ast::node_type::nt_super_expr:
+        use("this");
+        use("super");
+        return collect_all(((const ast::super_expression*)p_node)->get_arguments());
+      case ast::node_type::nt_identifier_expr:
+        use(((const ast::identifier_expression*)p_node)->get_value());
+        return true;
+      case ast::node_type::nt_prefix_expr:
+        return collect(((const ast::prefix_unary_expression*)p_node)->get_right().get());
+      case ast::node_type::nt_postfix_unary_expr:
+        return collect(((const ast::postfix_unary_expression*)p_node)->get_left().get());
+      case ast::node_type::nt_infix_binary_expr:
+      {
+        const auto infix = (const ast::infix_binary_expression*)p_node;
+        return collect(infix->get_left().get()) && collect(infix->get_right().get());
+      }
+      case ast::node_type::nt_assign_expr:
+      {
+        const auto assign = (const ast::assign_expression*)p_node;
+        return collect(assign->get_left().get()) && collect(assign->get_right().get());
+      }
+      case ast::node_type::nt_access_expr:
+      {
+        const auto access = (const ast::access_expression*)p_node;
+        return collect(access->get_target().get()) && collect_all(access->get_arguments_list());
+      }
+      case ast::node_type::nt_call_expr:
+      {
+        const auto call = (const ast::call_expression*)p_node;
+        return collect(call->get_callable().get()) && collect_all(call->get_arguments());
+      }
+      case ast::node_type::nt_expression_statement_stmt:
+        return collect(((const ast::expression_statement*)p_node)->get_expression().get());
+      case ast::node_type::nt_print_stmt:
+        return collect(((const ast::print_statement*)p_node)->get_expression().get());
+      case ast::node_type::nt_return_stmt:
+        return collect(((const ast::return_statement*)p_node)->get_expression().get());
+      case ast::node_type::nt_let_decl:
+      {
+        const auto let = (const ast::let_declaration*)p_node;
+        const auto collected = collect(let->get_value().get());
+        declare(let->get_binding()->get_name(), let->get_modifiers());
+        return collected;
+      }
+      case ast::node_type::nt_block_stmt:
+      {
+        m_scopes.emplace_back();
+        const auto collected = collect_all(((const ast::block_statement*)p_node)->get_statement());
+        m_scopes.pop_back();
+        return collected;
+      }
+      case ast::node_type::nt_if_stmt:
+      {
+        const auto if_stmt = (const ast::if_statement*)p_node;
+        return collect(if_stmt->get_expression().get()) && collect_scoped({if_stmt->get_consequence().get()}) &&
+               collect_scoped({if_stmt->get_alternative().get()});
+      }
+      case ast::node_type::nt_while_stmt:
+      {
+        const auto while_stmt = (const ast::while_statement*)p_node;
+        return collect(while_stmt->get_expression().get()) && collect_scoped({while_stmt->get_body().get()});
+      }
+      case ast::node_type::nt_for_stmt:
+      {
+        const auto for_stmt = (const ast::for_statement*)p_node;
+        return collect_scoped({for_stmt->get_initializer().get(),
+                               for_stmt->get_condition().get(),
+                               for_stmt->get_increment().get(),
+                               for_stmt->get_body().get()});
+      }
+      case ast::node_type::nt_function_decl:
+      {
+        // declared before its body so it can call itself
+        const auto function = (const ast::function_declaration*)p_node;
+        if(function->get_binding() != nullptr)
+          declare(function->get_binding()->get_name(), function->get_modifiers());
+        return collect_function(function);
+      }
+      case ast::node_type::nt_class_decl:
+      {
+        const auto class_decl = (const ast::class_declaration*)p_node;
+        if(class_decl->get_binding() != nullptr)
+          declare(class_decl->get_binding()->get_name(), class_decl->get_modifiers());
+        if(class_decl->get_super() != nullptr)
+          use(class_decl->get_super()->get_value());
+        return std::ranges::all_of(class_decl->get_methods(),
+                                   [this](const auto& p_method) { return collect_function(p_method.function.get()); });
+      }
+      default:
+        return false;
+      }
+    }
+  } // namespace
+
+  bool compiler::defer_function_body(ast::function_declaration* p_function_declaration, compile_function::type p_type)
+  {
+    // a body only defers when nothing around it but its captures changes how it compiles. one small enough to be
+    // inlined is compiled right away, its calls may never reach it to report its errors
+    bool returns;
+    if(!m_options.lazy_functions || p_type != compile_function::type::function || !m_class_contexts.empty() ||
+       !m_loop_stack.empty() || !m_inline_arguments.empty() ||
+       inline_expression(p_function_declaration, returns) != nullptr)
+      return false;
+    // a parameter declared twice is an error in the signature, it is reported where the function is as without --lazy
+    const auto& params = p_function_declaration->get_parameters();
+    for(size_t i = 0; i < params.size(); ++i)
+    {
+      for(size_t j = 0; j < i; ++j)
+      {
+        if(params[i]->get_name() == params[j]->get_name())
+          return false;
+      }
+    }
+    free_names free;
+    if(!free.collect(p_function_declaration->get_body().get()))
+      return false;
+
+    // the enclosing functions are gone by the first call, so every enclosing variable the body may refer to is
+    // captured now, the same way compile would have on reaching it
+    auto lazy = std::make_unique<lazy_function>();
+    lazy->declaration = p_function_declaration;
+    lazy->scope_depth = m_scope_depth;
+    lazy->constant_globals = m_constant_global_count;
+    for(const auto& name : free.names)
+    {
+      local loc;
+      const auto upvalue = resolve_upvalue(name, p_function_declaration->get_offset(), 0, &loc);
+      if(upvalue != UINT32_MAX)
+        lazy->captures.push_back({name, upvalue, loc});
+    }
+    lazy->upvalues = current_context().upvalues;
+    current_function().function->lazy = lazy.get();
+    m_lazy_functions.push_back(std::move(lazy));
+    m_retain_ast = true;
+    return true;
+  }
+
+  bool compiler::compile_lazy(function_object* p_function)
+  {
+    ASSERT(m_compiled && p_function->lazy != nullptr);
+    const auto* lazy = p_function->lazy;
+    p_function->lazy = nullptr;
+    m_errors = {};
+    const auto scope_depth = std::exchange(m_scope_depth, lazy->scope_depth);
+    const auto conditional_depth = std::exchange(m_conditional_depth, 0);
+    const auto constant_global_limit = std::exchange(m_constant_global_limit, lazy->constant_globals);
+
+    push_function_context({p_function, compile_function::type::function});
+    current_context().upvalues = lazy->upvalues;
+    current_context().lazy = lazy;
+    compile_function_body(lazy->declaration);
+    pop_function_context();
+
+    m_scope_depth = scope_depth;
+    m_conditional_depth = conditional_depth;
+    m_constant_global_limit = constant_global_limit;
+    return m_errors.errs.empty();
+  }
+
   void compiler::compile(ast::class_declaration* p_class_declaration)
   {
     auto& binding = p_class_declaration->get_binding();
@@ -768,7 +1344,26 @@ namespace ok
 
   void compiler::compile(ast::call_expression* p_call_expression)
   {
-    compile(p_call_expression->get_callable().get());
+    const auto callable = p_call_expression->get_callable().get();
+    if(callable->get_type() == ast::node_type::nt_access_expr &&
+       !((ast::access_expression*)callable)->is_invoke()) // parenthesized access
+    {
+      compile_access((ast::access_expression*)callable, &p_call_expression->get_arguments());
+      return;
+    }
+    if(callable->get_type() == ast::node_type::nt_super_expr && !((ast::super_expression*)callable)->is_invoke())
+    {
+      compile_super((ast::super_expression*)callable, &p_call_expression->get_arguments());
+      return;
+    }
+    if(m_options.inlining && callable->get_type() == ast::node_type::nt_identifier_expr)
+    {
+      const auto callee = find_inlinable(((ast::identifier_expression*)callable)->get_value());
+      if(callee != nullptr &&
+         inline_call(callee, p_call_expression->get_arguments(), p_call_expression->get_offset()))
+        return;
+    }
+    compile(callable);
     auto i = compile_arguments_list(p_call_expression->get_arguments());
     current_chunk()->write(opcode::op_call, p_call_expression->get_offset());
     current_chunk()->write(i, p_call_expression->get_offset());
@@ -776,13 +1371,29 @@ namespace ok
 
   void compiler::compile(ast::access_expression* p_access_expression)
   {
+    compile_access(p_access_expression,
+                   p_access_expression->is_invoke() ? &p_access_expression->get_arguments_list() : nullptr);
+  }
+
+  void compiler::compile_access(ast::access_expression* p_access_expression, const ast::list<ast::expression>* p_args)
+  {
+    if(p_args == nullptr && p_access_expression->get_target()->get_type() == ast::node_type::nt_this_expr)
+    {
+      // loaded ahead of the loop this is in, see hoist_loop_invariants
+      const auto hidden = "this." + p_access_expression->get_property()->get_value();
+      if(resolve_local(hidden, 0, current_context()) != UINT32_MAX)
+      {
+        named_variable(hidden, p_access_expression->get_offset(), variable_operation::vo_get);
+        return;
+      }
+    }
     compile(p_access_expression->get_target().get());
     const auto property_name = current_chunk()->add_identifier(
         value_t{p_access_expression->get_property()->get_value()}, p_access_expression->get_property()->get_offset());
     const auto offset = p_access_expression->get_offset();
-    if(p_access_expression->is_invoke())
+    if(p_args != nullptr)
     {
-      invoke_property(property_name, p_access_expression->get_arguments_list(), offset);
+      invoke_property(property_name, *p_args, offset);
     }
     else
     {
@@ -801,6 +1412,7 @@ namespace ok
 
   void compiler::compile(ast::if_statement* p_if_statement)
   {
+    m_conditional_depth++;
     compile(p_if_statement->get_expression().get());
     auto offset = p_if_statement->get_offset();
 
@@ -820,10 +1432,218 @@ namespace ok
     }
     patch_jump(else_jump, current_chunk()->code.size());
     // current_chunk()->write(opcode::op_pop, offset);
+    m_conditional_depth--;
+  }
+
+  namespace
+  {
+    // what a loop does, gathered before it is compiled to find the loads that give the same value on every iteration
+    struct loop_scan
+    {
+      std::vector<std::string> reads;           // identifiers read
+      std::vector<std::string> writes;          // identifiers assigned
+      std::vector<std::string> this_reads;      // 'this.name' reads
+      std::vector<std::string> property_writes; // 'any.name' assignments, on whatever object
+      bool calls = false;     // calls, invokes, super and anything the scan does not look into
+      bool operators = false; // operators, print and 'as', they call user code when a class overloads them
+      bool logical = false;   // 'and' and 'or', their right operand may not run
+    };
+  } // namespace
+
+  static void scan_loop(const ast::node* p_node, loop_scan& p_scan);
+
+  static void scan_write(const ast::expression* p_target, loop_scan& p_scan)
+  {
+    if(p_target->get_type() == ast::node_type::nt_identifier_expr)
+    {
+      p_scan.writes.push_back(((const ast::identifier_expression*)p_target)->get_value());
+    }
+    else if(p_target->get_type() == ast::node_type::nt_access_expr)
+    {
+      const auto access = (const ast::access_expression*)p_target;
+      p_scan.property_writes.push_back(access->get_property()->get_value());
+      scan_loop(access->get_target().get(), p_scan);
+    }
+    else
+    {
+      p_scan.calls = true;
+    }
+  }
+
+  static void scan_loop(const ast::node* p_node, loop_scan& p_scan)
+  {
+    if(p_node == nullptr)
+      return;
+    switch(p_node->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+    case ast::node_type::nt_string_expr:
+    case ast::node_type::nt_boolean_expr:
+    case ast::node_type::nt_null_expr:
+    case ast::node_type::nt_this_expr:
+    case ast::node_type::nt_empty_stmt:
+    case ast::node_type::nt_control_flow_stmt:
+    // declaring runs nothing, and what the body captures is read when it is called, which is a call here
+    case ast::node_type::nt_function_decl:
+    case ast::node_type::nt_class_decl:
+      break;
+    case ast::node_type::nt_identifier_expr:
+      p_scan.reads.push_back(((const ast::identifier_expression*)p_node)->get_value());
+      break;
+    case ast::node_type::nt_prefix_expr:
+    {
+      const auto prefix = (const ast::prefix_unary_expression*)p_node;
+      p_scan.operators = true;
+      scan_loop(prefix->get_right().get(), p_scan);
+      if(prefix->get_operator() == operator_type::op_plus_plus || prefix->get_operator() == operator_type::op_minus_minus)
+        scan_write(prefix->get_right().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_postfix_unary_expr:
+    {
+      const auto postfix = (const ast::postfix_unary_expression*)p_node;
+      p_scan.operators = true;
+      scan_loop(postfix->get_left().get(), p_scan);
+      scan_write(postfix->get_left().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_infix_binary_expr:
+    {
+      const auto infix = (const ast::infix_binary_expression*)p_node;
+      const auto op = infix->get_operator();
+      (op == operator_type::op_and || op == operator_type::op_or ? p_scan.logical : p_scan.operators) = true;
+      scan_loop(infix->get_left().get(), p_scan);
+      scan_loop(infix->get_right().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_assign_expr:
+    {
+      const auto assign = (const ast::assign_expression*)p_node;
+      scan_write(assign->get_left().get(), p_scan);
+      scan_loop(assign->get_right().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_access_expr:
+    {
+      const auto access = (const ast::access_expression*)p_node;
+      if(access->is_invoke())
+        p_scan.calls = true;
+      else if(access->get_target()->get_type() == ast::node_type::nt_this_expr)
+        p_scan.this_reads.push_back(access->get_property()->get_value());
+      scan_loop(access->get_target().get(), p_scan);
+      for(const auto& arg : access->get_arguments_list())
+        scan_loop(arg.get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_call_expr:
+    {
+      const auto call = (const ast::call_expression*)p_node;
+      p_scan.calls = true;
+      scan_loop(call->get_callable().get(), p_scan);
+      for(const auto& arg : call->get_arguments())
+        scan_loop(arg.get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_expression_statement_stmt:
+      scan_loop(((const ast::expression_statement*)p_node)->get_expression().get(), p_scan);
+      break;
+    case ast::node_type::nt_print_stmt:
+      p_scan.operators = true;
+      scan_loop(((const ast::print_statement*)p_node)->get_expression().get(), p_scan);
+      break;
+    case ast::node_type::nt_return_stmt:
+      scan_loop(((const ast::return_statement*)p_node)->get_expression().get(), p_scan);
+      break;
+    case ast::node_type::nt_let_decl:
+      scan_loop(((const ast::let_declaration*)p_node)->get_value().get(), p_scan);
+      break;
+    case ast::node_type::nt_block_stmt:
+      for(const auto& statement : ((const ast::block_statement*)p_node)->get_statement())
+        scan_loop(statement.get(), p_scan);
+      break;
+    case ast::node_type::nt_if_stmt:
+    {
+      const auto if_stmt = (const ast::if_statement*)p_node;
+      scan_loop(if_stmt->get_expression().get(), p_scan);
+      scan_loop(if_stmt->get_consequence().get(), p_scan);
+      scan_loop(if_stmt->get_alternative().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_while_stmt:
+    {
+      const auto while_stmt = (const ast::while_statement*)p_node;
+      scan_loop(while_stmt->get_expression().get(), p_scan);
+      scan_loop(while_stmt->get_body().get(), p_scan);
+      break;
+    }
+    case ast::node_type::nt_for_stmt:
+    {
+      const auto for_stmt = (const ast::for_statement*)p_node;
+      scan_loop(for_stmt->get_initializer().get(), p_scan);
+      scan_loop(for_stmt->get_condition().get(), p_scan);
+      scan_loop(for_stmt->get_increment().get(), p_scan);
+      scan_loop(for_stmt->get_body().get(), p_scan);
+      break;
+    }
+    default:
+      p_scan.calls = true;
+      break;
+    }
+  }
+
+  static bool contains(const std::vector<std::string>& p_names, const std::string& p_name)
+  {
+    return std::ranges::find(p_names, p_name) != p_names.end();
+  }
+
+  void compiler::hoist_loop_invariants(const ast::expression* p_condition, const ast::node* p_body)
+  {
+    if(!m_options.loop_invariants)
+      return;
+    loop_scan condition;
+    scan_loop(p_condition, condition);
+    loop_scan loop = condition;
+    scan_loop(p_body, loop);
+
+    // an immutable global defined before the loop already holds the value every read in it gets
+    for(const auto& name : loop.reads)
+    {
+      const auto* global = find_constant_global(name);
+      if(global == nullptr || !global->invariant || global->literal != nullptr || global->closure != nullptr ||
+         contains(loop.writes, name))
+        continue;
+      const auto shadowed = std::ranges::any_of(m_function_contexts,
+                                                [&](const auto& p_context)
+                                                { return resolve_local(name, 0, p_context) != UINT32_MAX; });
+      if(shadowed)
+        continue; // also true once it is hoisted, reads in the loop resolve to the hoisted local
+      named_variable(name, p_condition->get_offset(), variable_operation::vo_get);
+      declare_variable({name, variable_declaration_flags::vdf_none}, p_condition->get_offset(), false);
+    }
+
+    // a field can change through anything that runs user code, and loading it may fail, so it is only loaded ahead
+    // when nothing in the loop can reach user code and the condition reads it on every entry anyway
+    const auto type = current_function().function_type;
+    if(type == compile_function::type::function || type == compile_function::type::script || loop.calls ||
+       (m_user_operators && loop.operators) || condition.logical)
+      return;
+    for(const auto& name : condition.this_reads)
+    {
+      const auto hidden = "this." + name;
+      if(contains(loop.property_writes, name) || resolve_local(hidden, 0, current_context()) != UINT32_MAX)
+        continue;
+      named_variable("this", p_condition->get_offset(), variable_operation::vo_get);
+      get_property(current_chunk()->add_identifier(value_t{name}, p_condition->get_offset()),
+                   p_condition->get_offset());
+      declare_variable({hidden, variable_declaration_flags::vdf_none}, p_condition->get_offset(), false);
+    }
   }
 
   void compiler::compile(ast::while_statement* p_while_statement)
   {
+    scope_guard<compiler> invariants{&compiler::begin_scope, &compiler::end_scope, this};
+    hoist_loop_invariants(p_while_statement->get_expression().get(), p_while_statement->get_body().get());
+    m_conditional_depth++;
     auto loop_start = current_chunk()->code.size();
     m_loop_stack.emplace_back();
     m_loop_stack.back().scope_depth = m_scope_depth;
@@ -840,10 +1660,12 @@ namespace ok
     m_loop_stack.back().continue_target = loop_start;
     patch_loop_context();
     m_loop_stack.pop_back();
+    m_conditional_depth--;
   }
 
   void compiler::compile(ast::for_statement* p_for_statement)
   {
+    m_conditional_depth++;
     auto prev_scope_depth = m_scope_depth;
     scope_guard<compiler> guard{&compiler::begin_scope, &compiler::end_scope, this};
 
@@ -852,6 +1674,11 @@ namespace ok
       if(init != nullptr)
         compile(init.get());
     }
+    if(p_for_statement->get_condition() != nullptr)
+    {
+      // after the initializer, which may be what sets up what the loop reads
+      hoist_loop_invariants(p_for_statement->get_condition().get(), p_for_statement);
+    }
     auto loop_start = current_chunk()->code.size();
     m_loop_stack.emplace_back();
     m_loop_stack.back().scope_depth = m_scope_depth;
@@ -898,6 +1725,7 @@ namespace ok
 
     patch_loop_context();
     m_loop_stack.pop_back();
+    m_conditional_depth--;
   }
 
   void compiler::compile(ast::control_flow_statement* p_control_flow_statement)
@@ -959,6 +1787,10 @@ namespace ok
   {
     const auto& str_val = p_ident_expr->get_value();
     const auto offset = p_ident_expr->get_offset();
+    if(compile_inline_argument(str_val))
+    {
+      return;
+    }
     named_variable(str_val, offset, variable_operation::vo_get);
   }
 
@@ -1034,28 +1866,19 @@ namespace ok
     local upvalue_loc;
     if((arg = resolve_local(str_ident, offset, m_function_contexts.back())) != UINT32_MAX) // local
     {
-      auto& curr_locals = get_locals();
-      for(long i = curr_locals.size() - 1; i > -1; i--)
+      if(arg > UINT8_MAX)
       {
-        auto& loc = curr_locals[i];
-        if(str_ident == loc.decl.name)
-        {
-          if(i > UINT8_MAX)
-          {
-            get_op = opcode::op_get_local_long;
-            set_op = opcode::op_set_local_long;
-            set_if_op = opcode::op_set_if_local_long;
-          }
-          else
-          {
-            get_op = opcode::op_get_local;
-            set_op = opcode::op_set_local;
-            set_if_op = opcode::op_set_if_local;
-          }
-          is_local = true;
-          break;
-        }
+        get_op = opcode::op_get_local_long;
+        set_op = opcode::op_set_local_long;
+        set_if_op = opcode::op_set_if_local_long;
       }
+      else
+      {
+        get_op = opcode::op_get_local;
+        set_op = opcode::op_set_local;
+        set_if_op = opcode::op_set_if_local;
+      }
+      is_local = true;
       value = arg;
     }
     else if((arg = resolve_upvalue(str_ident, offset, 0, &upvalue_loc)) != UINT32_MAX)
@@ -1075,6 +1898,10 @@ namespace ok
       value = arg;
       is_upvalue = true;
     }
+    else if(op == variable_operation::vo_get && load_constant_global(str_ident, offset))
+    {
+      return;
+    }
     else
     {
       auto glob = get_or_add_global(value_t{str_ident.c_str(), str_ident.size()}, offset);
@@ -1207,6 +2034,11 @@ namespace ok
   }
 
   void compiler::compile(ast::super_expression* p_super)
+  {
+    compile_super(p_super, p_super->is_invoke() ? &p_super->get_arguments() : nullptr);
+  }
+
+  void compiler::compile_super(ast::super_expression* p_super, const ast::list<ast::expression>* p_args)
   {
     if(current_class_context() == nullptr)
     {
@@ -1226,10 +2058,10 @@ namespace ok
     auto name = current_chunk()->add_identifier(value_t{copy{name_str}}, offset);
     named_variable("this", offset, variable_operation::vo_get);
     named_variable("super", offset, variable_operation::vo_get);
-    if(p_super->is_invoke())
+    if(p_args != nullptr)
     {
       auto invoke_offset = p_super->get_method()->get_offset();
-      auto argc = compile_arguments_list(p_super->get_arguments());
+      auto argc = compile_arguments_list(*p_args);
       if(name < op_constant_max_count)
       {
         current_chunk()->write(opcode::op_invoke_super, invoke_offset);
@@ -1276,7 +2108,7 @@ namespace ok
     patch_jump(jump, current_chunk()->code.size());
   }
 
-  uint8_t compiler::compile_arguments_list(const std::list<std::unique_ptr<ast::expression>>& p_list)
+  uint8_t compiler::compile_arguments_list(const ast::list<ast::expression>& p_list)
   {
     if(p_list.size() > UINT8_MAX)
     {
@@ -1291,6 +2123,82 @@ namespace ok
     return p_list.size();
   }
 
+  ast::function_declaration* compiler::find_inlinable(const std::string& p_name)
+  {
+    // same lookup order as named_variable, but a local of an enclosing function is not captured since the inlined
+    // body does not refer to it
+    for(auto context = m_function_contexts.rbegin(); context != m_function_contexts.rend(); ++context)
+    {
+      const auto index = resolve_local(p_name, 0, *context);
+      if(index != UINT32_MAX)
+        return context->locals[index].inlinable;
+    }
+    const auto* global = find_constant_global(p_name);
+    return global == nullptr ? nullptr : global->inlinable;
+  }
+
+  bool compiler::inline_call(ast::function_declaration* p_callee,
+                             const ast::list<ast::expression>& p_args,
+                             size_t p_offset)
+  {
+    bool returns;
+    const auto expr = inline_expression(p_callee, returns);
+    const auto& params = p_callee->get_parameters();
+    if(expr == nullptr || params.size() != p_args.size())
+      return false; // let the vm report the arity mismatch
+
+    // parameters are replaced by their argument expressions, which are then evaluated where and as often as the body
+    // reads them. so only arguments with no side effects qualify, literals and locals, and the body has to read them
+    // in the order the call would have. a mutable local could still be changed half way by user code the body runs,
+    // an operator overload say, through a closure that captured it
+    size_t next = 0;
+    if(!reads_in_order(expr, params, next))
+      return false;
+    inline_arguments arguments;
+    auto arg = p_args.begin();
+    for(const auto& param : params)
+    {
+      const auto argument = arg++->get();
+      if(!is_literal(argument))
+      {
+        if(argument->get_type() != ast::node_type::nt_identifier_expr)
+          return false;
+        const auto index = resolve_local(((ast::identifier_expression*)argument)->get_value(), 0, current_context());
+        if(index == UINT32_MAX || (m_user_operators && is_mutable(get_locals()[index].decl.flags)))
+          return false;
+      }
+      arguments.emplace_back(param->get_name(), argument);
+    }
+
+    m_inline_arguments.push_back(std::move(arguments));
+    compile(expr);
+    m_inline_arguments.pop_back();
+    if(!returns)
+    {
+      current_chunk()->write(opcode::op_pop, p_offset);
+      current_chunk()->write(opcode::op_null, p_offset);
+    }
+    return true;
+  }
+
+  bool compiler::compile_inline_argument(const std::string& p_name)
+  {
+    if(m_inline_arguments.empty())
+      return false;
+    const auto& arguments = m_inline_arguments.back();
+    const auto it = std::ranges::find(arguments, p_name, &inline_arguments::value_type::first);
+    if(it == arguments.end())
+      return false;
+
+    // the argument belongs to the caller, so it is compiled without the callee's parameters in scope
+    const auto argument = it->second;
+    auto callee_arguments = std::move(m_inline_arguments.back());
+    m_inline_arguments.pop_back();
+    compile(argument);
+    m_inline_arguments.push_back(std::move(callee_arguments));
+    return true;
+  }
+
   void compiler::get_property(uint32_t p_property_name, size_t p_offset)
   {
     if(is_long(p_property_name))
@@ -1332,12 +2240,12 @@ namespace ok
         current_chunk()->write(opcode::op_set_if_property, p_offset);
         current_chunk()->write(p_property_name, p_offset);
       }
-      current_chunk()->write(encode_int<uint64_t, 8>(p_set_if_compare), p_offset);
+      current_chunk()->write(encode_int<uint64_t, 8>(set_if_operand(p_set_if_compare)), p_offset);
     }
   }
 
   void compiler::invoke_property(uint32_t p_property_name,
-                                 const std::list<std::unique_ptr<ast::expression>>& p_argslist,
+                                 const ast::list<ast::expression>& p_argslist,
                                  size_t p_offset)
   {
     const auto argc = compile_arguments_list(p_argslist);
@@ -1436,12 +2344,34 @@ namespace ok
     function_context ctx;
     ctx.function = p_function;
     m_function_contexts.push_back(ctx);
-    get_locals().push_back(local{{p_function.function_type != compile_function::type::function ? "this" : ""}, 0});
+    m_function_contexts.back().push_local(
+        local{{p_function.function_type != compile_function::type::function ? "this" : ""}, 0});
+  }
+
+  void compiler::function_context::push_local(const local& p_local)
+  {
+    const uint32_t index = locals.size();
+    auto [it, added] = local_indices.try_emplace(p_local.decl.name, index);
+    shadowed.push_back(added ? UINT32_MAX : std::exchange(it->second, index));
+    locals.push_back(p_local);
+  }
+
+  void compiler::function_context::pop_local()
+  {
+    ASSERT(!locals.empty());
+    const auto outer = shadowed.back();
+    if(outer == UINT32_MAX)
+      local_indices.erase(locals.back().decl.name);
+    else
+      local_indices[locals.back().decl.name] = outer;
+    shadowed.pop_back();
+    locals.pop_back();
   }
 
   void compiler::pop_function_context()
   {
     ASSERT(!m_function_contexts.empty());
+    current_chunk()->release_indices();
     m_function_contexts.pop_back();
   }
 
@@ -1503,7 +2433,7 @@ namespace ok
       removed_count++;
       if(curr_locals.back().is_captured)
         current_chunk()->write(opcode::op_close_upvalue, 0);
-      curr_locals.pop_back();
+      current_context().pop_local();
     }
     if(removed_count != 0)
     {
@@ -1614,21 +2544,17 @@ namespace ok
     if(!bypass_local && m_scope_depth > 0)
     {
       auto& curr_locals = get_locals();
-      for(uint32_t i = curr_locals.size() - 1; i >= 0; --i)
+      // the innermost local of that name is the only one that can be in this scope
+      const auto existing = resolve_local(p_decl.name, p_offset, current_context());
+      if(existing != UINT32_MAX && curr_locals[existing].depth >= m_scope_depth)
       {
-        auto& loc = curr_locals[i];
-        if(loc.depth < m_scope_depth)
-          break;
-        if(p_decl.name == loc.decl.name)
-        {
-          compile_error(error::code::local_redefinition, "redefinition of '{}' in same scope", p_decl.name);
-          return;
-        }
+        compile_error(error::code::local_redefinition, "redefinition of '{}' in same scope", p_decl.name);
+        return;
       }
       if(curr_locals.size() > uint24_max)
         compile_error(
             error::code::local_count_exceeds_limit, "too many local variables, exceeds limit which is: {}", uint24_max);
-      curr_locals.emplace_back(p_decl, m_scope_depth);
+      current_context().push_local(local{p_decl, m_scope_depth});
       return;
     }
     // global
@@ -1666,21 +2592,17 @@ namespace ok
     if(!bypass_local && m_scope_depth > 0)
     {
       auto& curr_locals = get_locals();
-      for(uint32_t i = curr_locals.size() - 1; i >= 0; --i)
+      // the innermost local of that name is the only one that can be in this scope
+      const auto existing = resolve_local(p_decl.name, p_offset, current_context());
+      if(existing != UINT32_MAX && curr_locals[existing].depth >= m_scope_depth)
       {
-        auto& loc = curr_locals[i];
-        if(loc.depth < m_scope_depth)
-          break;
-        if(p_decl.name == loc.decl.name)
-        {
-          compile_error(error::code::local_redefinition, "redefinition of '{}' in same scope", p_decl.name);
-          return {};
-        }
+        compile_error(error::code::local_redefinition, "redefinition of '{}' in same scope", p_decl.name);
+        return {};
       }
       if(curr_locals.size() > uint24_max)
         compile_error(
             error::code::local_count_exceeds_limit, "too many local variables, exceeds limit which is: {}", uint24_max);
-      curr_locals.emplace_back(p_decl, m_scope_depth);
+      current_context().push_local(local{p_decl, m_scope_depth});
       return {};
     }
     return {add_global(value_t{p_decl.name}, p_offset)};
@@ -1690,16 +2612,14 @@ namespace ok
   {
     if(p_global < op__global_max_count)
     {
-      current_chunk()->write(opcode::op_define_global, p_offset);
-      current_chunk()->write(p_global, p_offset);
-      current_chunk()->write(to_utype(p_flags), p_offset);
+      current_chunk()->write(
+          opcode::op_define_global, std::array{static_cast<byte>(p_global), to_utype(p_flags)}, p_offset);
     }
     else if(p_global < op__global_long_max_count)
     {
-      current_chunk()->write(opcode::op_define_global_long, p_offset);
       const auto span = encode_int<size_t, 3>(p_global);
-      current_chunk()->write(span, p_offset);
-      current_chunk()->write(to_utype(p_flags), p_offset);
+      current_chunk()->write(
+          opcode::op_define_global_long, std::array{span[0], span[1], span[2], to_utype(p_flags)}, p_offset);
     }
     else
     {
@@ -1709,18 +2629,74 @@ namespace ok
     }
   }
 
-  uint32_t compiler::resolve_local(const std::string& p_str_ident, size_t p_offset, const function_context& p_context)
+  bool compiler::can_be_constant_global() const
   {
-    auto& curr_locals = p_context.locals;
-    for(long i = curr_locals.size() - 1; i > -1; i--)
+    // a glob declared in a function or under an if or a loop may run any number of times, including none
+    return m_options.constant_globals && m_function_contexts.size() == 1 && m_conditional_depth == 0;
+  }
+
+  void compiler::define_constant_global(const std::string& p_name,
+                                        bool p_immutable,
+                                        ast::expression* p_literal,
+                                        closure_object* p_closure,
+                                        ast::function_declaration* p_inlinable)
+  {
+    auto [it, inserted] = m_constant_globals.try_emplace(p_name);
+    if(!inserted || !can_be_constant_global())
     {
-      auto& loc = curr_locals[i];
-      if(p_str_ident == loc.decl.name)
-      {
-        return i;
-      }
+      // redefined, or maybe never defined at all, let the vm decide
+      it->second = {};
+      return;
     }
-    return UINT32_MAX;
+    it->second = {p_literal, p_closure, p_inlinable, p_immutable, m_constant_global_count++};
+    m_retain_ast |= p_literal != nullptr || p_inlinable != nullptr;
+  }
+
+  auto compiler::find_constant_global(const std::string& p_name) const -> const constant_global*
+  {
+    const auto it = m_constant_globals.find(p_name);
+    return it == m_constant_globals.end() || it->second.sequence >= m_constant_global_limit ? nullptr : &it->second;
+  }
+
+  bool compiler::load_constant_global(const std::string& p_name, size_t p_offset)
+  {
+    const auto* found = find_constant_global(p_name);
+    if(found == nullptr)
+      return false;
+    const auto& global = *found;
+    if(global.closure != nullptr)
+    {
+      current_chunk()->write_constant(value_t{copy{(object*)global.closure}}, p_offset);
+      return true;
+    }
+    if(global.literal == nullptr)
+      return false;
+    switch(global.literal->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+      current_chunk()->write_constant(value_t{((ast::number_expression*)global.literal)->get_value()}, p_offset);
+      break;
+    case ast::node_type::nt_string_expr:
+    {
+      const auto& str = ((ast::string_expression*)global.literal)->get_value();
+      current_chunk()->write_constant(value_t{str.c_str(), str.size()}, p_offset);
+      break;
+    }
+    case ast::node_type::nt_boolean_expr:
+      current_chunk()->write(((ast::boolean_expression*)global.literal)->get_value() ? opcode::op_true : opcode::op_false,
+                             p_offset);
+      break;
+    default:
+      current_chunk()->write(opcode::op_null, p_offset);
+      break;
+    }
+    return true;
+  }
+
+  uint32_t compiler::resolve_local(const std::string& p_str_ident, size_t p_offset, const function_context& p_context)
+  {
+    const auto it = p_context.local_indices.find(p_str_ident);
+    return it == p_context.local_indices.end() ? UINT32_MAX : it->second;
   }
 
   uint32_t compiler::resolve_upvalue(const std::string& str_ident,
@@ -1733,6 +2709,15 @@ namespace ok
       return UINT32_MAX;
 
     auto& ctx = m_function_contexts[m_function_contexts.size() - p_function_context_reverse_index - 1];
+    if(ctx.lazy != nullptr)
+    {
+      const auto capture = std::ranges::find(ctx.lazy->captures, str_ident, &lazy_function::capture::name);
+      if(capture == ctx.lazy->captures.end())
+        return UINT32_MAX;
+      if(p_loc)
+        *p_loc = capture->loc;
+      return capture->upvalue;
+    }
     auto& up_ctx = m_function_contexts[m_function_contexts.size() - p_function_context_reverse_index - 2];
     auto loc = resolve_local(str_ident, offset, up_ctx);
     if(loc != UINT32_MAX)
@@ -1750,14 +2735,11 @@ namespace ok
 
   uint32_t compiler::add_upvalue(uint32_t p_local, bool p_is_local, size_t offset, function_context& p_context)
   {
-    upvalue up;
+    upvalue up{};
     up.set_index(p_local);
     up.set_local(p_is_local);
-    for(size_t i = 0; i < p_context.upvalues.size(); ++i)
-    {
-      if(up.index == p_context.upvalues[i].index)
-        return i;
-    }
+    if(const auto it = p_context.upvalue_indices.find(up.index); it != p_context.upvalue_indices.end())
+      return it->second;
     if(p_context.upvalues.size() > uint24_max)
     {
       compile_error(error::code::upvalue_count_exceeds_limit,
@@ -1766,6 +2748,7 @@ namespace ok
                     uint24_max);
       return UINT32_MAX;
     }
+    p_context.upvalue_indices.emplace(up.index, p_context.upvalues.size());
     p_context.upvalues.push_back(up);
     auto sz = p_context.upvalues.size();
     p_context.function.function->upvalues = sz;
@@ -1776,18 +2759,15 @@ namespace ok
   {
     if(p_value > UINT8_MAX)
     {
-      current_chunk()->write(p_op, p_offset);
-      const auto span = encode_int<size_t, 3>(p_value);
-      current_chunk()->write(span, p_offset);
+      current_chunk()->write(p_op, encode_int<size_t, 3>(p_value), p_offset);
     }
     else
     {
-      current_chunk()->write(p_op, p_offset);
-      current_chunk()->write(p_value, p_offset);
+      current_chunk()->write(p_op, std::array{static_cast<byte>(p_value)}, p_offset);
     }
     if(p_set_if_compare != 0)
     {
-      current_chunk()->write(encode_int<uint64_t, 8>(p_set_if_compare), p_offset);
+      current_chunk()->write(encode_int<uint64_t, 8>(set_if_operand(p_set_if_compare)), p_offset);
     }
   }
 
@@ -1795,40 +2775,21 @@ namespace ok
   {
     ASSERT(p_global.type == value_type::object_val &&
            OK_VALUE_AS_OBJECT(p_global)->get_type() == object_type::obj_string);
-    auto* str_glob = OK_VALUE_AS_STRING_OBJECT(p_global);
-    auto it = m_globals.find(str_glob);
-    if(m_globals.end() == it)
-    {
-      // so we support late binding of globals, if this were strict get that could fail it will fail on first late
-      // bound global
-      return add_global(p_global, p_offset);
-    }
-
-    // TODO(Qais): this slow and started to be very messy, but idk this hack will fix identifiers not in the function
-    // identifiers table for now
-    for(const auto& g : current_function().function->associated_chunk.identifiers)
-    {
-      if(OK_VALUE_AS_STRING_OBJECT(g) == str_glob)
-      {
-        goto RET;
-      }
-    }
-    add_global(p_global, p_offset);
-  RET:
-    return it->second;
+    // an unknown name is added too, so we support late binding of globals, if this were strict get that could fail it
+    // will fail on first late bound global. a known one may still be missing from this function's identifiers table,
+    // add_identifier gives back its slot if it is there and adds it otherwise
+    return add_global(p_global, p_offset);
   }
 
   uint32_t compiler::add_global(value_t p_global, size_t p_offset, uint32_t p_identifiers_table_index)
   {
     auto glob = p_identifiers_table_index;
-    auto* str_glob = OK_VALUE_AS_STRING_OBJECT(p_global);
     if(p_identifiers_table_index == UINT32_MAX)
     {
       ASSERT(OK_IS_VALUE_OBJECT(p_global) && OK_IS_VALUE_STRING_OBJECT(p_global));
       const auto tp = OK_VALUE_AS_OBJECT(p_global)->get_type();
       glob = current_chunk()->add_identifier(p_global, p_offset);
     }
-    m_globals[str_glob] = glob;
     if(glob > op__global_long_max_count)
       compile_error(
           error::code::global_count_exceeds_limit, "too many global variables, exceeds limit which is: {}", uint24_max);
@@ -1874,6 +2835,34 @@ namespace ok
     current_chunk()->write(opcode::op_return, p_offset);
   }
 
+  void compiler::optimize_function()
+  {
+    // peephole and the register backend move code around, fusing only marks it in place so it goes last
+    if(m_options.peephole)
+    {
+      optimizer::peephole(*current_chunk());
+    }
+    const auto arity = current_function().function->arity;
+    if(m_options.type_inference)
+    {
+      optimizer::specialize_numbers(*current_chunk(), arity);
+    }
+    if(m_options.backend == backend_type::registers)
+    {
+      optimizer::allocate_registers(*current_chunk());
+    }
+    if(m_options.superinstructions)
+    {
+      optimizer::fuse_superinstructions(*current_chunk());
+    }
+    // nothing that runs unchecked instructions on values that may not be numbers leaves the compiler
+    if(!verifier::verify(*current_chunk(), arity))
+    {
+      ASSERT(false);
+      optimizer::despecialize_numbers(*current_chunk());
+    }
+  }
+
   void compiler::emit_loop(size_t p_loop_start, size_t p_offset)
   {
     constexpr auto OPERANDS_WIDTH = 3;
@@ -1893,8 +2882,7 @@ namespace ok
   size_t compiler::emit_jump(opcode jump_instruction, size_t p_offset)
   {
     constexpr auto OPERANDS_WIDTH = 3;
-    current_chunk()->write(jump_instruction, p_offset);
-    current_chunk()->write(encode_int<uint32_t, OPERANDS_WIDTH>(0), p_offset);
+    current_chunk()->write(jump_instruction, encode_int<uint32_t, OPERANDS_WIDTH>(0), p_offset);
     auto jump_start = current_chunk()->code.size() - OPERANDS_WIDTH;
     return jump_start;
   }
@@ -9,6 +9,8 @@
 #include "parser.hpp"
 #include <cstdint>
 #include <format>
+#include <memory>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -141,9 +143,51 @@ namespace ok
     };
 
   public:
+    enum class backend_type
+    {
+      stack,     // every operand goes through the vm stack
+      registers, // see optimizer::allocate_registers
+    };
+
+    struct options
+    {
+      backend_type backend = backend_type::stack;
+      bool constant_folding = true;     // see constant_folder::fold
+      bool constant_globals = true;     // see compiler::load_constant_global
+      bool inlining = true;             // see compiler::inline_call
+      bool loop_invariants = true;      // see compiler::hoist_loop_invariants
+      bool superinstructions = true;    // see optimizer::fuse_superinstructions
+      bool type_inference = true;       // see optimizer::specialize_numbers
+      uint32_t jit_threshold = 0;       // calls before a function goes to jit::compile, 0 keeps everything interpreted
+      uint32_t trace_threshold = 0;     // back edges before a loop gets recorded, 0 turns tracing off
+      bool lazy_functions = false;      // see compiler::compile_lazy, for a vm that compiles a single script
+      bool stream_declarations = false; // see compiler::compile_declarations
+#if defined(PARANOID)
+      bool peephole = false; // keep the disassembly close to what the compiler emitted
+#else
+      bool peephole = true; // see optimizer::peephole
+#endif
+    };
+
+    compiler() = default;
+    compiler(compiler&&) noexcept = default;
+    // the defaulted one would free the old arenas before the nodes and everything pointing into them
+    compiler& operator=(compiler&& p_other) noexcept;
+
+    void set_options(const options& p_options)
+    {
+      m_options = p_options;
+    }
+
+    // every function a set_if instruction can compare with, the instruction carries its index plus one
+    static std::span<const compare_function> set_if_compare_functions();
+
     // type is always string the name will determine the script being ran and the future namespace also the main
     function_object*
     compile(vm* p_vm, const std::string_view p_filename, const std::string_view p_src, string_object* p_function_name);
+    // compiles the body of a function compile left for its first call, false on compile errors. the ast of the script
+    // is kept until the compiler goes away, so this has to be the compiler that made p_function
+    bool compile_lazy(function_object* p_function);
     chunk* current_chunk() const
     {
       ASSERT(m_compiled);
@@ -205,6 +249,15 @@ namespace ok
       compile_function function;
       std::vector<local> locals;
       std::vector<upvalue> upvalues;
+      const lazy_function* lazy = nullptr; // the enclosing functions are gone, names outside resolve through it
+      // the innermost local of each name, the outer ones it shadows come back as it goes out of scope
+      std::unordered_map<std::string, uint32_t> local_indices;
+      std::vector<uint32_t> shadowed;                         // per local, the one of the same name it hides or none
+      std::unordered_map<uint32_t, uint32_t> upvalue_indices; // by upvalue::index, where it is in upvalues
+
+      // locals only come and go at the back, so both keep the index in step
+      void push_local(const local& p_local);
+      void pop_local();
     };
 
     struct class_context
@@ -212,11 +265,14 @@ namespace ok
       bool has_super = false;
     };
 
+    struct constant_global;
+
   private:
     // take by pointer to avoid moving and invalidating, since we compile directly and dont hold any reference this is
     // totally fine.
     void compile(ast::node* p_node);
     void compile(ast::program* p_program);
+    void compile_declarations(parser& p_parser);
     void compile(ast::expression_statement* p_expr_stmt);
     void compile(ast::number_expression* p_number);
     void compile(ast::prefix_unary_expression* p_unary);
@@ -244,9 +300,27 @@ namespace ok
     // only compiles invocation, set is handled in the assignment expr compile function!
     void compile(ast::access_expression* p_access_expression);
 
-    void compile_method(const ast::class_declaration::method_declaration& p_method);
+    // p_args is non null when the access is called right away, in that case it compiles to an invoke and no bound
+    // method is materialized, e.g. 'obj.m(...)', '(obj.m)(...)' and 'super.m(...)'
+    void compile_access(ast::access_expression* p_access_expression, const ast::list<ast::expression>* p_args);
+    void compile_super(ast::super_expression* p_super, const ast::list<ast::expression>* p_args);
 
-    void do_compile_function(ast::function_declaration* p_function_declaration, compile_function::type p_type);
+    void compile_method(const ast::class_declaration::method_declaration& p_method);
+    // loads what reads in the loop would get the same value from on every iteration once, into hidden locals of the
+    // enclosing scope. immutable globals keep their name so reads resolve to the local, 'this.name' fields are picked
+    // up by compile_access
+    void hoist_loop_invariants(const ast::expression* p_condition, const ast::node* p_body);
+
+    // p_out_closure, when given, asks for the closure to be created now and loaded as a constant, that only happens if
+    // the function captures nothing, otherwise it is left null and op_closure is emitted as usual
+    void do_compile_function(ast::function_declaration* p_function_declaration,
+                             compile_function::type p_type,
+                             closure_object** p_out_closure = nullptr);
+    // declares the parameters and compiles the body into the current function
+    void compile_function_body(ast::function_declaration* p_function_declaration);
+    // leaves the body of the current function to compile_lazy, resolving now every enclosing local it may capture.
+    // false when it can not be deferred
+    bool defer_function_body(ast::function_declaration* p_function_declaration, compile_function::type p_type);
     void push_function_context(compile_function p_function);
     void pop_function_context();
     compile_function current_function();
@@ -274,6 +348,18 @@ namespace ok
                                                   bool bypass_local,
                                                   uint32_t p_identifiers_table_index = UINT32_MAX);
     void declare_global(uint32_t p_global, variable_declaration_flags p_flags, size_t p_offset);
+    // an immutable global defined once, unconditionally, by the script itself has the same value for every read
+    // compiled after its definition
+    bool can_be_constant_global() const;
+    void define_constant_global(const std::string& p_name,
+                                bool p_immutable,
+                                ast::expression* p_literal,
+                                closure_object* p_closure,
+                                ast::function_declaration* p_inlinable = nullptr);
+    // emits the known value of p_name instead of an op_get_global, false if there is none
+    bool load_constant_global(const std::string& p_name, size_t p_offset);
+    // the constant global p_name as the code being compiled sees it, nullptr if there is none
+    const constant_global* find_constant_global(const std::string& p_name) const;
     uint32_t resolve_local(const std::string& str_ident, size_t offset, const function_context& p_context);
     uint32_t resolve_upvalue(const std::string& str_ident,
                              size_t offset,
@@ -289,6 +375,8 @@ namespace ok
     void emit_pops(uint32_t p_count);
 
     void emit_return(size_t p_offset);
+    // runs the enabled bytecode passes on the current function, after its last instruction was emitted
+    void optimize_function();
     void emit_loop(size_t p_loop_start, size_t p_offset);
     size_t emit_jump(opcode jump_instruction, size_t p_offset);
     void patch_jump(size_t start_position, size_t jump_position);
@@ -299,14 +387,19 @@ namespace ok
     void patch_ambiguation(unique_overridable_operator_type& p_uoot, uint8_t parity);
 
     void compile_logical_operator(ast::infix_binary_expression* p_logical_operator);
-    uint8_t compile_arguments_list(const std::list<std::unique_ptr<ast::expression>>& p_list);
+    uint8_t compile_arguments_list(const ast::list<ast::expression>& p_list);
+    // the function a call to p_name always reaches, if it is small enough to be inlined
+    ast::function_declaration* find_inlinable(const std::string& p_name);
+    // compiles the callee's body in place of the call with its parameters replaced by the arguments. false if the call
+    // has to go through op_call
+    bool inline_call(ast::function_declaration* p_callee, const ast::list<ast::expression>& p_args, size_t p_offset);
+    // compiles the argument p_name stands for in the body being inlined, false if it is not a parameter of it
+    bool compile_inline_argument(const std::string& p_name);
 
     // requires class to be precompiled, doesnt handle invoke
     void get_property(uint32_t p_property_name, size_t p_offset);
     void set_property(uint32_t p_property_name, size_t p_offset, uint64_t p_set_if_compare = 0);
-    void invoke_property(uint32_t p_property_name,
-                         const std::list<std::unique_ptr<ast::expression>>& p_argslist,
-                         size_t p_offset);
+    void invoke_property(uint32_t p_property_name, const ast::list<ast::expression>& p_argslist, size_t p_offset);
 
     void get_variable(uint32_t p_variable_name);
 
@@ -335,11 +428,35 @@ namespace ok
     }
 
   private:
+    // the nodes of m_program and of the streamed declarations, declared first so they are destroyed last. operator=
+    // moves every member, keep it in sync
+    std::vector<std::unique_ptr<ast::arena>> m_arenas;
+    std::string m_source; // owned only when lazy, m_program views it
     vm* m_vm = nullptr;
+    options m_options;
     std::vector<function_context> m_function_contexts;
     std::vector<class_context> m_class_contexts;
 
-    std::unordered_map<string_object*, uint32_t> m_globals;
+    struct constant_global
+    {
+      ast::expression* literal = nullptr; // reemitted on every read
+      closure_object* closure = nullptr;  // created at compile time, loaded as a constant
+      ast::function_declaration* inlinable = nullptr;
+      bool invariant = false; // immutable, so once defined every read gets the same value even if it is not known
+      uint32_t sequence = 0;  // definitions before this one
+    };
+    // all unset means the global was defined more than once, reads fall back to op_get_global so the vm reports it
+    std::unordered_map<std::string, constant_global> m_constant_globals;
+    uint32_t m_constant_global_count = 0;
+    // a lazy body sees only the constant globals defined before its function, as it would have compiled in place
+    uint32_t m_constant_global_limit = UINT32_MAX;
+    ast::ptr<ast::program> m_program; // kept for the lazy bodies, and streamed declarations still pointed into
+    bool m_retain_ast = false;        // the statement being streamed is pointed into, see compile_declarations
+    std::vector<std::unique_ptr<lazy_function>> m_lazy_functions;
+    uint32_t m_conditional_depth = 0; // if and loop bodies being compiled
+    using inline_arguments = std::vector<std::pair<std::string, ast::expression*>>;
+    std::vector<inline_arguments> m_inline_arguments; // parameter to argument, one entry per body being inlined
+    bool m_user_operators = false; // some class overloads an operator, print or 'as', so they may run user code
     std::vector<loop_context> m_loop_stack;
     errors m_errors;
     parser::errors m_parse_errors;
@@ -351,6 +468,21 @@ namespace ok
   private:
     friend class gc;
   };
+
+  struct lazy_function
+  {
+    struct capture
+    {
+      std::string name;
+      uint32_t upvalue;
+      local loc;
+    };
+    ast::function_declaration* declaration;
+    size_t scope_depth;        // in the body, as it was declared
+    uint32_t constant_globals; // defined before it
+    std::vector<compiler::upvalue> upvalues;
+    std::vector<capture> captures; // every enclosing variable the body names, with the upvalue it reads it through
+  };
 } // namespace ok
 
 #endif // OK_COMPILER_HPP
@@ -0,0 +1,350 @@
+#include "constant_folder.hpp"
+#include <format>
+
+namespace ok
+{
+  static void fold_statement(ast::ptr<ast::statement>& p_statement, std::pmr::memory_resource* p_arena);
+  static void fold_expression(ast::ptr<ast::expression>& p_expression, std::pmr::memory_resource* p_arena);
+
+  static bool is_literal(const ast::expression* p_expression)
+  {
+    switch(p_expression->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+    case ast::node_type::nt_string_expr:
+    case ast::node_type::nt_boolean_expr:
+    case ast::node_type::nt_null_expr:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static double as_number(const ast::expression* p_expression)
+  {
+    return static_cast<const ast::number_expression*>(p_expression)->get_value();
+  }
+
+  static bool as_bool(const ast::expression* p_expression)
+  {
+    return static_cast<const ast::boolean_expression*>(p_expression)->get_value();
+  }
+
+  static const std::string& as_string(const ast::expression* p_expression)
+  {
+    return static_cast<const ast::string_expression*>(p_expression)->get_value();
+  }
+
+  // folded nodes keep the line and offset of the operator they replace, errors dont point at them anyway, they have no
+  // source text to view so numbers and strings carry an empty literal
+  static ast::ptr<ast::expression> make_number(const token& p_at, double p_value, std::pmr::memory_resource* p_arena)
+  {
+    return ast::make<ast::number_expression>(
+        p_arena, token{token_type::tok_number, {}, p_at.line, p_at.offset}, p_value);
+  }
+
+  static ast::ptr<ast::expression> make_bool(const token& p_at, bool p_value, std::pmr::memory_resource* p_arena)
+  {
+    return ast::make<ast::boolean_expression>(
+        p_arena,
+        token{p_value ? token_type::tok_true : token_type::tok_false, p_value ? "true" : "false", p_at.line, p_at.offset},
+        p_value);
+  }
+
+  static ast::ptr<ast::expression> make_string(const token& p_at,
+                                               const std::string& p_value,
+                                               std::pmr::memory_resource* p_arena)
+  {
+    return ast::make<ast::string_expression>(
+        p_arena, token{token_type::tok_string, {}, p_at.line, p_at.offset}, p_value);
+  }
+
+  // mirrors vm::perform_equality_builtins, only valid when the lhs isnt an object
+  static bool builtin_equals(const ast::expression* p_lhs, const ast::expression* p_rhs)
+  {
+    if(p_lhs->get_type() != p_rhs->get_type())
+      return false;
+    switch(p_lhs->get_type())
+    {
+    case ast::node_type::nt_number_expr:
+      return as_number(p_lhs) == as_number(p_rhs);
+    case ast::node_type::nt_boolean_expr:
+      return as_bool(p_lhs) == as_bool(p_rhs);
+    default:
+      return true; // null
+    }
+  }
+
+  static ast::ptr<ast::expression> fold_prefix(ast::prefix_unary_expression* p_unary,
+                                               std::pmr::memory_resource* p_arena)
+  {
+    const auto right = p_unary->get_right().get();
+    const auto& at = p_unary->get_token();
+    switch(p_unary->get_operator())
+    {
+    case operator_type::op_minus:
+      if(right->get_type() == ast::node_type::nt_number_expr)
+        return make_number(at, -as_number(right), p_arena);
+      break;
+    case operator_type::op_plus:
+      if(right->get_type() == ast::node_type::nt_number_expr)
+        return make_number(at, as_number(right), p_arena);
+      break;
+    case operator_type::op_bang:
+      if(right->get_type() == ast::node_type::nt_boolean_expr)
+        return make_bool(at, !as_bool(right), p_arena);
+      break;
+    default:
+      break;
+    }
+    return nullptr;
+  }
+
+  static ast::ptr<ast::expression> fold_infix(ast::infix_binary_expression* p_binary,
+                                              std::pmr::memory_resource* p_arena)
+  {
+    const auto lhs = p_binary->get_left().get();
+    const auto rhs = p_binary->get_right().get();
+    if(!is_literal(lhs) || !is_literal(rhs))
+      return nullptr;
+
+    const auto& at = p_binary->get_token();
+    const auto op = p_binary->get_operator();
+    const auto lhs_type = lhs->get_type();
+    const auto rhs_type = rhs->get_type();
+
+    if(lhs_type == ast::node_type::nt_number_expr && rhs_type == ast::node_type::nt_number_expr)
+    {
+      const auto l = as_number(lhs);
+      const auto r = as_number(rhs);
+      switch(op)
+      {
+      case operator_type::op_plus:
+        return make_number(at, l + r, p_arena);
+      case operator_type::op_minus:
+        return make_number(at, l - r, p_arena);
+      case operator_type::op_asterisk:
+        return make_number(at, l * r, p_arena);
+      case operator_type::op_slash:
+        // division by 0 is a runtime error, keep it one
+        return r == 0 ? nullptr : make_number(at, l / r, p_arena);
+      case operator_type::op_greater:
+        return make_bool(at, l > r, p_arena);
+      case operator_type::op_greater_equal:
+        return make_bool(at, l >= r, p_arena);
+      case operator_type::op_less:
+        return make_bool(at, l < r, p_arena);
+      case operator_type::op_less_equal:
+        return make_bool(at, l <= r, p_arena);
+      default:
+        break;
+      }
+    }
+
+    if(lhs_type == ast::node_type::nt_string_expr)
+    {
+      // strings are objects, they only know how to combine with other strings
+      if(rhs_type != ast::node_type::nt_string_expr)
+        return nullptr;
+      const auto& l = as_string(lhs);
+      const auto& r = as_string(rhs);
+      switch(op)
+      {
+      case operator_type::op_plus:
+        return make_string(at, l + r, p_arena);
+      case operator_type::op_equal:
+      case operator_type::op_bang_equal:
+      {
+        // escapes could make two different spellings the same string
+        if(l.contains('\\') || r.contains('\\'))
+          return nullptr;
+        return make_bool(at, (l == r) == (op == operator_type::op_equal), p_arena);
+      }
+      default:
+        return nullptr;
+      }
+    }
+
+    if(op == operator_type::op_equal)
+      return make_bool(at, builtin_equals(lhs, rhs), p_arena);
+    if(op == operator_type::op_bang_equal)
+      return make_bool(at, !builtin_equals(lhs, rhs), p_arena);
+    return nullptr;
+  }
+
+  static void fold_expressions(ast::list<ast::expression>& p_expressions, std::pmr::memory_resource* p_arena)
+  {
+    for(auto& expression : p_expressions)
+      fold_expression(expression, p_arena);
+  }
+
+  static void fold_expression(ast::ptr<ast::expression>& p_expression, std::pmr::memory_resource* p_arena)
+  {
+    if(p_expression == nullptr)
+      return;
+
+    switch(p_expression->get_type())
+    {
+    case ast::node_type::nt_prefix_expr:
+    {
+      auto unary = static_cast<ast::prefix_unary_expression*>(p_expression.get());
+      fold_expression(unary->get_right(), p_arena);
+      if(auto folded = fold_prefix(unary, p_arena))
+        p_expression = std::move(folded);
+      return;
+    }
+    case ast::node_type::nt_infix_binary_expr:
+    {
+      auto binary = static_cast<ast::infix_binary_expression*>(p_expression.get());
+      fold_expression(binary->get_left(), p_arena);
+      fold_expression(binary->get_right(), p_arena);
+      if(auto folded = fold_infix(binary, p_arena))
+        p_expression = std::move(folded);
+      return;
+    }
+    case ast::node_type::nt_assign_expr:
+    case ast::node_type::nt_compound_assign_expr:
+    {
+      // the lhs is an lvalue, only its subexpressions could fold and none of them is worth it
+      fold_expression(static_cast<ast::assign_expression*>(p_expression.get())->get_right(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_call_expr:
+    {
+      auto call = static_cast<ast::call_expression*>(p_expression.get());
+      fold_expression(call->get_callable(), p_arena);
+      fold_expressions(call->get_arguments(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_access_expr:
+    {
+      auto access = static_cast<ast::access_expression*>(p_expression.get());
+      fold_expression(access->get_target(), p_arena);
+      fold_expressions(access->get_arguments_list(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_super_expr:
+    {
+      fold_expressions(static_cast<ast::super_expression*>(p_expression.get())->get_arguments(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_array_expr:
+    {
+      fold_expressions(static_cast<ast::array_expression*>(p_expression.get())->get_elements(), p_arena);
+      return;
+    }
+    default:
+      return;
+    }
+  }
+
+  static void fold_statement(ast::ptr<ast::statement>& p_statement, std::pmr::memory_resource* p_arena)
+  {
+    if(p_statement == nullptr)
+      return;
+
+    switch(p_statement->get_type())
+    {
+    case ast::node_type::nt_expression_statement_stmt:
+    {
+      fold_expression(static_cast<ast::expression_statement*>(p_statement.get())->get_expression(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_print_stmt:
+    {
+      fold_expression(static_cast<ast::print_statement*>(p_statement.get())->get_expression(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_block_stmt:
+    {
+      for(auto& statement : static_cast<ast::block_statement*>(p_statement.get())->get_statement())
+        fold_statement(statement, p_arena);
+      return;
+    }
+    case ast::node_type::nt_if_stmt:
+    {
+      auto if_statement = static_cast<ast::if_statement*>(p_statement.get());
+      fold_expression(if_statement->get_expression(), p_arena);
+      fold_statement(if_statement->get_consequence(), p_arena);
+      fold_statement(if_statement->get_alternative(), p_arena);
+
+      // a non bool condition is a runtime error, so only a bool literal decides the branch here. the if doesnt open a
+      // scope of its own, so the taken branch can stand in for it as is
+      const auto condition = if_statement->get_expression().get();
+      if(condition->get_type() != ast::node_type::nt_boolean_expr)
+        return;
+      auto taken = as_bool(condition) ? std::move(if_statement->get_consequence())
+                                      : std::move(if_statement->get_alternative());
+      if(taken == nullptr)
+        taken = ast::make<ast::empty_statement>(p_arena, if_statement->get_token());
+      p_statement = std::move(taken);
+      return;
+    }
+    case ast::node_type::nt_while_stmt:
+    {
+      auto while_statement = static_cast<ast::while_statement*>(p_statement.get());
+      fold_expression(while_statement->get_expression(), p_arena);
+      fold_statement(while_statement->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_for_stmt:
+    {
+      auto for_statement = static_cast<ast::for_statement*>(p_statement.get());
+      fold_statement(for_statement->get_initializer(), p_arena);
+      fold_expression(for_statement->get_condition(), p_arena);
+      fold_expression(for_statement->get_increment(), p_arena);
+      fold_statement(for_statement->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_return_stmt:
+    {
+      fold_expression(static_cast<ast::return_statement*>(p_statement.get())->get_expression(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_try_stmt:
+    {
+      fold_statement(static_cast<ast::try_statement*>(p_statement.get())->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_catch_stmt:
+    {
+      fold_statement(static_cast<ast::catch_statement*>(p_statement.get())->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_finalize_stmt:
+    {
+      fold_statement(static_cast<ast::finalize_statement*>(p_statement.get())->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_let_decl:
+    {
+      fold_expression(static_cast<ast::let_declaration*>(p_statement.get())->get_value(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_function_decl:
+    {
+      fold_statement(static_cast<ast::function_declaration*>(p_statement.get())->get_body(), p_arena);
+      return;
+    }
+    case ast::node_type::nt_class_decl:
+    {
+      for(auto& method : static_cast<ast::class_declaration*>(p_statement.get())->get_methods())
+        fold_statement(method.function->get_body(), p_arena);
+      return;
+    }
+    default:
+      return;
+    }
+  }
+
+  void constant_folder::fold(ast::program& p_program, std::pmr::memory_resource* p_arena)
+  {
+    for(auto& statement : p_program.get_statements())
+      fold_statement(statement, p_arena);
+  }
+
+  void constant_folder::fold(ast::ptr<ast::statement>& p_statement, std::pmr::memory_resource* p_arena)
+  {
+    fold_statement(p_statement, p_arena);
+  }
+} // namespace ok
@@ -0,0 +1,20 @@
+#ifndef OK_CONSTANT_FOLDER_HPP
+#define OK_CONSTANT_FOLDER_HPP
+
+#include "ast.hpp"
+
+namespace ok
+{
+  // ast level pass, runs on the parsed program before it gets compiled
+  struct constant_folder
+  {
+    // evaluates operators whose operands are all literals, and drops if branches with a literal condition that can
+    // never run. an operator on anything other than a literal may dispatch to a user overload so it is left alone
+    // nodes that replace folded ones come from p_arena, the one the program was parsed into
+    static void fold(ast::program& p_program, std::pmr::memory_resource* p_arena);
+    // a single top level statement, for compiling them as they are parsed
+    static void fold(ast::ptr<ast::statement>& p_statement, std::pmr::memory_resource* p_arena);
+  };
+} // namespace ok
+
+#endif // OK_CONSTANT_FOLDER_HPP
@@ -4,6 +4,7 @@
 #include "utility.hpp"
 #include "vm.hpp"
 #include "vm_stack.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <print>
 #include <string_view>
@@ -212,6 +213,16 @@ namespace ok::debug
       return identifier_instruction("op_set_property", p_chunk, p_offset);
     case to_utype(opcode::op_set_property_long):
       return identifier_long_instruction("op_set_property_long", p_chunk, p_offset);
+    case to_utype(opcode::op_set_if_property):
+    {
+      p_offset = identifier_instruction("op_set_if_property", p_chunk, p_offset);
+      return set_if_instruction(p_chunk, p_offset);
+    }
+    case to_utype(opcode::op_set_if_property_long):
+    {
+      p_offset = identifier_long_instruction("op_set_if_property_long", p_chunk, p_offset);
+      return set_if_instruction(p_chunk, p_offset);
+    }
     case to_utype(opcode::op_method):
       return method_instruction("op_method", p_chunk, p_offset);
     case to_utype(opcode::op_method_long):
@@ -238,6 +249,76 @@ namespace ok::debug
       return simple_instruction("op_save_slot", p_offset);
     case to_utype(opcode::op_push_saved_slot):
       return simple_instruction("op_push_saved_slot", p_offset);
+    case to_utype(opcode::op_add_nn):
+      return simple_instruction("op_add_nn", p_offset);
+    case to_utype(opcode::op_subtract_nn):
+      return simple_instruction("op_subtract_nn", p_offset);
+    case to_utype(opcode::op_multiply_nn):
+      return simple_instruction("op_multiply_nn", p_offset);
+    case to_utype(opcode::op_divide_nn):
+      return simple_instruction("op_divide_nn", p_offset);
+    case to_utype(opcode::op_greater_nn):
+      return simple_instruction("op_greater_nn", p_offset);
+    case to_utype(opcode::op_greater_equal_nn):
+      return simple_instruction("op_greater_equal_nn", p_offset);
+    case to_utype(opcode::op_less_nn):
+      return simple_instruction("op_less_nn", p_offset);
+    case to_utype(opcode::op_less_equal_nn):
+      return simple_instruction("op_less_equal_nn", p_offset);
+    case to_utype(opcode::op_add_unchecked):
+      return simple_instruction("op_add_unchecked", p_offset);
+    case to_utype(opcode::op_subtract_unchecked):
+      return simple_instruction("op_subtract_unchecked", p_offset);
+    case to_utype(opcode::op_multiply_unchecked):
+      return simple_instruction("op_multiply_unchecked", p_offset);
+    case to_utype(opcode::op_divide_unchecked):
+      return simple_instruction("op_divide_unchecked", p_offset);
+    case to_utype(opcode::op_greater_unchecked):
+      return simple_instruction("op_greater_unchecked", p_offset);
+    case to_utype(opcode::op_greater_equal_unchecked):
+      return simple_instruction("op_greater_equal_unchecked", p_offset);
+    case to_utype(opcode::op_less_unchecked):
+      return simple_instruction("op_less_unchecked", p_offset);
+    case to_utype(opcode::op_less_equal_unchecked):
+      return simple_instruction("op_less_equal_unchecked", p_offset);
+    case to_utype(opcode::op_get_local_get_local_add):
+      return single_operand_instruction("op_get_local_get_local_add", p_chunk, p_offset);
+    case to_utype(opcode::op_get_local_constant_less_jump):
+      return single_operand_instruction("op_get_local_constant_less_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_get_local_constant_add_set_local_pop):
+      return single_operand_instruction("op_get_local_constant_add_set_local_pop", p_chunk, p_offset);
+    case to_utype(opcode::op_add_rr):
+      return register_instruction("op_add_rr", p_chunk, p_offset);
+    case to_utype(opcode::op_add_rk):
+      return register_instruction("op_add_rk", p_chunk, p_offset);
+    case to_utype(opcode::op_subtract_rr):
+      return register_instruction("op_subtract_rr", p_chunk, p_offset);
+    case to_utype(opcode::op_subtract_rk):
+      return register_instruction("op_subtract_rk", p_chunk, p_offset);
+    case to_utype(opcode::op_multiply_rr):
+      return register_instruction("op_multiply_rr", p_chunk, p_offset);
+    case to_utype(opcode::op_multiply_rk):
+      return register_instruction("op_multiply_rk", p_chunk, p_offset);
+    case to_utype(opcode::op_divide_rr):
+      return register_instruction("op_divide_rr", p_chunk, p_offset);
+    case to_utype(opcode::op_divide_rk):
+      return register_instruction("op_divide_rk", p_chunk, p_offset);
+    case to_utype(opcode::op_greater_rr_jump):
+      return register_instruction("op_greater_rr_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_greater_rk_jump):
+      return register_instruction("op_greater_rk_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_greater_equal_rr_jump):
+      return register_instruction("op_greater_equal_rr_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_greater_equal_rk_jump):
+      return register_instruction("op_greater_equal_rk_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_less_rr_jump):
+      return register_instruction("op_less_rr_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_less_rk_jump):
+      return register_instruction("op_less_rk_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_less_equal_rr_jump):
+      return register_instruction("op_less_equal_rr_jump", p_chunk, p_offset);
+    case to_utype(opcode::op_less_equal_rk_jump):
+      return register_instruction("op_less_equal_rk_jump", p_chunk, p_offset);
     default:
     {
       std::println("unknown opcode: '{}'", instruction);
@@ -258,6 +339,28 @@ namespace ok::debug
     return p_offset + 2;
   }
 
+  int disassembler::register_instruction(const std::string_view p_name, const chunk& p_chunk, int p_offset)
+  {
+    const auto length = static_cast<int>(instruction_length(p_chunk, p_offset));
+    const auto stub = p_offset + length + decode_int<int, 3>(p_chunk.code, p_offset + length - 3);
+    if(length == 7)
+    {
+      std::println("{}: {:4d} {:4d} {:4d} stub {}",
+                   p_name,
+                   p_chunk.code[p_offset + 1],
+                   p_chunk.code[p_offset + 2],
+                   p_chunk.code[p_offset + 3],
+                   stub);
+    }
+    else
+    {
+      const auto exit = p_offset + length + decode_int<int, 3>(p_chunk.code, p_offset + 3);
+      std::println(
+          "{}: {:4d} {:4d} exit {} stub {}", p_name, p_chunk.code[p_offset + 1], p_chunk.code[p_offset + 2], exit, stub);
+    }
+    return p_offset + length;
+  }
+
   int disassembler::constant_instruction(const std::string_view p_name, const chunk& p_chunk, int p_offset)
   {
     constexpr auto CONSTANT_INDEX = 1;                                  // from start offset
@@ -328,10 +431,15 @@ namespace ok::debug
 
   int disassembler::closure_instruction(std::string_view p_name, const chunk& p_chunk, int p_offset)
   {
+    // [op_closure][op_constant][index] or [op_closure][op_constant_long][index x3], then [is_local][index x3] per
+    // upvalue
     auto const_inst = p_chunk.code[++p_offset];
     uint32_t constant;
     if(const_inst == to_utype(opcode::op_constant))
+    {
       constant = p_chunk.code[++p_offset];
+      ++p_offset;
+    }
     else
     {
       constant = decode_int<uint32_t, 3>(p_chunk.code, ++p_offset);
@@ -344,12 +452,12 @@ namespace ok::debug
     auto fun = OK_VALUE_AS_FUNCTION_OBJECT(p_chunk.constants[constant]);
     for(uint32_t i = 0; i < fun->upvalues; ++i)
     {
-      auto is_local = p_chunk.code[p_offset++];
-      auto index = decode_int<uint32_t, 3>(p_chunk.code, ++p_offset);
-      std::println("    {:4d} {} {}", p_offset - 2, is_local ? "local" : "upvalue", index);
-      p_offset += 3;
+      auto is_local = p_chunk.code[p_offset];
+      auto index = decode_int<uint32_t, 3>(p_chunk.code, p_offset + 1);
+      std::println("    {:4d} {} {}", p_offset, is_local ? "local" : "upvalue", index);
+      p_offset += 4;
     }
-    return ++p_offset;
+    return p_offset;
   }
 
   int disassembler::invoke_instruction(std::string_view p_name, const chunk& p_chunk, int p_offset)
@@ -443,8 +551,51 @@ namespace ok::debug
 
   int disassembler::set_if_instruction(const chunk& p_chunk, int p_offset)
   {
-    auto fcn = decode_int<uint64_t, 8>(p_chunk.code, p_offset);
-    std::println("function: {}", (void*)fcn);
+    auto compare = decode_int<uint64_t, 8>(p_chunk.code, p_offset);
+    std::println("compare: {}", compare);
     return p_offset + sizeof(uint64_t);
   }
-} // namespace ok::debug
\ No newline at end of file
+
+  void ngram_miner::mine(const chunk& p_chunk)
+  {
+    std::vector<byte> ops;
+    for(size_t offset = 0; offset < p_chunk.code.size(); offset += instruction_length(p_chunk, offset))
+    {
+      ops.push_back(p_chunk.code[offset]);
+    }
+    for(size_t i = 0; i + m_n <= ops.size(); ++i)
+    {
+      m_counts[std::string{ops.begin() + i, ops.begin() + i + m_n}]++;
+      m_total++;
+    }
+
+    for(const auto& constant : p_chunk.constants)
+    {
+      if(OK_IS_VALUE_FUNCTION_OBJECT(constant))
+      {
+        mine(OK_VALUE_AS_FUNCTION_OBJECT(constant)->associated_chunk);
+      }
+    }
+  }
+
+  void ngram_miner::report(size_t p_top) const
+  {
+    std::vector<std::pair<std::string, size_t>> sorted{m_counts.begin(), m_counts.end()};
+    std::sort(sorted.begin(),
+              sorted.end(),
+              [](const auto& p_lhs, const auto& p_rhs)
+              { return p_lhs.second > p_rhs.second || (p_lhs.second == p_rhs.second && p_lhs.first < p_rhs.first); });
+
+    std::println("== {}-grams: {} total, {} distinct ==", m_n, m_total, m_counts.size());
+    for(size_t i = 0; i < sorted.size() && i < p_top; ++i)
+    {
+      const auto& [sequence, count] = sorted[i];
+      std::print("{:8d} {:6.2f}%  ", count, 100.0 * count / m_total);
+      for(size_t j = 0; j < sequence.size(); ++j)
+      {
+        std::print("{}{}", j == 0 ? "" : ", ", opcode_to_string(static_cast<opcode>(sequence[j])));
+      }
+      std::println();
+    }
+  }
+} // namespace ok::debug
@@ -2,7 +2,9 @@
 #define OK_DEBUG_HPP
 
 #include "chunk.hpp"
+#include <string>
 #include <string_view>
+#include <unordered_map>
 
 namespace ok::debug
 {
@@ -42,6 +44,26 @@ namespace ok::debug
     static int special_method_instruction(std::string_view p_name, const chunk& p_chunk, int p_offset);
     static int convert_method_instruction(std::string_view p_name, const chunk& p_chunk, int p_offset);
     static int set_if_instruction(const chunk& p_chunk, int p_offset);
+    static int register_instruction(const std::string_view p_name, const chunk& p_chunk, int p_offset);
+  };
+
+  // counts how often each run of n consecutive instructions shows up in the compiled code, used to find the sequences
+  // worth a superinstruction
+  class ngram_miner
+  {
+  public:
+    ngram_miner(size_t p_n) : m_n(p_n)
+    {
+    }
+
+    // mines p_chunk and, through its constants, the chunks of every function declared in it
+    void mine(const chunk& p_chunk);
+    void report(size_t p_top) const;
+
+  private:
+    size_t m_n;
+    size_t m_total = 0;
+    std::unordered_map<std::string, size_t> m_counts; // keyed by the raw opcodes of the sequence
   };
 } // namespace ok::debug
 
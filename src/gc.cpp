@@ -86,9 +86,9 @@ namespace ok
     {
       mark_object((object*)ctx.function.function);
     }
-    for(auto pair : _vm->m_compiler.m_globals)
+    for(const auto& [name, global] : _vm->m_compiler.m_constant_globals)
     {
-      mark_object((object*)pair.first);
+      mark_object((object*)global.closure);
     }
   }
 
@@ -200,6 +200,10 @@ namespace ok
       {
         auto instance = (instance_object*)p_object;
         mark_hashtable(instance->fields);
+        for(auto bound : instance->bound_methods)
+        {
+          mark_object((object*)bound.second);
+        }
         break;
       }
     }
@@ -0,0 +1,506 @@
+#include "image.hpp"
+#include "compiler.hpp"
+#include "object.hpp"
+#include "sha256.hpp"
+#include "utility.hpp"
+#include "verifier.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ok
+{
+  namespace
+  {
+    // every integer is 4 little endian bytes, numbers are the 8 bytes of the double
+    enum class constant_tag : byte
+    {
+      null,
+      boolean,
+      number,
+      string,
+      function,
+      closure, // of a function without upvalues, the compiler makes these for functions that capture nothing
+    };
+
+    constexpr size_t set_if_compare_size = sizeof(uint64_t);
+
+    // every image starts with the magic, the version and then the source length as 8 bytes and its hash
+    constexpr std::array<byte, 4> magic = {'o', 'k', 'b', 0};
+
+    bool is_set_if(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_set_if_global:
+      case opcode::op_set_if_global_long:
+      case opcode::op_set_if_local:
+      case opcode::op_set_if_local_long:
+      case opcode::op_set_if_upvalue:
+      case opcode::op_set_if_upvalue_long:
+      case opcode::op_set_if_property:
+      case opcode::op_set_if_property_long:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    // calls p_check with the position of the compare trailing every set_if instruction, the index of the function in
+    // compiler::set_if_compare_functions plus one
+    template <typename Check>
+    void for_each_set_if_compare(const chunk& p_chunk, Check&& p_check)
+    {
+      for(size_t offset = 0; offset < p_chunk.code.size(); offset += instruction_length(p_chunk, offset))
+      {
+        if(is_set_if(static_cast<opcode>(p_chunk.code[offset])))
+          p_check(offset + instruction_length(p_chunk, offset) - set_if_compare_size);
+      }
+    }
+
+    class image_writer
+    {
+    public:
+      explicit image_writer(const std::vector<const function_object*>& p_functions)
+      {
+        for(uint32_t i = 0; const auto* function : p_functions)
+          m_indices.emplace(function, i++);
+      }
+
+      void write_byte(byte p_value)
+      {
+        m_bytes.push_back(p_value);
+      }
+
+      void write_int(size_t p_value)
+      {
+        const auto bytes = encode_int<uint32_t, 4>(static_cast<uint32_t>(p_value));
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+      }
+
+      void write_string(std::string_view p_str)
+      {
+        write_int(p_str.size());
+        m_bytes.insert(m_bytes.end(), p_str.begin(), p_str.end());
+      }
+
+      bool write_value(value_t p_value)
+      {
+        switch(p_value.type)
+        {
+        case value_type::null_val:
+          m_bytes.push_back(to_utype(constant_tag::null));
+          return true;
+        case value_type::bool_val:
+          m_bytes.push_back(to_utype(constant_tag::boolean));
+          m_bytes.push_back(OK_VALUE_AS_BOOL(p_value));
+          return true;
+        case value_type::number_val:
+        {
+          m_bytes.push_back(to_utype(constant_tag::number));
+          const auto bytes = encode_int<uint64_t, 8>(std::bit_cast<uint64_t>(OK_VALUE_AS_NUMBER(p_value)));
+          m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+          return true;
+        }
+        case value_type::object_val:
+          break;
+        default:
+          return false;
+        }
+        if(OK_IS_VALUE_STRING_OBJECT(p_value))
+        {
+          const auto* str = OK_VALUE_AS_STRING_OBJECT(p_value);
+          m_bytes.push_back(to_utype(constant_tag::string));
+          write_string({str->chars, str->length});
+          return true;
+        }
+        if(OK_IS_VALUE_FUNCTION_OBJECT(p_value))
+        {
+          m_bytes.push_back(to_utype(constant_tag::function));
+          write_int(m_indices.at(OK_VALUE_AS_FUNCTION_OBJECT(p_value)));
+          return true;
+        }
+        if(OK_IS_VALUE_CLOSURE_OBJECT(p_value) && OK_VALUE_AS_CLOSURE_OBJECT(p_value)->upvalues.empty())
+        {
+          m_bytes.push_back(to_utype(constant_tag::closure));
+          write_int(m_indices.at(OK_VALUE_AS_CLOSURE_OBJECT(p_value)->function));
+          return true;
+        }
+        return false;
+      }
+
+      bool write_function(const function_object* p_function)
+      {
+        if(p_function->lazy != nullptr)
+          return false; // not compiled yet
+        const auto& chunk = p_function->associated_chunk;
+        write_string({p_function->name->chars, p_function->name->length});
+        m_bytes.push_back(p_function->arity);
+        write_int(p_function->upvalues);
+        write_int(chunk.code.size());
+        // as it is, the code has no addresses in it so image::read can run it where it is mapped
+        m_bytes.insert(m_bytes.end(), chunk.code.begin(), chunk.code.end());
+        for(const auto* values : {&chunk.constants, &chunk.identifiers})
+        {
+          write_int(values->size());
+          for(const auto value : *values)
+          {
+            if(!write_value(value))
+              return false;
+          }
+        }
+        write_int(chunk.offsets.size());
+        for(const auto& offset : chunk.offsets)
+        {
+          write_int(offset.offset);
+          write_int(offset.reps);
+        }
+        return true;
+      }
+
+      std::vector<byte> take()
+      {
+        return std::move(m_bytes);
+      }
+
+    private:
+      std::vector<byte> m_bytes;
+      std::unordered_map<const function_object*, uint32_t> m_indices;
+    };
+
+    // reads are bounds checked, a read past the end marks the image bad and yields zeroes
+    class image_reader
+    {
+    public:
+      image_reader(vm* p_vm,
+                   std::span<const byte> p_bytes,
+                   std::shared_ptr<mapped_image> p_mapping,
+                   const std::vector<function_object*>& p_functions)
+          : m_vm(p_vm), m_bytes(p_bytes), m_mapping(std::move(p_mapping)), m_functions(p_functions)
+      {
+      }
+
+      bool good() const
+      {
+        return m_good;
+      }
+
+      bool at_end() const
+      {
+        return m_position == m_bytes.size();
+      }
+
+      std::span<const byte> read_bytes(size_t p_count)
+      {
+        if(!m_good || m_bytes.size() - m_position < p_count)
+        {
+          m_good = false;
+          return {};
+        }
+        const auto bytes = m_bytes.subspan(m_position, p_count);
+        m_position += p_count;
+        return bytes;
+      }
+
+      byte read_byte()
+      {
+        const auto bytes = read_bytes(1);
+        return bytes.empty() ? 0 : bytes[0];
+      }
+
+      uint32_t read_int()
+      {
+        const auto bytes = read_bytes(4);
+        return bytes.empty() ? 0 : decode_int<uint32_t, 4>(bytes, 0);
+      }
+
+      // a copy, the interned strings are hashed up to the terminator
+      std::string read_string()
+      {
+        const auto bytes = read_bytes(read_int());
+        return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+      }
+
+      function_object* read_function_index()
+      {
+        const auto index = read_int();
+        if(index >= m_functions.size())
+        {
+          m_good = false;
+          return nullptr;
+        }
+        return m_functions[index];
+      }
+
+      value_t read_value()
+      {
+        switch(static_cast<constant_tag>(read_byte()))
+        {
+        case constant_tag::null:
+          return value_t{};
+        case constant_tag::boolean:
+          return value_t{read_byte() != 0};
+        case constant_tag::number:
+        {
+          const auto bytes = read_bytes(8);
+          return value_t{bytes.empty() ? 0.0 : std::bit_cast<double>(decode_int<uint64_t, 8>(bytes, 0))};
+        }
+        case constant_tag::string:
+          return value_t{read_string()};
+        case constant_tag::function:
+        {
+          auto* function = read_function_index();
+          return function == nullptr ? value_t{} : value_t{copy{(object*)function}};
+        }
+        case constant_tag::closure:
+        {
+          auto* function = read_function_index();
+          if(function == nullptr)
+            return value_t{};
+          // one closure per function, like the compiler makes
+          auto& closure = m_closures[function];
+          if(closure == nullptr)
+          {
+            closure = new_tobject<closure_object>(
+                function, m_vm->get_builtin_class(object_type::obj_closure), m_vm->get_objects_list());
+          }
+          return value_t{copy{(object*)closure}};
+        }
+        default:
+          m_good = false;
+          return value_t{};
+        }
+      }
+
+      void read_function(function_object* p_function)
+      {
+        auto& chunk = p_function->associated_chunk;
+        const auto name = read_string();
+        p_function->name = new_tobject<string_object>(
+            name, m_vm->get_builtin_class(object_type::obj_string), m_vm->get_objects_list());
+        p_function->arity = read_byte();
+        p_function->upvalues = read_int();
+        const auto code = read_bytes(read_int());
+        if(m_mapping != nullptr && !code.empty())
+          chunk.code.view(m_mapping->bytes().subspan(code.data() - m_bytes.data(), code.size()), m_mapping);
+        else
+          chunk.code.assign(code.begin(), code.end());
+        for(auto* values : {&chunk.constants, &chunk.identifiers})
+        {
+          const auto count = read_int();
+          for(uint32_t i = 0; i < count && m_good; ++i)
+            values->push_back(read_value());
+        }
+        const auto offsets = read_int();
+        for(uint32_t i = 0; i < offsets && m_good; ++i)
+        {
+          const auto offset = read_int();
+          chunk.offsets.push_back({offset, read_int()});
+        }
+      }
+
+      // the length of op_closure depends on the function it makes, so this waits until every function is read
+      void check_set_if(const function_object* p_function)
+      {
+        const auto& chunk = p_function->associated_chunk;
+        const auto functions = compiler::set_if_compare_functions();
+        for_each_set_if_compare(chunk,
+                                [&](size_t p_position)
+                                {
+                                  const auto index = decode_int<uint64_t, 8>(chunk.code, p_position);
+                                  if(index == 0 || index > functions.size())
+                                    m_good = false;
+                                });
+      }
+
+    private:
+      vm* m_vm;
+      std::span<const byte> m_bytes;
+      std::shared_ptr<mapped_image> m_mapping; // the chunks view their code in it when set
+      size_t m_position = 0;
+      bool m_good = true;
+      const std::vector<function_object*>& m_functions;
+      std::unordered_map<function_object*, closure_object*> m_closures;
+    };
+  } // namespace
+
+  std::vector<const function_object*> image::functions(const function_object* p_script)
+  {
+    std::vector<const function_object*> functions{p_script};
+    std::unordered_map<const function_object*, size_t> seen{{p_script, 0}};
+    for(size_t i = 0; i < functions.size(); ++i)
+    {
+      for(const auto constant : functions[i]->associated_chunk.constants)
+      {
+        const function_object* function = nullptr;
+        if(OK_IS_VALUE_FUNCTION_OBJECT(constant))
+          function = OK_VALUE_AS_FUNCTION_OBJECT(constant);
+        else if(OK_IS_VALUE_CLOSURE_OBJECT(constant))
+          function = OK_VALUE_AS_CLOSURE_OBJECT(constant)->function;
+        if(function != nullptr && seen.emplace(function, functions.size()).second)
+          functions.push_back(function);
+      }
+    }
+    return functions;
+  }
+
+  auto image::source::of(std::string_view p_source) -> source
+  {
+    return {.length = p_source.size(), .hash = sha256(p_source)};
+  }
+
+  std::optional<std::vector<byte>> image::write(const function_object* p_script, const source& p_source)
+  {
+    const auto functions = image::functions(p_script);
+    image_writer writer{functions};
+    for(const auto b : magic)
+      writer.write_byte(b);
+    writer.write_int(version);
+    for(const auto b : encode_int<uint64_t, 8>(p_source.length))
+      writer.write_byte(b);
+    for(const auto b : p_source.hash)
+      writer.write_byte(b);
+    writer.write_int(functions.size());
+    for(const auto* function : functions)
+    {
+      if(!writer.write_function(function))
+        return std::nullopt;
+    }
+    return writer.take();
+  }
+
+  // p_mapping is the mapping p_image is in when the code is to be viewed there
+  static std::vector<function_object*>
+  read_functions(vm* p_vm, std::span<const byte> p_image, std::shared_ptr<mapped_image> p_mapping)
+  {
+    // nothing made here is reachable from the roots until the script runs
+    auto& gc = p_vm->get_gc();
+    gc.pause();
+    std::vector<function_object*> functions;
+    image_reader reader{p_vm, p_image, std::move(p_mapping), functions};
+    const auto header = reader.read_bytes(magic.size());
+    if(!std::ranges::equal(header, magic) || reader.read_int() != image::version)
+    {
+      gc.resume();
+      return {};
+    }
+    reader.read_bytes(sizeof(image::source::length) + sizeof(image::source::hash));
+    // a function can refer to one numbered after it, so they are all made before any is read
+    const auto count = reader.read_int();
+    if(count <= p_image.size())
+    {
+      for(uint32_t i = 0; i < count; ++i)
+      {
+        functions.push_back(new_tobject<function_object>(
+            0, nullptr, p_vm->get_builtin_class(object_type::obj_function), p_vm->get_objects_list()));
+      }
+    }
+    for(auto* function : functions)
+    {
+      if(!reader.good())
+        break;
+      reader.read_function(function);
+    }
+    // nothing below may walk the code before every instruction is known to fit in it
+    const auto well_formed = [](const function_object* p_function)
+    {
+      return verifier::well_formed(p_function->associated_chunk, p_function->arity, p_function->upvalues);
+    };
+    if(!reader.good() || !std::ranges::all_of(functions, well_formed))
+    {
+      gc.resume();
+      return {};
+    }
+    for(auto* function : functions)
+    {
+      if(!reader.good())
+        break;
+      reader.check_set_if(function);
+    }
+    gc.resume();
+    if(functions.empty() || !reader.good() || !reader.at_end())
+      return {};
+    // the bytes may not come from this compiler, nothing unchecked runs on what the verifier can not prove
+    for(const auto* function : functions)
+    {
+      if(!verifier::verify(function->associated_chunk, function->arity))
+        return {};
+    }
+    return functions;
+  }
+
+  std::vector<function_object*> image::read(vm* p_vm, std::span<const byte> p_image)
+  {
+    return read_functions(p_vm, p_image, nullptr);
+  }
+
+  std::vector<function_object*> image::read(vm* p_vm, const std::shared_ptr<mapped_image>& p_image)
+  {
+    return read_functions(p_vm, p_image->bytes(), p_image);
+  }
+
+  auto image::source_of(std::span<const byte> p_image) -> std::optional<source>
+  {
+    constexpr auto size = magic.size() + sizeof(version) + sizeof(source::length) + sizeof(source::hash);
+    if(p_image.size() < size || !std::ranges::equal(p_image.first(magic.size()), magic) ||
+       decode_int<uint32_t, 4>(p_image, magic.size()) != version)
+      return std::nullopt;
+    const auto at = magic.size() + sizeof(version);
+    source result{.length = decode_int<uint64_t, 8>(p_image, at)};
+    std::ranges::copy(p_image.subspan(at + sizeof(source::length), sizeof(source::hash)), result.hash.begin());
+    return result;
+  }
+
+  std::shared_ptr<mapped_image> mapped_image::map(const std::filesystem::path& p_file)
+  {
+    std::shared_ptr<mapped_image> image{new mapped_image};
+#if defined(__linux__)
+    const auto fd = open(p_file.c_str(), O_RDONLY);
+    if(fd < 0)
+      return nullptr;
+    struct stat status{};
+    if(fstat(fd, &status) != 0)
+    {
+      close(fd);
+      return nullptr;
+    }
+    const auto size = static_cast<size_t>(status.st_size);
+    // mmap refuses an empty mapping, an empty image is malformed anyway and is left to image::read to reject. writable
+    // but private, a page is copied the first time the vm writes to the code in it and the file is never changed
+    auto* memory = size == 0 ? nullptr : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED)
+      return nullptr;
+    image->m_memory = memory;
+    image->m_bytes = {static_cast<byte*>(memory), size};
+#else
+    std::ifstream file(p_file, std::ios::binary);
+    if(!file)
+      return nullptr;
+    image->m_copy.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    image->m_bytes = image->m_copy;
+#endif
+    return image;
+  }
+
+  mapped_image::~mapped_image()
+  {
+#if defined(__linux__)
+    if(m_memory != nullptr)
+      munmap(m_memory, m_bytes.size());
+#endif
+  }
+} // namespace ok
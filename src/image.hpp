@@ -0,0 +1,79 @@
+#ifndef OK_IMAGE_HPP
+#define OK_IMAGE_HPP
+
+#include "chunk.hpp"
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ok
+{
+  class vm;
+  class mapped_image;
+  struct function_object;
+
+  // compiled functions flattened to bytes, so a script can be run without lexing, parsing or compiling it again.
+  // functions are numbered in the order they are first reached through the constants, the script function is 0
+  struct image
+  {
+    // bumped whenever the layout or the instruction set changes, an image of another version is not read
+    static constexpr uint32_t version = 3;
+
+    // the script an image was compiled from, recorded after the version so a cached image of an edited script is told
+    // apart without reading the rest
+    struct source
+    {
+      static source of(std::string_view p_source);
+
+      bool operator==(const source&) const = default;
+
+      uint64_t length = 0;
+      std::array<byte, 32> hash{}; // sha256 of the source
+    };
+
+    // the functions of the script in the order they are numbered
+    static std::vector<const function_object*> functions(const function_object* p_script);
+    // nullopt when a constant is not a number, bool, null, string, function or closure without upvalues, or a
+    // function body is left to compiler::compile_lazy
+    static std::optional<std::vector<byte>> write(const function_object* p_script, const source& p_source);
+    // what the image was compiled from, nullopt when it is not an image of this version
+    static std::optional<source> source_of(std::span<const byte> p_image);
+    // makes the functions back in p_vm, numbered as in the image. empty when the image is malformed, of
+    // another version or fails verifier::verify. the code of every function is copied out of p_image
+    static std::vector<function_object*> read(vm* p_vm, std::span<const byte> p_image);
+    // as above but the chunks run their code where it is mapped, and keep p_image alive. strings are still interned
+    // and the constants made as values, only the code is not copied
+    static std::vector<function_object*> read(vm* p_vm, const std::shared_ptr<mapped_image>& p_image);
+  };
+
+  // an image file mapped private, so it is not read through a stream first and image::read can leave the code in it.
+  // read into memory where there is no mmap
+  class mapped_image
+  {
+  public:
+    // null when the file can not be opened or mapped
+    static std::shared_ptr<mapped_image> map(const std::filesystem::path& p_file);
+
+    mapped_image(const mapped_image&) = delete;
+    mapped_image& operator=(const mapped_image&) = delete;
+    ~mapped_image();
+
+    std::span<byte> bytes() const
+    {
+      return m_bytes;
+    }
+
+  private:
+    mapped_image() = default;
+
+    std::span<byte> m_bytes;
+    void* m_memory = nullptr;
+    std::vector<byte> m_copy;
+  };
+} // namespace ok
+
+#endif // OK_IMAGE_HPP
@@ -0,0 +1,531 @@
+#include "jit.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <unordered_map>
+#include <utility>
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace ok
+{
+#if defined(__x86_64__) && defined(__linux__)
+  namespace
+  {
+    enum reg : byte
+    {
+      rax = 0,
+      rcx = 1,
+      rdx = 2,
+      rsi = 6,
+      rdi = 7,
+    };
+
+    // the entry arguments stay in their registers for the whole function: rdi the frame's slots, rsi the stack top,
+    // rdx the constants, rcx where the top goes on the way out, r8 the entry point and r9 the stack limit
+    constexpr reg slots = rdi;
+    constexpr reg top = rsi;
+    constexpr reg constants = rdx;
+
+    // low nibble of the jcc and setcc opcodes
+    enum condition : byte
+    {
+      cc_b = 0x2,
+      cc_ae = 0x3,
+      cc_e = 0x4,
+      cc_ne = 0x5,
+      cc_be = 0x6,
+      cc_a = 0x7,
+    };
+
+    constexpr int32_t value_size = sizeof(value_t);
+    constexpr int32_t payload = offsetof(value_t, as);
+    static_assert(offsetof(value_t, type) == 0 && sizeof(value_type) == 1);
+
+    // displacement of a value counted down from the stack top, 0 is the top
+    constexpr int32_t from_top(int32_t p_index)
+    {
+      return -(p_index + 1) * value_size;
+    }
+
+    class assembler
+    {
+    public:
+      void bytes(std::initializer_list<byte> p_bytes)
+      {
+        m_code.insert(m_code.end(), p_bytes);
+      }
+
+      void imm32(int32_t p_value)
+      {
+        for(size_t i = 0; i < 4; ++i)
+          m_code.push_back(static_cast<byte>(static_cast<uint32_t>(p_value) >> (8 * i)));
+      }
+
+      // modrm for [p_base + disp32], p_reg is a register or the opcode extension
+      void memory(byte p_reg, reg p_base, int32_t p_disp)
+      {
+        m_code.push_back(0x80 | (p_reg << 3) | p_base);
+        imm32(p_disp);
+      }
+
+      // movups through xmm0, values are copied whole
+      void copy_value(reg p_from, int32_t p_from_disp, reg p_to, int32_t p_to_disp)
+      {
+        bytes({0x0F, 0x10});
+        memory(0, p_from, p_from_disp);
+        bytes({0x0F, 0x11});
+        memory(0, p_to, p_to_disp);
+      }
+
+      // movsd xmm, [m] and movsd [m], xmm
+      void load_number(byte p_xmm, reg p_base, int32_t p_disp)
+      {
+        bytes({0xF2, 0x0F, 0x10});
+        memory(p_xmm, p_base, p_disp + payload);
+      }
+
+      void store_number(byte p_xmm, reg p_base, int32_t p_disp)
+      {
+        bytes({0xF2, 0x0F, 0x11});
+        memory(p_xmm, p_base, p_disp + payload);
+      }
+
+      // addsd, subsd, mulsd or divsd xmm, [m]
+      void arithmetic(byte p_op, byte p_xmm, reg p_base, int32_t p_disp)
+      {
+        bytes({0xF2, 0x0F, p_op});
+        memory(p_xmm, p_base, p_disp + payload);
+      }
+
+      // ucomisd xmm, [m]
+      void compare_number(byte p_xmm, reg p_base, int32_t p_disp)
+      {
+        bytes({0x66, 0x0F, 0x2E});
+        memory(p_xmm, p_base, p_disp + payload);
+      }
+
+      // cmp byte [m], type
+      void compare_type(reg p_base, int32_t p_disp, value_type p_type)
+      {
+        bytes({0x80});
+        memory(7, p_base, p_disp);
+        m_code.push_back(to_utype(p_type));
+      }
+
+      // mov byte [m], type
+      void store_type(reg p_base, int32_t p_disp, value_type p_type)
+      {
+        bytes({0xC6});
+        memory(0, p_base, p_disp);
+        m_code.push_back(to_utype(p_type));
+      }
+
+      // the type then mov qword [m + payload], imm32
+      void store_value(reg p_base, int32_t p_disp, value_type p_type, int32_t p_payload)
+      {
+        store_type(p_base, p_disp, p_type);
+        bytes({0x48, 0xC7});
+        memory(0, p_base, p_disp + payload);
+        imm32(p_payload);
+      }
+
+      // setcc al, movzx eax, al, then the bool goes over the lhs of a binary instruction
+      void store_condition(condition p_condition)
+      {
+        bytes({0x0F, static_cast<byte>(0x90 | p_condition), 0xC0, 0x0F, 0xB6, 0xC0});
+        store_bool_from_rax();
+      }
+
+      void store_bool_from_rax()
+      {
+        store_type(top, from_top(1), value_type::bool_val);
+        bytes({0x48, 0x89});
+        memory(rax, top, from_top(1) + payload);
+      }
+
+      // add rsi, imm32 or sub rsi, imm32
+      void move_top(int32_t p_values)
+      {
+        if(p_values > 0)
+          bytes({0x48, 0x81, 0xC6});
+        else
+          bytes({0x48, 0x81, 0xEE});
+        imm32((p_values > 0 ? p_values : -p_values) * value_size);
+      }
+
+      // jcc or jmp rel32, returns where the rel32 goes for patch
+      size_t jump_if(condition p_condition)
+      {
+        bytes({0x0F, static_cast<byte>(0x80 | p_condition)});
+        const auto at = m_code.size();
+        imm32(0);
+        return at;
+      }
+
+      size_t jump()
+      {
+        bytes({0xE9});
+        const auto at = m_code.size();
+        imm32(0);
+        return at;
+      }
+
+      void patch(size_t p_at, size_t p_target)
+      {
+        const auto rel = static_cast<int32_t>(static_cast<int64_t>(p_target) - static_cast<int64_t>(p_at + 4));
+        for(size_t i = 0; i < 4; ++i)
+          m_code[p_at + i] = static_cast<byte>(static_cast<uint32_t>(rel) >> (8 * i));
+      }
+
+      size_t size() const
+      {
+        return m_code.size();
+      }
+
+      const std::vector<byte>& code() const
+      {
+        return m_code;
+      }
+
+    private:
+      std::vector<byte> m_code;
+    };
+
+    byte arithmetic_opcode(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_add:
+      case opcode::op_add_nn:
+      case opcode::op_add_unchecked:
+      case opcode::op_add_rr:
+      case opcode::op_add_rk:
+        return 0x58;
+      case opcode::op_subtract:
+      case opcode::op_subtract_nn:
+      case opcode::op_subtract_unchecked:
+      case opcode::op_subtract_rr:
+      case opcode::op_subtract_rk:
+        return 0x5C;
+      case opcode::op_multiply:
+      case opcode::op_multiply_nn:
+      case opcode::op_multiply_unchecked:
+      case opcode::op_multiply_rr:
+      case opcode::op_multiply_rk:
+        return 0x59;
+      default:
+        return 0x5E;
+      }
+    }
+  } // namespace
+
+  jit_code::~jit_code()
+  {
+    if(memory != nullptr)
+      munmap(memory, size);
+  }
+
+  jit_code* jit::compile(const chunk& p_chunk)
+  {
+    const auto& code = p_chunk.code;
+    if(code.empty())
+      return nullptr;
+
+    std::vector<bool> starts(code.size(), false);
+    for(size_t offset = 0; offset < code.size(); offset += instruction_length(p_chunk, offset))
+      starts[offset] = true;
+
+    assembler a;
+    std::vector<uint32_t> entries(code.size(), 0);
+    std::vector<std::pair<size_t, size_t>> exits; // rel32 to patch, offset of the instruction the interpreter resumes at
+    std::vector<std::pair<size_t, size_t>> jumps; // rel32 to patch, offset of the instruction the jump lands on
+
+    a.bytes({0x41, 0xFF, 0xE0}); // jmp r8
+    for(size_t offset = 0; offset < code.size();)
+    {
+      const auto op = static_cast<opcode>(code[offset]);
+      const auto length = instruction_length(p_chunk, offset);
+      const auto next = offset + length;
+      const auto short_operand = [&](size_t p_at = 1) -> int32_t { return code[offset + p_at]; };
+      const auto long_operand = [&](size_t p_at = 1)
+      { return static_cast<int32_t>(decode_int<uint32_t, 3>(code, offset + p_at)); };
+      const auto leave_if = [&](condition p_condition) { exits.emplace_back(a.jump_if(p_condition), offset); };
+      const auto guard_type = [&](reg p_base, int32_t p_disp, value_type p_type)
+      {
+        a.compare_type(p_base, p_disp, p_type);
+        leave_if(cc_ne);
+      };
+      const auto guard_push = [&]()
+      {
+        a.bytes({0x4C, 0x39, 0xCE}); // cmp rsi, r9
+        leave_if(cc_ae);
+      };
+      // leaves when the divisor is zero or nan, the interpreter reports it
+      const auto guard_divisor = [&](reg p_base, int32_t p_disp)
+      {
+        a.load_number(1, p_base, p_disp);
+        a.bytes({0x66, 0x0F, 0x57, 0xD2}); // xorpd xmm2, xmm2
+        a.bytes({0x66, 0x0F, 0x2E, 0xCA}); // ucomisd xmm1, xmm2
+        leave_if(cc_e);
+      };
+      entries[offset] = a.size();
+
+      switch(op)
+      {
+      case opcode::op_get_local:
+      case opcode::op_get_local_long:
+      // the rest of the sequence a superinstruction stands for follows it
+      case opcode::op_get_local_get_local_add:
+      case opcode::op_get_local_constant_less_jump:
+      case opcode::op_get_local_constant_add_set_local_pop:
+      {
+        const auto slot = op == opcode::op_get_local_long ? long_operand() : short_operand();
+        guard_push();
+        a.copy_value(slots, slot * value_size, top, 0);
+        a.move_top(1);
+        break;
+      }
+      case opcode::op_set_local:
+      case opcode::op_set_local_long:
+      {
+        const auto slot = op == opcode::op_set_local ? short_operand() : long_operand();
+        a.copy_value(top, from_top(0), slots, slot * value_size);
+        break;
+      }
+      case opcode::op_constant:
+      case opcode::op_constant_long:
+      {
+        const auto index = op == opcode::op_constant ? short_operand() : long_operand();
+        guard_push();
+        a.copy_value(constants, index * value_size, top, 0);
+        a.move_top(1);
+        break;
+      }
+      case opcode::op_null:
+      case opcode::op_true:
+      case opcode::op_false:
+        guard_push();
+        a.store_value(top,
+                      0,
+                      op == opcode::op_null ? value_type::null_val : value_type::bool_val,
+                      op == opcode::op_true);
+        a.move_top(1);
+        break;
+      case opcode::op_pop:
+        a.move_top(-1);
+        break;
+      case opcode::op_pop_n:
+        a.move_top(-short_operand());
+        break;
+      case opcode::op_add:
+      case opcode::op_subtract:
+      case opcode::op_multiply:
+      case opcode::op_divide:
+      case opcode::op_add_nn:
+      case opcode::op_subtract_nn:
+      case opcode::op_multiply_nn:
+      case opcode::op_divide_nn:
+      case opcode::op_add_unchecked:
+      case opcode::op_subtract_unchecked:
+      case opcode::op_multiply_unchecked:
+      case opcode::op_divide_unchecked:
+      {
+        // the verifier already proved the operands of the unchecked forms
+        const auto unchecked = op == opcode::op_add_unchecked || op == opcode::op_subtract_unchecked ||
+                               op == opcode::op_multiply_unchecked || op == opcode::op_divide_unchecked;
+        if(!unchecked)
+        {
+          guard_type(top, from_top(1), value_type::number_val);
+          guard_type(top, from_top(0), value_type::number_val);
+        }
+        const auto arithmetic = arithmetic_opcode(op);
+        if(arithmetic == 0x5E)
+          guard_divisor(top, from_top(0));
+        a.load_number(0, top, from_top(1));
+        a.arithmetic(arithmetic, 0, top, from_top(0));
+        a.store_number(0, top, from_top(1));
+        a.move_top(-1);
+        break;
+      }
+      case opcode::op_greater:
+      case opcode::op_greater_equal:
+      case opcode::op_less:
+      case opcode::op_less_equal:
+      case opcode::op_greater_nn:
+      case opcode::op_greater_equal_nn:
+      case opcode::op_less_nn:
+      case opcode::op_less_equal_nn:
+      case opcode::op_greater_unchecked:
+      case opcode::op_greater_equal_unchecked:
+      case opcode::op_less_unchecked:
+      case opcode::op_less_equal_unchecked:
+      case opcode::op_equal:
+      {
+        guard_type(top, from_top(1), value_type::number_val);
+        guard_type(top, from_top(0), value_type::number_val);
+        // less is greater with the operands swapped, unordered compares come out false
+        const auto less = op == opcode::op_less || op == opcode::op_less_equal || op == opcode::op_less_nn ||
+                          op == opcode::op_less_equal_nn || op == opcode::op_less_unchecked ||
+                          op == opcode::op_less_equal_unchecked;
+        const auto or_equal = op == opcode::op_greater_equal || op == opcode::op_less_equal ||
+                              op == opcode::op_greater_equal_nn || op == opcode::op_less_equal_nn ||
+                              op == opcode::op_greater_equal_unchecked || op == opcode::op_less_equal_unchecked;
+        a.load_number(0, top, from_top(less ? 0 : 1));
+        a.compare_number(0, top, from_top(less ? 1 : 0));
+        if(op == opcode::op_equal)
+        {
+          // sete al, setnp r8b, and al, r8b
+          a.bytes({0x0F, 0x94, 0xC0, 0x41, 0x0F, 0x9B, 0xC0, 0x44, 0x20, 0xC0, 0x0F, 0xB6, 0xC0});
+          a.store_bool_from_rax();
+        }
+        else
+        {
+          a.store_condition(or_equal ? cc_ae : cc_a);
+        }
+        a.move_top(-1);
+        break;
+      }
+      case opcode::op_not:
+        guard_type(top, from_top(0), value_type::bool_val);
+        a.bytes({0x80});
+        a.memory(6, top, from_top(0) + payload);
+        a.bytes({0x01}); // xor byte [m], 1
+        break;
+      case opcode::op_negate:
+        guard_type(top, from_top(0), value_type::number_val);
+        a.bytes({0x48, 0x0F, 0xBA});
+        a.memory(7, top, from_top(0) + payload);
+        a.bytes({0x3F}); // btc qword [m], 63
+        break;
+      case opcode::op_conditional_jump:
+      case opcode::op_conditional_truthy_jump:
+        guard_type(top, from_top(0), value_type::bool_val);
+        a.move_top(-1);
+        a.bytes({0x80});
+        a.memory(7, top, payload);
+        a.bytes({0x00}); // cmp byte [m], 0
+        jumps.emplace_back(a.jump_if(op == opcode::op_conditional_jump ? cc_e : cc_ne), next + long_operand());
+        break;
+      case opcode::op_jump:
+        jumps.emplace_back(a.jump(), next + long_operand());
+        break;
+      case opcode::op_loop:
+        jumps.emplace_back(a.jump(), next - long_operand());
+        break;
+      case opcode::op_add_rr:
+      case opcode::op_add_rk:
+      case opcode::op_subtract_rr:
+      case opcode::op_subtract_rk:
+      case opcode::op_multiply_rr:
+      case opcode::op_multiply_rk:
+      case opcode::op_divide_rr:
+      case opcode::op_divide_rk:
+      {
+        // [op][dst][lhs][rhs][stub x3], a miss runs the register instruction in the interpreter which takes the stub
+        const auto constant_rhs = op == opcode::op_add_rk || op == opcode::op_subtract_rk ||
+                                  op == opcode::op_multiply_rk || op == opcode::op_divide_rk;
+        const auto rhs_base = constant_rhs ? constants : slots;
+        const auto rhs = short_operand(3) * value_size;
+        if(constant_rhs && !OK_IS_VALUE_NUMBER(p_chunk.constants[short_operand(3)]))
+          return nullptr;
+        guard_type(slots, short_operand(2) * value_size, value_type::number_val);
+        if(!constant_rhs)
+          guard_type(slots, rhs, value_type::number_val);
+        const auto arithmetic = arithmetic_opcode(op);
+        if(arithmetic == 0x5E)
+          guard_divisor(rhs_base, rhs);
+        a.load_number(0, slots, short_operand(2) * value_size);
+        a.arithmetic(arithmetic, 0, rhs_base, rhs);
+        a.store_type(slots, short_operand(1) * value_size, value_type::number_val);
+        a.store_number(0, slots, short_operand(1) * value_size);
+        break;
+      }
+      case opcode::op_greater_rr_jump:
+      case opcode::op_greater_rk_jump:
+      case opcode::op_greater_equal_rr_jump:
+      case opcode::op_greater_equal_rk_jump:
+      case opcode::op_less_rr_jump:
+      case opcode::op_less_rk_jump:
+      case opcode::op_less_equal_rr_jump:
+      case opcode::op_less_equal_rk_jump:
+      {
+        // [op][lhs][rhs][exit x3][stub x3]
+        const auto constant_rhs = op == opcode::op_greater_rk_jump || op == opcode::op_greater_equal_rk_jump ||
+                                  op == opcode::op_less_rk_jump || op == opcode::op_less_equal_rk_jump;
+        const auto less = op == opcode::op_less_rr_jump || op == opcode::op_less_rk_jump ||
+                          op == opcode::op_less_equal_rr_jump || op == opcode::op_less_equal_rk_jump;
+        const auto or_equal = op == opcode::op_greater_equal_rr_jump || op == opcode::op_greater_equal_rk_jump ||
+                              op == opcode::op_less_equal_rr_jump || op == opcode::op_less_equal_rk_jump;
+        const auto lhs_base = slots;
+        const auto lhs = short_operand(1) * value_size;
+        const auto rhs_base = constant_rhs ? constants : slots;
+        const auto rhs = short_operand(2) * value_size;
+        if(constant_rhs && !OK_IS_VALUE_NUMBER(p_chunk.constants[short_operand(2)]))
+          return nullptr;
+        guard_type(lhs_base, lhs, value_type::number_val);
+        if(!constant_rhs)
+          guard_type(rhs_base, rhs, value_type::number_val);
+        a.load_number(0, less ? rhs_base : lhs_base, less ? rhs : lhs);
+        a.compare_number(0, less ? lhs_base : rhs_base, less ? lhs : rhs);
+        jumps.emplace_back(a.jump_if(or_equal ? cc_b : cc_be), next + long_operand(3));
+        break;
+      }
+      default:
+        // calls, globals, properties, upvalues, printing and returns all go through the interpreter
+        exits.emplace_back(a.jump(), offset);
+        break;
+      }
+      offset = next;
+    }
+
+    for(const auto& [at, target] : jumps)
+    {
+      if(target >= code.size() || !starts[target])
+        return nullptr;
+      a.patch(at, entries[target]);
+    }
+    std::unordered_map<size_t, size_t> exit_blocks;
+    for(const auto& [at, offset] : exits)
+    {
+      auto block = exit_blocks.find(offset);
+      if(block == exit_blocks.end())
+      {
+        block = exit_blocks.emplace(offset, a.size()).first;
+        a.bytes({0x48, 0x89, 0x31}); // mov [rcx], rsi
+        a.bytes({0xB8});             // mov eax, offset
+        a.imm32(static_cast<int32_t>(offset));
+        a.bytes({0xC3}); // ret
+      }
+      a.patch(at, block->second);
+    }
+
+    const auto size = a.size();
+    auto* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+      return nullptr;
+    std::memcpy(memory, a.code().data(), size);
+    if(mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+      munmap(memory, size);
+      return nullptr;
+    }
+    auto* result = new jit_code;
+    result->memory = memory;
+    result->size = size;
+    result->entries = std::move(entries);
+    return result;
+  }
+#else
+  jit_code::~jit_code()
+  {
+  }
+
+  jit_code* jit::compile(const chunk&)
+  {
+    return nullptr;
+  }
+#endif
+} // namespace ok
@@ -0,0 +1,65 @@
+#ifndef OK_JIT_HPP
+#define OK_JIT_HPP
+
+#include "chunk.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ok
+{
+  // machine code for one function chunk. it works on the vm stack in place, so every instruction boundary is a valid
+  // place to enter it and to leave it back to the interpreter. it comes from jit::compile or, for scripts compiled
+  // ahead of time with okc --emit-c, from the c++ compiler
+  struct jit_code
+  {
+    // runs from p_target until an instruction the jit leaves to the interpreter, returns the offset of that instruction
+    // and stores the stack top in p_out_top. pushes never go past p_limit
+    using entry_type = uint32_t (*)(value_t* p_slots,
+                                    value_t* p_top,
+                                    const value_t* p_constants,
+                                    value_t** p_out_top,
+                                    const byte* p_target,
+                                    const value_t* p_limit);
+    // the same for a function okc --emit-c wrote, it is entered at a bytecode offset
+    using native_type = uint32_t (*)(value_t* p_slots,
+                                     value_t* p_top,
+                                     const value_t* p_constants,
+                                     value_t** p_out_top,
+                                     uint32_t p_offset,
+                                     const value_t* p_limit);
+
+    jit_code() = default;
+    jit_code(const jit_code&) = delete;
+    jit_code& operator=(const jit_code&) = delete;
+    ~jit_code();
+
+    uint32_t run(value_t* p_slots,
+                 value_t* p_top,
+                 const value_t* p_constants,
+                 value_t** p_out_top,
+                 size_t p_offset,
+                 const value_t* p_limit) const
+    {
+      if(native != nullptr)
+        return native(p_slots, p_top, p_constants, p_out_top, static_cast<uint32_t>(p_offset), p_limit);
+      return reinterpret_cast<entry_type>(memory)(
+          p_slots, p_top, p_constants, p_out_top, static_cast<const byte*>(memory) + entries[p_offset], p_limit);
+    }
+
+    void* memory = nullptr;
+    size_t size = 0;
+    std::vector<uint32_t> entries; // machine code offset of the instruction at each bytecode offset
+    native_type native = nullptr;
+  };
+
+  // baseline template jit for x86-64 linux, every other target gets nullptr and stays in the interpreter
+  struct jit
+  {
+    // one template per opcode. number arithmetic, comparisons, locals, constants and jumps run as machine code, type
+    // misses and every other instruction leave to the interpreter at that instruction
+    static jit_code* compile(const chunk& p_chunk);
+  };
+} // namespace ok
+
+#endif // OK_JIT_HPP
@@ -1,27 +1,61 @@
 #include "lexer.hpp"
 #include "token.hpp"
 #include "utf8.hpp"
+#include <array>
+#include <bit>
 #include <cctype>
 #include <cstdint>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace ok
 {
+  // ascii bytes that can be part of an identifier, the ascii half of is_not_allowed
+  static constexpr auto identifier_bytes = []
+  {
+    using namespace std::string_view_literals;
+    std::array<bool, 128> table{};
+    table.fill(true);
+    for(const char c : "(){}[];:,.+-*/!=<>'\"\\#@$%^&` \t\n\r\0"sv)
+      table[c] = false;
+    return table;
+  }();
+
   token_array lexer::lex(const std::string_view p_input)
   {
     // TODO(Qais): estimate tokens count so you resize the vector
     if(p_input.size() == 0)
       return {};
-    m_start_position = &p_input[0];
+    start(p_input);
+    token_array arr;
+    do
+      arr.push_back(next());
+    while(arr.back().type != token_type::tok_eof);
+    return arr;
+  }
+
+  void lexer::start(const std::string_view p_input)
+  {
+    m_start_position = p_input.empty() ? "" : &p_input[0];
     m_current_position = m_start_position;
+    m_end_position = m_start_position + p_input.size();
     m_current_line = 0;
     m_current_offset = 0;
-    auto verr = utf8::validate(p_input);
-    token_array arr;
-    if(!verr.has_value())
+    // the ascii prefix needs no validation, and if its all of the input advance never has to decode
+    const auto ascii = utf8::ascii_length(p_input);
+    m_ascii = ascii == p_input.size();
+    m_invalid = !utf8::validate(p_input.substr(ascii)).has_value();
+  }
+
+  token lexer::next()
+  {
+    if(m_invalid)
     {
       // TODO(Qais): expressive error?!
-      error(arr, "invalid utf-8 input");
-      return arr;
+      m_invalid = false;
+      m_current_position = m_end_position; // nothing after it is lexed, tok_eof follows
+      return make_error("invalid utf-8 input");
     }
 
     while(true)
@@ -29,89 +63,72 @@ namespace ok
       skip_whitespace();
       m_start_position = m_current_position;
       if(is_end())
-      {
-        emplace_token(arr, token_type::tok_eof);
-        return arr;
-      }
+        return make_token(token_type::tok_eof);
 
       auto prev = m_current_position; // for is_not_allowed
       auto c = advance();
       switch(c)
       {
       case '(':
-        emplace_token(arr, token_type::tok_left_paren);
-        break;
+        return make_token(token_type::tok_left_paren);
       case ')':
-        emplace_token(arr, token_type::tok_right_paren);
-        break;
+        return make_token(token_type::tok_right_paren);
       case '{':
-        emplace_token(arr, token_type::tok_left_brace);
-        break;
+        return make_token(token_type::tok_left_brace);
       case '}':
-        emplace_token(arr, token_type::tok_right_brace);
-        break;
+        return make_token(token_type::tok_right_brace);
       case '[':
-        emplace_token(arr, token_type::tok_left_bracket);
-        break;
+        return make_token(token_type::tok_left_bracket);
       case ']':
-        emplace_token(arr, token_type::tok_right_bracket);
-        break;
+        return make_token(token_type::tok_right_bracket);
       case ';':
-        emplace_token(arr, token_type::tok_semicolon);
-        break;
+        return make_token(token_type::tok_semicolon);
       case ':':
-        emplace_token(arr, token_type::tok_colon);
-        break;
+        return make_token(token_type::tok_colon);
       case ',':
-        emplace_token(arr, token_type::tok_comma);
-        break;
+        return make_token(token_type::tok_comma);
       case '.': // TODO(Qais): handle floats that start with . here like .69 => 0.69
-        emplace_token(arr, token_type::tok_dot);
-        break;
+        return make_token(token_type::tok_dot);
       case '+':
         if(match('+'))
         {
-          emplace_token(arr, token_type::tok_plus_plus);
+          return make_token(token_type::tok_plus_plus);
         }
         else if(match('='))
         {
-          emplace_token(arr, token_type::tok_plus_equal);
+          return make_token(token_type::tok_plus_equal);
         }
         else
         {
-          emplace_token(arr, token_type::tok_plus);
+          return make_token(token_type::tok_plus);
         }
-        break;
       case '-':
         if(match('-'))
         {
-          emplace_token(arr, token_type::tok_minus_minus);
+          return make_token(token_type::tok_minus_minus);
         }
         else if(match('='))
         {
-          emplace_token(arr, token_type::tok_minus_equal);
+          return make_token(token_type::tok_minus_equal);
         }
         else
         {
-          emplace_token(arr, match('>') ? token_type::tok_arrow : token_type::tok_minus);
+          return make_token(match('>') ? token_type::tok_arrow : token_type::tok_minus);
         }
-        break;
       case '*':
         if(match('='))
         {
-          emplace_token(arr, token_type::tok_asterisk_equal);
+          return make_token(token_type::tok_asterisk_equal);
         }
         else
         {
-          emplace_token(arr, token_type::tok_asterisk);
+          return make_token(token_type::tok_asterisk);
         }
-        break;
       case '/':
         // TODO(Qais): validate comment logic
         if(*m_current_position == '/')
         {
-          while(*m_current_position != '\n' && !is_end())
-            advance();
+          skip_until('\n', '\0', '\0');
         }
         else if(*m_current_position == '*')
         {
@@ -120,89 +137,77 @@ namespace ok
         }
         else if(match('='))
         {
-          emplace_token(arr, token_type::tok_slash_equal);
+          return make_token(token_type::tok_slash_equal);
         }
         else
         {
-          emplace_token(arr, token_type::tok_slash);
+          return make_token(token_type::tok_slash);
         }
         break;
       case '%':
-        emplace_token(arr, match('=') ? token_type::tok_modulo_equal : token_type::tok_modulo);
-        break;
+        return make_token(match('=') ? token_type::tok_modulo_equal : token_type::tok_modulo);
       case '&':
-        emplace_token(arr, match('=') ? token_type::tok_ampersand_equal : token_type::tok_ampersand);
-        break;
+        return make_token(match('=') ? token_type::tok_ampersand_equal : token_type::tok_ampersand);
       case '^':
-        emplace_token(arr, match('=') ? token_type::tok_caret_equal : token_type::tok_caret);
-        break;
+        return make_token(match('=') ? token_type::tok_caret_equal : token_type::tok_caret);
       case '|':
-        emplace_token(arr, match('=') ? token_type::tok_bar_equal : token_type::tok_bar);
-        break;
+        return make_token(match('=') ? token_type::tok_bar_equal : token_type::tok_bar);
       case '<<':
-        emplace_token(arr, match('=') ? token_type::tok_shift_left_equal : token_type::tok_shift_left);
-        break;
+        return make_token(match('=') ? token_type::tok_shift_left_equal : token_type::tok_shift_left);
       case '>>':
-        emplace_token(arr, match('=') ? token_type::tok_shift_right_equal : token_type::tok_shift_right);
-        break;
+        return make_token(match('=') ? token_type::tok_shift_right_equal : token_type::tok_shift_right);
       case '!':
-        emplace_token(arr, match('=') ? token_type::tok_bang_equal : token_type::tok_bang);
-        break;
+        return make_token(match('=') ? token_type::tok_bang_equal : token_type::tok_bang);
       case '?':
-        emplace_token(arr, token_type::tok_question);
-        break;
+        return make_token(token_type::tok_question);
       case '=':
-        emplace_token(arr, match('=') ? token_type::tok_equal : token_type::tok_assign);
-        break;
+        return make_token(match('=') ? token_type::tok_equal : token_type::tok_assign);
       case '<':
-        emplace_token(arr, match('=') ? token_type::tok_less_equal : token_type::tok_less);
-        break;
+        return make_token(match('=') ? token_type::tok_less_equal : token_type::tok_less);
       case '>':
-        emplace_token(arr, match('=') ? token_type::tok_greater_equal : token_type::tok_greater);
-        break;
+        return make_token(match('=') ? token_type::tok_greater_equal : token_type::tok_greater);
       case '\'':
       case '"':
-        emplace_string(arr, c);
-        break;
+        return lex_string(c);
       default:
         if(isdigit(c))
         {
-          emplace_number(arr);
-          break;
+          return lex_number();
         }
         if(!is_not_allowed(prev))
         {
-          emplace_identifier(arr);
-          break;
+          return lex_identifier();
         }
-        error(arr, "unexpected character");
+        auto err = make_error("unexpected character");
         advance();
+        return err;
       }
     }
   }
 
-  void lexer::emplace_string(token_array& p_array, char expect_end)
+  token lexer::lex_string(char expect_end)
   {
-    while(*m_current_position != expect_end && !is_end())
+    while(true)
     {
-      if(*m_current_position == '\n')
-        m_current_line++;
+      skip_until(expect_end, '\n', '\0');
+      if(*m_current_position != '\n')
+        break;
+      m_current_line++;
       advance();
     }
     if(is_end())
     {
-      error(p_array, "unterminated string");
-      return;
+      return make_error("unterminated string");
     }
     // close
     advance();
-    p_array.emplace_back(token_type::tok_string,
-                         std::string(m_start_position + 1, m_current_position - m_start_position - 2),
-                         m_current_line,
-                         m_current_offset);
+    return {token_type::tok_string,
+            std::string_view(m_start_position + 1, m_current_position - m_start_position - 2),
+            static_cast<uint32_t>(m_current_line),
+            static_cast<uint32_t>(m_current_offset)};
   }
 
-  void lexer::emplace_number(token_array& p_array)
+  token lexer::lex_number()
   {
     while(isdigit(*m_current_position))
       advance();
@@ -210,19 +215,117 @@ namespace ok
       advance();
     while(isdigit(*m_current_position))
       advance();
-    return emplace_token(p_array, token_type::tok_number);
+    return make_token(token_type::tok_number);
   }
 
-  void lexer::emplace_identifier(token_array& p_array)
+  token lexer::lex_identifier()
   {
-    while(!is_not_allowed(m_current_position))
-      advance();
-    const auto tok = lookup_identifier(std::string(m_start_position, m_current_position - m_start_position));
-    emplace_token(p_array, tok);
+    while(true)
+    {
+      const auto c = static_cast<uint8_t>(*m_current_position);
+      if(c < 0x80)
+      {
+        if(!identifier_bytes[c])
+          break;
+        m_current_position++;
+        m_current_offset++;
+      }
+      else if(is_not_allowed(m_current_position))
+        break;
+      else
+        advance();
+    }
+    return make_token(lookup_identifier(std::string_view(m_start_position, m_current_position - m_start_position)));
+  }
+
+  size_t lexer::skip_until(char p_a, char p_b, char p_c)
+  {
+    const char* p = m_current_position;
+#if defined(__AVX2__)
+    {
+      const auto a = _mm256_set1_epi8(p_a), b = _mm256_set1_epi8(p_b), c = _mm256_set1_epi8(p_c);
+      for(; m_end_position - p >= 32; p += 32)
+      {
+        const auto chunk = _mm256_loadu_si256((const __m256i*)p);
+        const auto hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, a), _mm256_cmpeq_epi8(chunk, b)),
+                                          _mm256_cmpeq_epi8(chunk, c));
+        if(const auto mask = (uint32_t)_mm256_movemask_epi8(hits); mask != 0)
+        {
+          p += std::countr_zero(mask);
+          break;
+        }
+      }
+    }
+#endif
+#if defined(__SSE2__)
+    {
+      const auto a = _mm_set1_epi8(p_a), b = _mm_set1_epi8(p_b), c = _mm_set1_epi8(p_c);
+      for(; m_end_position - p >= 16; p += 16)
+      {
+        const auto chunk = _mm_loadu_si128((const __m128i*)p);
+        const auto hits =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, a), _mm_cmpeq_epi8(chunk, b)), _mm_cmpeq_epi8(chunk, c));
+        if(const auto mask = (uint32_t)_mm_movemask_epi8(hits); mask != 0)
+        {
+          p += std::countr_zero(mask);
+          break;
+        }
+      }
+    }
+#endif
+    // the tail, or the whole thing without simd, stops right away if a vector loop found it
+    while(p < m_end_position && *p != p_a && *p != p_b && *p != p_c)
+      p++;
+    const size_t skipped = p - m_current_position;
+    m_current_position = p;
+    m_current_offset += skipped;
+    return skipped;
+  }
+
+  void lexer::skip_whitespace()
+  {
+#if defined(__SSE2__)
+    // indentation comes in runs, eat 16 bytes at a time while all of them are blank
+    const auto space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const auto cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    while(m_end_position - m_current_position >= 16)
+    {
+      const auto chunk = _mm_loadu_si128((const __m128i*)m_current_position);
+      const auto spaces = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab));
+      const auto newlines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf));
+      const auto blanks = (uint32_t)_mm_movemask_epi8(_mm_or_si128(spaces, _mm_cmpeq_epi8(chunk, cr))) | newlines;
+      const auto run = std::countr_one(blanks);
+      m_current_line += std::popcount(newlines & ((1u << run) - 1));
+      m_current_position += run;
+      m_current_offset += run;
+      if(run < 16)
+        return;
+    }
+#endif
+    while(true)
+    {
+      switch(*m_current_position)
+      {
+      case '\n':
+        m_current_line++;
+        [[fallthrough]];
+      case ' ':
+      case '\t':
+      case '\r':
+        m_current_position++;
+        m_current_offset++;
+        break;
+      default:
+        return;
+      }
+    }
   }
 
   bool lexer::is_not_allowed(const char* c)
   {
+    if(static_cast<uint8_t>(*c) < 0x80)
+      return !identifier_bytes[static_cast<uint8_t>(*c)];
+
     constexpr auto ascii = 1;
     auto uc = (const uint8_t*)c;
     auto next = (const uint8_t*)utf8::advance(c);
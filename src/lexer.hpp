@@ -13,28 +13,39 @@ namespace ok
   public:
     // lex all input ahead of time, for multi pass compiler(if i end up doing that)
     token_array lex(const std::string_view p_input);
+    // or one token at a time, next returns tok_eof at the end and keeps returning it. the input must outlive the lexer
+    // and be followed by a '\0'
+    void start(const std::string_view p_input);
+    token next();
 
   private:
     inline bool is_end()
     {
       return *m_current_position == '\0';
     }
-    void emplace_token(token_array& p_array, const token_type p_type)
+    token make_token(const token_type p_type) const
     {
-      p_array.emplace_back(p_type,
-                           std::string(m_start_position, m_current_position - m_start_position),
-                           m_current_line,
-                           m_current_offset);
+      return {p_type,
+              std::string_view(m_start_position, m_current_position - m_start_position),
+              static_cast<uint32_t>(m_current_line),
+              static_cast<uint32_t>(m_current_offset)};
     }
-    void error(token_array& p_array, const std::string_view p_error)
+    // p_error must be a literal, the token keeps a view of it
+    token make_error(const std::string_view p_error) const
     {
-      p_array.emplace_back(token_type::tok_error, std::string(p_error), m_current_line, m_current_offset);
+      return {token_type::tok_error,
+              p_error,
+              static_cast<uint32_t>(m_current_line),
+              static_cast<uint32_t>(m_current_offset)};
     }
     char advance()
     {
       auto tmp_ptr = m_current_position;
       auto tmp = *m_current_position;
-      m_current_position = utf8::advance(m_current_position);
+      if(m_ascii) // every byte is a codepoint, dont decode
+        m_current_position += tmp != '\0';
+      else
+        m_current_position = utf8::advance(m_current_position);
       m_current_offset += m_current_position - tmp_ptr;
       return tmp;
     }
@@ -44,39 +55,24 @@ namespace ok
         return false;
       if(*m_current_position != p_expect)
         return false;
-      m_current_position = utf8::advance(m_current_position);
+      m_current_position++; // p_expect is ascii
       return true;
     }
-    void skip_whitespace()
-    {
-      while(true)
-      {
-        // auto c = utf8::peek(m_current_position, 1);
-        auto c = *m_current_position;
-        switch(c)
-        {
-        case ' ':
-        case '\t':
-        case '\r':
-          advance();
-          break;
-        case '\n':
-          m_current_line++;
-          advance();
-          break;
-        default:
-          return;
-        }
-      }
-    }
+    // skips bytes until one of p_a, p_b or p_c (or the end) and returns how many were skipped, they must be ascii so
+    // the skipped run is whole codepoints
+    size_t skip_until(char p_a, char p_b, char p_c);
+    void skip_whitespace();
     bool is_not_allowed(const char* c);
-    void emplace_string(token_array& p_array, char expect_end);
-    void emplace_number(token_array& p_array);
-    void emplace_identifier(token_array& p_array);
+    token lex_string(char expect_end);
+    token lex_number();
+    token lex_identifier();
 
   private:
     const char* m_start_position = nullptr;
     const char* m_current_position = nullptr;
+    const char* m_end_position = nullptr; // the '\0' after the input
+    bool m_ascii = false;
+    bool m_invalid = false; // not utf-8, next reports it once
     size_t m_current_line = 0;
     size_t m_current_offset = 0;
   };
@@ -163,50 +163,174 @@ static tests_progress test(const std::string_view src, const std::string_view ex
 #include "runner.hpp"
 #include "utility.hpp"
 #include "vm.hpp"
+#include <charconv>
 #include <filesystem>
 #include <print>
+#include <string_view>
+#include <vector>
 
 #define FILE_ERROR (ok::to_utype(ok::vm::interpret_result::count))
 #define UNKNOWN_ERROR (FILE_ERROR + 1)
+#define USAGE_ERROR (UNKNOWN_ERROR + 1)
+
+static constexpr uint32_t default_jit_threshold = 1000;  // calls before --jit compiles a function
+static constexpr uint32_t default_trace_threshold = 1000; // back edges before --trace records a loop
+
+// --flag=<n> with n > 0
+static bool parse_threshold(std::string_view p_flag, std::string_view p_prefix, uint32_t& p_threshold)
+{
+  const auto value = p_flag.substr(p_prefix.size());
+  if(std::from_chars(value.data(), value.data() + value.size(), p_threshold).ec != std::errc{} || p_threshold == 0)
+  {
+    std::println(stderr, "invalid {} threshold: '{}'", p_prefix.substr(2, p_prefix.size() - 3), value);
+    return false;
+  }
+  return true;
+}
+
+static int report_file_error(ok::runner::error p_error, const std::filesystem::path& p_file)
+{
+  switch(p_error)
+  {
+  case ok::runner::error::file_not_found:
+  {
+    std::println(stderr, "can't open file: '{}', reason: no such file or directory", p_file.string());
+    return FILE_ERROR;
+  }
+  case ok::runner::error::no_permission:
+  {
+    std::println(stderr, "can't open file: '{}', reason: permission denied", p_file.string());
+    return FILE_ERROR;
+  }
+  case ok::runner::error::not_a_file:
+  {
+    std::println(stderr, "can't open file: '{}', reason: not a file", p_file.string());
+    return FILE_ERROR;
+  }
+  case ok::runner::error::cant_write:
+  {
+    std::println(stderr, "can't write file: '{}'", p_file.string());
+    return FILE_ERROR;
+  }
+  default:
+  {
+    return UNKNOWN_ERROR;
+  }
+  }
+}
 
 int main(int argc, char** argv)
 {
   ok::vm::interpret_result res = ok::vm::interpret_result::ok;
-  if(argc == 1)
+  ok::compiler::options options;
+  bool emit_c = false;
+  std::filesystem::path compile_input;
+  std::filesystem::path output;
+  int arg = 1;
+  for(; arg < argc; ++arg)
+  {
+    const std::string_view flag = argv[arg];
+    if(flag == "--peephole")
+      options.peephole = true;
+    else if(flag == "--no-peephole")
+      options.peephole = false;
+    else if(flag == "--stack")
+      options.backend = ok::compiler::backend_type::stack;
+    else if(flag == "--registers")
+      options.backend = ok::compiler::backend_type::registers;
+    else if(flag == "--jit")
+      options.jit_threshold = default_jit_threshold;
+    else if(flag.starts_with("--jit="))
+    {
+      // --jit=<calls>, mostly for running the tests with everything compiled right away
+      if(!parse_threshold(flag, "--jit=", options.jit_threshold))
+        return USAGE_ERROR;
+    }
+    else if(flag == "--lazy")
+      options.lazy_functions = true;
+    else if(flag == "--stream")
+      options.stream_declarations = true;
+    else if(flag == "--emit-c")
+      emit_c = true;
+    else if(flag == "-c" && arg + 1 < argc)
+      compile_input = argv[++arg];
+    else if(flag == "-o" && arg + 1 < argc)
+      output = argv[++arg];
+    else if(flag == "--trace")
+      options.trace_threshold = default_trace_threshold;
+    else if(flag.starts_with("--trace="))
+    {
+      // --trace=<back edges>
+      if(!parse_threshold(flag, "--trace=", options.trace_threshold))
+        return USAGE_ERROR;
+    }
+    else
+      break;
+  }
+
+  const auto args = argc - arg;
+  if(args == 0 && !compile_input.empty())
+  {
+    // okc -c script.ok writes script.okb next to it unless -o says otherwise
+    if(output.empty())
+      output = std::filesystem::path{compile_input}.replace_extension(ok::runner::compiled_extension);
+    auto ret = ok::runner::compile(compile_input, output, options);
+    if(!ret.has_value())
+    {
+      return report_file_error(ret.error(), ret.error() == ok::runner::error::cant_write ? output : compile_input);
+    }
+    res = ret.value();
+  }
+  else if(args == 0 && arg == 1)
   {
     ok::repl::start();
   }
-  else if(argc == 2)
+  else if(args == 1)
   {
-    std::filesystem::path file = argv[1];
-    auto ret = ok::runner::start(file);
+    std::filesystem::path file = argv[arg];
+    auto ret = emit_c ? ok::runner::emit_c(file, output, options) : ok::runner::start(file, options);
     if(!ret.has_value())
     {
-      switch(ret.error())
-      {
-      case ok::runner::error::file_not_found:
-      {
-        std::println(stderr, "can't open file: '{}', reason: no such file or directory", file.string());
-        return FILE_ERROR;
-      }
-      case ok::runner::error::no_permission:
-      {
-        std::println(stderr, "can't open file: '{}', reason: permission denied", file.string());
-        return FILE_ERROR;
-      }
-      case ok::runner::error::not_a_file:
-      {
-        std::println(stderr, "can't open file: '{}', reason: not a file", file.string());
-        return FILE_ERROR;
-      }
-      default:
+      return report_file_error(ret.error(), ret.error() == ok::runner::error::cant_write ? output : file);
+    }
+    res = ret.value();
+  }
+  else if(args > 2 && arg == 1 && std::string_view{argv[arg]} == "--ngrams")
+  {
+    // okc --ngrams <n> <script or directory>...
+    const std::string_view n_str = argv[arg + 1];
+    size_t n = 0;
+    if(std::from_chars(n_str.data(), n_str.data() + n_str.size(), n).ec != std::errc{} || n == 0)
+    {
+      std::println(stderr, "invalid n-gram length: '{}'", n_str);
+      return USAGE_ERROR;
+    }
+    std::vector<std::filesystem::path> paths;
+    for(int i = arg + 2; i < argc; ++i)
+    {
+      paths.emplace_back(argv[i]);
+      if(!std::filesystem::exists(paths.back()))
       {
-        return UNKNOWN_ERROR;
-      }
+        return report_file_error(ok::runner::error::file_not_found, paths.back());
       }
     }
+    constexpr size_t top = 25;
+    auto ret = ok::runner::mine_ngrams(paths, n, top);
+    if(!ret.has_value())
+    {
+      return report_file_error(ret.error(), paths.front());
+    }
     res = ret.value();
   }
+  else
+  {
+    std::println(stderr,
+                 "usage: {} [--peephole | --no-peephole] [--stack | --registers] [--jit | --jit=<calls>] "
+                 "[--trace | --trace=<back edges>] [--lazy] [--stream] [script] | --emit-c [-o <output>] <script> | "
+                 "-c <script> [-o <output>] | --ngrams <n> <script or directory>...",
+                 argv[0]);
+    return USAGE_ERROR;
+  }
 
   return ok::to_utype(res);
-}
\ No newline at end of file
+}
@@ -220,10 +220,13 @@ namespace ok
       : up(object_type::obj_function, p_function_class, p_objects_list)
   {
     name = p_name;
+    arity = p_arity;
   }
 
   function_object::~function_object()
   {
+    delete jitted;
+    delete traces;
   }
 
   native_return_type function_object::equal(vm* p_vm, value_t, uint8_t p_argc)
@@ -372,6 +375,15 @@ namespace ok
                                                   p_argc)}}}};
     }
 
+    if(this_closure->function->lazy != nullptr && !p_vm->compile_lazy(this_closure->function))
+    {
+      return {.code = native_return_code::nrc_error,
+              .error{.code = value_error_code::call_error,
+                     .payload{value_t{std::format(
+                         "invalid call on closure, '{}' failed to compile",
+                         std::string_view{this_closure->function->name->chars, this_closure->function->name->length})}}}};
+    }
+
     const auto frame = call_frame{this_closure,
                                   this_closure->function->associated_chunk.code.data(),
                                   p_vm->frame_stack_top(),
@@ -902,6 +914,9 @@ namespace ok
     auto* closure_class = register_closure_class(objects, string_class, callable_class);
     p_vm->register_api_builtin((object*)closure_class, object_type::obj_closure, closure_class->name);
 
+    auto* bound_method_class = register_bound_method_class(objects, string_class, callable_class);
+    p_vm->register_builtin((object*)bound_method_class, object_type::obj_bound_method);
+
     p_vm->get_gc().resume();
     return true;
   }
@@ -3,8 +3,10 @@
 
 #include "call_frame.hpp"
 #include "chunk.hpp"
+#include "jit.hpp"
 #include "macros.hpp"
 #include "operator.hpp"
+#include "tracer.hpp"
 #include "utility.hpp"
 #include "value.hpp"
 #include "vm_stack.hpp"
@@ -66,6 +68,7 @@ namespace ok
   }
 
   struct class_object;
+  struct lazy_function;
   struct object
   {
     object* next = nullptr;
@@ -363,6 +366,10 @@ namespace ok
     string_object* name = nullptr;
     uint32_t upvalues = 0;
     uint8_t arity = 0;
+    jit_code* jitted = nullptr; // see jit::compile
+    uint32_t calls = 0;         // counted up to the jit threshold, the jit gets one try once it is crossed
+    trace_cache* traces = nullptr; // see vm::back_edge, made on the first back edge when tracing is on
+    lazy_function* lazy = nullptr; // the body is compiled on the first call, see compiler::compile_lazy
 
     static native_return_type equal(vm* p_vm, value_t p_this, uint8_t p_argc);
     static native_return_type bang_equal(vm* p_vm, value_t p_this, uint8_t p_argc);
@@ -413,6 +420,7 @@ namespace ok
     static native_return_type print(vm* p_vm, value_t p_this, uint8_t p_argc);
   };
 
+  struct bound_method_object;
   struct instance_object
   {
     instance_object(uint32_t p_instance_type, class_object* p_class, object*& p_objects_list);
@@ -423,6 +431,9 @@ namespace ok
 
     object up;
     std::unordered_map<string_object*, value_t> fields;
+    // bound methods already materialized for this receiver, keyed by the method they bind (closure or native
+    // pointer), so extracting the same method twice doesnt allocate
+    std::unordered_map<void*, bound_method_object*> bound_methods;
 
     static native_return_type print(vm* p_vm, value_t p_this, uint8_t p_argc);
     static native_return_type clone(vm* p_vm, value_t p_this, uint8_t p_argc);
@@ -0,0 +1,572 @@
+#include "optimizer.hpp"
+#include "verifier.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace ok
+{
+  namespace
+  {
+    constexpr size_t no_target = std::numeric_limits<size_t>::max();
+    constexpr size_t jump_length = 4;
+
+    struct peephole_instruction
+    {
+      std::vector<byte> code;
+      std::vector<size_t> source_offsets; // one per byte, as chunk::offsets is once expanded
+      std::vector<size_t> targets;        // index of the instruction each jump operand lands on
+      bool jump_target = false;
+      bool removed = false;
+
+      opcode op() const
+      {
+        return static_cast<opcode>(code[0]);
+      }
+    };
+  } // namespace
+
+  static bool is_jump(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+    case opcode::op_conditional_jump_leave:
+    case opcode::op_conditional_truthy_jump_leave:
+    case opcode::op_jump:
+    case opcode::op_loop:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static bool is_register_arithmetic(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add_rr:
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rr:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rr:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rr:
+    case opcode::op_divide_rk:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static bool is_register_jump(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rr_jump:
+    case opcode::op_less_equal_rk_jump:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // positions of the 24bit jump operands, every one is relative to the end of the instruction
+  static std::vector<size_t> jump_operands(opcode p_op)
+  {
+    if(is_jump(p_op))
+      return {1};
+    if(is_register_arithmetic(p_op))
+      return {4};
+    if(is_register_jump(p_op))
+      return {3, 6};
+    return {};
+  }
+
+  // pushes a value without any side effect, so a push followed by a pop does nothing
+  static bool is_pure_push(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_constant:
+    case opcode::op_constant_long:
+    case opcode::op_null:
+    case opcode::op_true:
+    case opcode::op_false:
+    case opcode::op_get_local:
+    case opcode::op_get_local_long:
+    case opcode::op_get_upvalue:
+    case opcode::op_get_upvalue_long:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static uint32_t pop_count(const peephole_instruction& p_instruction)
+  {
+    if(p_instruction.op() == opcode::op_pop)
+      return 1;
+    if(p_instruction.op() == opcode::op_pop_n)
+      return p_instruction.code[1];
+    return 0;
+  }
+
+  static void set_pop_count(peephole_instruction& p_instruction, uint32_t p_count)
+  {
+    ASSERT(p_count > 0 && p_count <= UINT8_MAX);
+    const auto source_offset = p_instruction.source_offsets.front();
+    if(p_count == 1)
+      p_instruction.code = {to_utype(opcode::op_pop)};
+    else
+      p_instruction.code = {to_utype(opcode::op_pop_n), static_cast<byte>(p_count)};
+    p_instruction.source_offsets.assign(p_instruction.code.size(), source_offset);
+  }
+
+  static bool same_operand(const peephole_instruction& p_lhs, const peephole_instruction& p_rhs)
+  {
+    return std::equal(p_lhs.code.begin() + 1, p_lhs.code.end(), p_rhs.code.begin() + 1, p_rhs.code.end());
+  }
+
+  static bool is_local_pair(const peephole_instruction& p_get, const peephole_instruction& p_set)
+  {
+    const auto short_pair = p_get.op() == opcode::op_get_local && p_set.op() == opcode::op_set_local;
+    const auto long_pair = p_get.op() == opcode::op_get_local_long && p_set.op() == opcode::op_set_local_long;
+    return (short_pair || long_pair) && same_operand(p_get, p_set);
+  }
+
+  static opcode unchecked_form(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add:
+      return opcode::op_add_unchecked;
+    case opcode::op_subtract:
+      return opcode::op_subtract_unchecked;
+    case opcode::op_multiply:
+      return opcode::op_multiply_unchecked;
+    case opcode::op_divide:
+      return opcode::op_divide_unchecked;
+    case opcode::op_greater:
+      return opcode::op_greater_unchecked;
+    case opcode::op_greater_equal:
+      return opcode::op_greater_equal_unchecked;
+    case opcode::op_less:
+      return opcode::op_less_unchecked;
+    case opcode::op_less_equal:
+      return opcode::op_less_equal_unchecked;
+    default:
+      return p_op;
+    }
+  }
+
+  static opcode checked_form(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add_unchecked:
+      return opcode::op_add;
+    case opcode::op_subtract_unchecked:
+      return opcode::op_subtract;
+    case opcode::op_multiply_unchecked:
+      return opcode::op_multiply;
+    case opcode::op_divide_unchecked:
+      return opcode::op_divide;
+    case opcode::op_greater_unchecked:
+      return opcode::op_greater;
+    case opcode::op_greater_equal_unchecked:
+      return opcode::op_greater_equal;
+    case opcode::op_less_unchecked:
+      return opcode::op_less;
+    case opcode::op_less_equal_unchecked:
+      return opcode::op_less_equal;
+    default:
+      return p_op;
+    }
+  }
+
+  // the register instruction that does p_op on a slot and a slot or constant, if there is one
+  static std::optional<opcode> register_form(opcode p_op, bool p_constant_rhs)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add:
+      return p_constant_rhs ? opcode::op_add_rk : opcode::op_add_rr;
+    case opcode::op_subtract:
+      return p_constant_rhs ? opcode::op_subtract_rk : opcode::op_subtract_rr;
+    case opcode::op_multiply:
+      return p_constant_rhs ? opcode::op_multiply_rk : opcode::op_multiply_rr;
+    case opcode::op_divide:
+      return p_constant_rhs ? opcode::op_divide_rk : opcode::op_divide_rr;
+    case opcode::op_greater:
+      return p_constant_rhs ? opcode::op_greater_rk_jump : opcode::op_greater_rr_jump;
+    case opcode::op_greater_equal:
+      return p_constant_rhs ? opcode::op_greater_equal_rk_jump : opcode::op_greater_equal_rr_jump;
+    case opcode::op_less:
+      return p_constant_rhs ? opcode::op_less_rk_jump : opcode::op_less_rr_jump;
+    case opcode::op_less_equal:
+      return p_constant_rhs ? opcode::op_less_equal_rk_jump : opcode::op_less_equal_rr_jump;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  // unchecked instructions match their generic forms, the superinstructions test the operands themselves
+  static bool match_sequence(const chunk& p_chunk, size_t p_offset, std::initializer_list<opcode> p_sequence)
+  {
+    for(auto op : p_sequence)
+    {
+      if(p_offset >= p_chunk.code.size() || checked_form(static_cast<opcode>(p_chunk.code[p_offset])) != op)
+        return false;
+      p_offset += instruction_length(p_chunk, p_offset);
+    }
+    return true;
+  }
+
+  void optimizer::fuse_superinstructions(chunk& p_chunk)
+  {
+    auto& code = p_chunk.code;
+    const auto number_constant = [&](size_t p_offset)
+    { return OK_IS_VALUE_NUMBER(p_chunk.constants[code[p_offset + 1]]); };
+
+    for(size_t offset = 0; offset < code.size(); offset += instruction_length(p_chunk, offset))
+    {
+      if(static_cast<opcode>(code[offset]) != opcode::op_get_local)
+        continue;
+
+      // the vm reads the operands of the whole sequence at fixed positions, so only the short forms are fused
+      if(match_sequence(p_chunk, offset, {opcode::op_get_local, opcode::op_get_local, opcode::op_add}))
+      {
+        code[offset] = to_utype(opcode::op_get_local_get_local_add);
+      }
+      else if(match_sequence(p_chunk,
+                             offset,
+                             {opcode::op_get_local, opcode::op_constant, opcode::op_less, opcode::op_conditional_jump}) &&
+              number_constant(offset + 2))
+      {
+        code[offset] = to_utype(opcode::op_get_local_constant_less_jump);
+      }
+      else if(match_sequence(
+                  p_chunk,
+                  offset,
+                  {opcode::op_get_local, opcode::op_constant, opcode::op_add, opcode::op_set_local, opcode::op_pop}) &&
+              number_constant(offset + 2))
+      {
+        code[offset] = to_utype(opcode::op_get_local_constant_add_set_local_pop);
+      }
+    }
+  }
+
+  void optimizer::specialize_numbers(chunk& p_chunk, uint8_t p_arity)
+  {
+    const auto offsets = verifier::number_operands(p_chunk, p_arity);
+    if(!offsets)
+      return;
+    for(auto offset : *offsets)
+      p_chunk.code[offset] = to_utype(unchecked_form(static_cast<opcode>(p_chunk.code[offset])));
+  }
+
+  void optimizer::despecialize_numbers(chunk& p_chunk)
+  {
+    for(size_t offset = 0; offset < p_chunk.code.size(); offset += instruction_length(p_chunk, offset))
+      p_chunk.code[offset] = to_utype(checked_form(static_cast<opcode>(p_chunk.code[offset])));
+  }
+
+  // splits the chunk into instructions and resolves every jump operand to the index of the instruction it lands on
+  static std::vector<peephole_instruction> decode(const chunk& p_chunk)
+  {
+    const auto& code = p_chunk.code;
+    std::vector<size_t> byte_offsets;
+    byte_offsets.reserve(code.size());
+    for(const auto& offset : p_chunk.offsets)
+      byte_offsets.insert(byte_offsets.end(), offset.reps, offset.offset);
+    ASSERT(byte_offsets.size() == code.size());
+
+    std::vector<peephole_instruction> instructions;
+    std::vector<size_t> starts;
+    std::vector<size_t> index_of(code.size() + 1, no_target);
+    for(size_t offset = 0; offset < code.size();)
+    {
+      const auto length = instruction_length(p_chunk, offset);
+      index_of[offset] = instructions.size();
+      starts.push_back(offset);
+      instructions.push_back({.code = {code.begin() + offset, code.begin() + offset + length},
+                              .source_offsets = {byte_offsets.begin() + offset,
+                                                 byte_offsets.begin() + offset + length}});
+      offset += length;
+    }
+    index_of[code.size()] = instructions.size();
+
+    for(size_t i = 0; i < instructions.size(); ++i)
+    {
+      auto& instruction = instructions[i];
+      const auto end = starts[i] + instruction.code.size();
+      for(auto position : jump_operands(instruction.op()))
+      {
+        const auto operand = decode_int<uint32_t, 3>(instruction.code, position);
+        const auto target = instruction.op() == opcode::op_loop ? end - operand : end + operand;
+        ASSERT(target <= code.size() && index_of[target] != no_target);
+        instruction.targets.push_back(index_of[target]);
+      }
+    }
+    return instructions;
+  }
+
+  // removed instructions pass their incoming jumps on to the next live one
+  static size_t resolve(const std::vector<peephole_instruction>& p_instructions, size_t p_index)
+  {
+    while(p_index < p_instructions.size() && p_instructions[p_index].removed)
+      ++p_index;
+    return p_index;
+  }
+
+  // writes the live instructions back into the chunk with their jump operands and the offsets table fixed up
+  static void encode(chunk& p_chunk, std::vector<peephole_instruction>& p_instructions)
+  {
+    const auto count = p_instructions.size();
+    std::vector<size_t> new_starts(count + 1);
+    size_t size = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+      new_starts[i] = size;
+      if(!p_instructions[i].removed)
+        size += p_instructions[i].code.size();
+    }
+    new_starts[count] = size;
+
+    p_chunk.code.clear();
+    p_chunk.offsets.clear();
+    for(size_t i = 0; i < count; ++i)
+    {
+      auto& instruction = p_instructions[i];
+      if(instruction.removed)
+        continue;
+      const auto positions = jump_operands(instruction.op());
+      ASSERT(positions.size() == instruction.targets.size());
+      for(size_t t = 0; t < positions.size(); ++t)
+      {
+        const auto end = new_starts[i] + instruction.code.size();
+        const auto target = new_starts[resolve(p_instructions, instruction.targets[t])];
+        const auto backward = instruction.op() == opcode::op_loop;
+        ASSERT(backward ? target <= end : target >= end);
+        const uint32_t operand = backward ? end - target : target - end;
+        ASSERT(operand <= uint24_max);
+        const auto bytes = encode_int<uint32_t, 3>(operand);
+        std::copy(bytes.begin(), bytes.end(), instruction.code.begin() + positions[t]);
+      }
+      for(size_t b = 0; b < instruction.code.size(); ++b)
+        p_chunk.write(instruction.code[b], instruction.source_offsets[b]);
+    }
+  }
+
+  void optimizer::peephole(chunk& p_chunk)
+  {
+    if(p_chunk.code.empty())
+      return;
+
+    auto instructions = decode(p_chunk);
+    const auto count = instructions.size();
+    const auto next_live = [&](size_t p_index) { return resolve(instructions, p_index + 1); };
+
+    bool changed = true;
+    while(changed)
+    {
+      changed = false;
+
+      for(auto& instruction : instructions)
+        instruction.jump_target = false;
+      for(const auto& instruction : instructions)
+      {
+        if(instruction.removed)
+          continue;
+        for(auto target : instruction.targets)
+        {
+          target = resolve(instructions, target);
+          if(target < count)
+            instructions[target].jump_target = true;
+        }
+      }
+
+      // only the first instruction of a rewritten sequence may be jumped to, so every rule checks the ones after it
+      for(size_t i = resolve(instructions, 0); i < count; i = next_live(i))
+      {
+        auto& current = instructions[i];
+        const auto j = next_live(i);
+        if(is_jump(current.op()) && current.op() != opcode::op_loop)
+        {
+          // follow op_jump chains, forward only since these jumps cant encode a backward offset
+          auto& current_target = current.targets.front();
+          auto target = resolve(instructions, current_target);
+          for(size_t hops = 0; target < count && instructions[target].op() == opcode::op_jump && hops < count; ++hops)
+          {
+            const auto next = resolve(instructions, instructions[target].targets.front());
+            if(next <= i)
+              break;
+            target = next;
+          }
+          if(target != resolve(instructions, current_target))
+          {
+            current_target = target;
+            changed = true;
+          }
+          if(current.op() == opcode::op_jump && target == j)
+          {
+            current.removed = true;
+            changed = true;
+          }
+          continue;
+        }
+        if(j >= count || instructions[j].jump_target)
+          continue;
+        auto& next = instructions[j];
+
+        if(is_pure_push(current.op()) && pop_count(next) > 0)
+        {
+          current.removed = true;
+          if(pop_count(next) == 1)
+            next.removed = true;
+          else
+            set_pop_count(next, pop_count(next) - 1);
+          changed = true;
+        }
+        else if(pop_count(current) > 0 && pop_count(next) > 0 && pop_count(current) + pop_count(next) <= UINT8_MAX)
+        {
+          set_pop_count(current, pop_count(current) + pop_count(next));
+          next.removed = true;
+          changed = true;
+        }
+        else if(is_local_pair(current, next))
+        {
+          // the set stores the value the get just read
+          next.removed = true;
+          changed = true;
+        }
+        else if(next.op() == opcode::op_pop)
+        {
+          // op_set_local leaves the value on the stack, so popping it to read the same local again is a no-op
+          const auto k = next_live(j);
+          if(k < count && !instructions[k].jump_target && is_local_pair(instructions[k], current))
+          {
+            next.removed = true;
+            instructions[k].removed = true;
+            changed = true;
+          }
+        }
+      }
+    }
+
+    // everything only got shorter, so the 24bit jump operands still fit
+    encode(p_chunk, instructions);
+  }
+
+  void optimizer::allocate_registers(chunk& p_chunk)
+  {
+    if(p_chunk.code.empty())
+      return;
+
+    auto instructions = decode(p_chunk);
+    const auto count = instructions.size();
+    for(const auto& instruction : instructions)
+    {
+      for(auto target : instruction.targets)
+      {
+        if(target < count)
+          instructions[target].jump_target = true;
+      }
+    }
+    const auto is_slot = [&](size_t p_index) { return instructions[p_index].op() == opcode::op_get_local; };
+    const auto is_number_constant = [&](size_t p_index)
+    {
+      return instructions[p_index].op() == opcode::op_constant &&
+             OK_IS_VALUE_NUMBER(p_chunk.constants[instructions[p_index].code[1]]);
+    };
+    // everything but the first instruction of a sequence goes away, so nothing may jump into the middle of it
+    const auto straight = [&](size_t p_first, size_t p_last)
+    {
+      for(auto i = p_first + 1; i <= p_last; ++i)
+      {
+        if(instructions[i].jump_target)
+          return false;
+      }
+      return true;
+    };
+    const auto make = [](opcode p_op, std::vector<byte> p_operands, size_t p_source_offset)
+    {
+      peephole_instruction instruction{.code = std::move(p_operands)};
+      instruction.code.insert(instruction.code.begin(), to_utype(p_op));
+      instruction.source_offsets.assign(instruction.code.size(), p_source_offset);
+      return instruction;
+    };
+
+    // the operands are the slots the compiler gave the locals, so the register of a local is its slot and the stubs
+    // reuse the original instructions which keeps their source offsets for runtime errors
+    // index count is the first stub once they are appended, so every jump back from a stub lands below it
+    std::vector<peephole_instruction> stubs;
+    for(size_t i = 0; i + 3 < count; ++i)
+    {
+      if(!is_slot(i) || !(is_slot(i + 1) || is_number_constant(i + 1)))
+        continue;
+      const auto form = register_form(checked_form(instructions[i + 2].op()), !is_slot(i + 1));
+      if(!form)
+        continue;
+      const auto lhs = instructions[i].code[1];
+      const auto rhs = instructions[i + 1].code[1];
+      const auto source_offset = instructions[i + 2].source_offsets.front();
+      const auto stub = count + stubs.size();
+
+      if(is_register_arithmetic(*form))
+      {
+        // a = b op c; is op_get_local b, op_get_local c, op, op_set_local a, op_pop
+        if(i + 5 >= count || instructions[i + 3].op() != opcode::op_set_local ||
+           instructions[i + 4].op() != opcode::op_pop || !straight(i, i + 4))
+          continue;
+        const auto dst = instructions[i + 3].code[1];
+        stubs.push_back(std::move(instructions[i + 2]));
+        stubs.push_back(std::move(instructions[i + 3]));
+        stubs.push_back(std::move(instructions[i + 4]));
+        stubs.push_back(make(opcode::op_loop, {0, 0, 0}, source_offset));
+        stubs.back().targets = {i + 5};
+        instructions[i] = make(*form, {dst, lhs, rhs, 0, 0, 0}, source_offset);
+        instructions[i].targets = {stub};
+        for(auto k = i + 1; k <= i + 4; ++k)
+          instructions[k].removed = true;
+        i += 4;
+      }
+      else
+      {
+        // op_get_local b, op_get_local c, op, op_conditional_jump exit. the stub can only jump backward with op_loop,
+        // so a failed compare goes through a second op_loop to exit
+        if(i + 4 >= count || instructions[i + 3].op() != opcode::op_conditional_jump || !straight(i, i + 3) ||
+           instructions[i + 3].targets.front() >= count)
+          continue;
+        const auto exit = instructions[i + 3].targets.front();
+        stubs.push_back(std::move(instructions[i + 2]));
+        stubs.push_back(std::move(instructions[i + 3]));
+        stubs.back().targets = {stub + 3};
+        stubs.push_back(make(opcode::op_loop, {0, 0, 0}, source_offset));
+        stubs.back().targets = {i + 4};
+        stubs.push_back(make(opcode::op_loop, {0, 0, 0}, source_offset));
+        stubs.back().targets = {exit};
+        instructions[i] = make(*form, {lhs, rhs, 0, 0, 0, 0, 0, 0}, source_offset);
+        instructions[i].targets = {exit, stub};
+        for(auto k = i + 1; k <= i + 3; ++k)
+          instructions[k].removed = true;
+        i += 3;
+      }
+    }
+    if(stubs.empty())
+      return;
+
+    instructions.insert(instructions.end(), std::make_move_iterator(stubs.begin()), std::make_move_iterator(stubs.end()));
+    encode(p_chunk, instructions);
+  }
+} // namespace ok
@@ -0,0 +1,29 @@
+#ifndef OK_OPTIMIZER_HPP
+#define OK_OPTIMIZER_HPP
+
+#include "chunk.hpp"
+
+namespace ok
+{
+  // bytecode level passes, they run on a function chunk once the compiler is done emitting it
+  struct optimizer
+  {
+    // marks the sequences that have a superinstruction by rewriting their first opcode, nothing moves so jumps and the
+    // offsets table stay valid
+    static void fuse_superinstructions(chunk& p_chunk);
+    // threads jump chains, drops pushes that are popped right away, merges adjacent pops into op_pop_n and removes
+    // redundant op_get_local/op_set_local pairs. the chunk is re-encoded so jumps and the offsets table are fixed up
+    static void peephole(chunk& p_chunk);
+    // rewrites the arithmetic and comparison instructions the verifier proves only ever see numbers to their unchecked
+    // forms. nothing moves, the unchecked instructions have the size of the generic ones
+    static void specialize_numbers(chunk& p_chunk, uint8_t p_arity);
+    // rewrites every unchecked instruction back to the generic one
+    static void despecialize_numbers(chunk& p_chunk);
+    // the register backend. rewrites the stack sequences that compute on locals and constants, a = b op c; and the
+    // loop and if conditions b < c, into three address instructions that work on the frame's slots. the replaced
+    // instructions move to stubs at the end of the chunk that run when an operand is not a number
+    static void allocate_registers(chunk& p_chunk);
+  };
+} // namespace ok
+
+#endif // OK_OPTIMIZER_HPP
@@ -113,8 +113,15 @@ namespace ok
     return true;
   }();
 
-  parser::parser(token_array& p_token_array, std::string_view p_filename, std::string_view p_filecontent)
-      : m_token_array(p_token_array), m_file_name(p_filename), m_file_content(p_filecontent)
+  parser::parser(lexer& p_lexer,
+                 std::pmr::memory_resource* p_arena,
+                 std::string_view p_filename,
+                 std::string_view p_filecontent)
+      : m_lexer(p_lexer),
+        m_arena(p_arena),
+        m_file_name(p_filename),
+        m_file_content(p_filecontent),
+        m_lookahead(p_lexer.next())
   {
     advance();
   }
@@ -127,7 +134,7 @@ namespace ok
   // TODO(Qais): i think this off by one problem is a common problem in parsers. so if you really want to design this
   // in an actually bullet proof/clean way, you might want to introduce something like advancement policy and state
   // synchronizer or santi checker or something like that idk tbh
-  std::unique_ptr<ast::expression> parser::parse_expression(int p_precedence)
+  ast::ptr<ast::expression> parser::parse_expression(int p_precedence)
   {
     auto tok = current_token();
     auto prefix_it = s_prefix_parse_map.find(tok.type);
@@ -156,32 +163,38 @@ namespace ok
     return left;
   }
 
-  std::unique_ptr<ast::program> parser::parse_program()
+  ast::ptr<ast::program> parser::parse_program()
   {
-    if(m_token_array.empty())
+    if(m_file_content.empty())
       return nullptr;
-    auto tok = current_token();
-    std::list<std::unique_ptr<ast::statement>> list;
+    ast::list<ast::statement> list(m_arena);
 
-    while(tok.type != token_type::tok_eof)
+    while(!at_end())
     {
-      if(auto stmt = parse_declaration())
-      {
-        if(stmt->get_type() != ast::node_type::nt_empty_stmt)
-        {
-          list.push_back(std::move(stmt));
-        }
-      }
-      advance();
-      tok = current_token();
+      if(auto stmt = parse_top_level_declaration())
+        list.push_back(std::move(stmt));
     }
 
-    return std::make_unique<ast::program>(std::move(list));
+    return ast::make<ast::program>(m_arena, std::move(list));
+  }
+
+  ast::ptr<ast::statement> parser::parse_top_level_declaration()
+  {
+    auto stmt = parse_declaration();
+    advance();
+    if(stmt != nullptr && stmt->get_type() == ast::node_type::nt_empty_stmt)
+      return nullptr;
+    return stmt;
   }
 
-  std::unique_ptr<ast::statement> parser::parse_declaration()
+  bool parser::at_end() const
   {
-    std::unique_ptr<ast::statement> ret;
+    return current_token().type == token_type::tok_eof;
+  }
+
+  ast::ptr<ast::statement> parser::parse_declaration()
+  {
+    ast::ptr<ast::statement> ret;
     std::unordered_map<uint8_t, token> mods_toks;
     const auto mods = parse_declaration_modifiers(&mods_toks);
 
@@ -381,7 +394,7 @@ namespace ok
     return true;
   }
 
-  std::unique_ptr<ast::statement> parser::parse_statement()
+  ast::ptr<ast::statement> parser::parse_statement()
   {
     switch(current_token().type)
     {
@@ -403,7 +416,7 @@ namespace ok
     case token_type::tok_semicolon:
     {
       const auto semicolon = current_token();
-      return std::make_unique<ast::empty_statement>(semicolon);
+      return ast::make<ast::empty_statement>(m_arena, semicolon);
     }
     case token_type::tok_eof:
       return nullptr;
@@ -412,11 +425,11 @@ namespace ok
     }
   }
 
-  std::unique_ptr<ast::expression_statement> parser::parse_expression_statement()
+  ast::ptr<ast::expression_statement> parser::parse_expression_statement()
   {
     auto trigger_tok = current_token();
     auto expr = parse_expression();
-    auto expr_stmt = std::make_unique<ast::expression_statement>(trigger_tok, std::move(expr));
+    auto expr_stmt = ast::make<ast::expression_statement>(m_arena, trigger_tok, std::move(expr));
     if(lookahead_token().type != token_type::tok_semicolon)
     {
       auto tok = current_token();
@@ -432,7 +445,7 @@ namespace ok
     return expr_stmt;
   }
 
-  std::unique_ptr<ast::print_statement> parser::parse_print_statement()
+  ast::ptr<ast::print_statement> parser::parse_print_statement()
   {
     auto print_tok = current_token();
     advance();
@@ -450,10 +463,10 @@ namespace ok
 
     advance();
 
-    return std::make_unique<ast::print_statement>(print_tok, std::move(expr));
+    return ast::make<ast::print_statement>(m_arena, print_tok, std::move(expr));
   }
 
-  std::unique_ptr<ast::control_flow_statement> parser::parse_control_flow_statement()
+  ast::ptr<ast::control_flow_statement> parser::parse_control_flow_statement()
   {
     auto cf_tok = current_token();
     if(lookahead_token().type != token_type::tok_semicolon)
@@ -467,13 +480,13 @@ namespace ok
                   tok.raw_literal);
     }
     advance();
-    return std::make_unique<ast::control_flow_statement>(cf_tok);
+    return ast::make<ast::control_flow_statement>(m_arena, cf_tok);
   }
 
-  std::unique_ptr<ast::return_statement> parser::parse_return_statement()
+  ast::ptr<ast::return_statement> parser::parse_return_statement()
   {
     auto ret_tok = current_token();
-    std::unique_ptr<ast::expression> expr = nullptr;
+    ast::ptr<ast::expression> expr = nullptr;
     if(lookahead_token().type != token_type::tok_semicolon)
     {
       advance();
@@ -490,13 +503,13 @@ namespace ok
                   tok.raw_literal);
     }
     advance();
-    return std::make_unique<ast::return_statement>(ret_tok, std::move(expr));
+    return ast::make<ast::return_statement>(m_arena, ret_tok, std::move(expr));
   }
 
-  std::unique_ptr<ast::block_statement> parser::parse_block_statement()
+  ast::ptr<ast::block_statement> parser::parse_block_statement()
   {
     auto trigger_tok = current_token();
-    std::list<std::unique_ptr<ast::statement>> statements;
+    ast::list<ast::statement> statements(m_arena);
     while(lookahead_token().type != token_type::tok_right_brace && lookahead_token().type != token_type::tok_eof)
     {
       advance();
@@ -516,10 +529,10 @@ namespace ok
     advance();
     if(lookahead_token().type == token_type::tok_semicolon)
       advance(); // skip semicolon if present
-    return std::make_unique<ast::block_statement>(trigger_tok, std::move(statements));
+    return ast::make<ast::block_statement>(m_arena, trigger_tok, std::move(statements));
   }
 
-  std::unique_ptr<ast::if_statement> parser::parse_if_statement()
+  ast::ptr<ast::if_statement> parser::parse_if_statement()
   {
     auto if_token = current_token();
     advance();
@@ -541,7 +554,7 @@ namespace ok
     {
       parse_error(error::code::expected_statement, arrow_tok.line, arrow_tok.offset, arrow_tok.raw_literal);
     }
-    std::unique_ptr<ast::statement> alt = nullptr;
+    ast::ptr<ast::statement> alt = nullptr;
     auto lat = lookahead_token().type;
     if(lat == token_type::tok_else)
     {
@@ -556,10 +569,10 @@ namespace ok
         parse_error(error::code::expected_statement, tok.line, tok.offset, tok.raw_literal);
       }
     }
-    return std::make_unique<ast::if_statement>(if_token, std::move(expr), std::move(cons), std::move(alt));
+    return ast::make<ast::if_statement>(m_arena, if_token, std::move(expr), std::move(cons), std::move(alt));
   }
 
-  std::unique_ptr<ast::while_statement> parser::parse_while_statement()
+  ast::ptr<ast::while_statement> parser::parse_while_statement()
   {
     auto while_token = current_token();
     advance();
@@ -581,16 +594,16 @@ namespace ok
       auto tok = current_token();
       parse_error(error::code::expected_statement, tok.line, tok.offset, tok.raw_literal);
     }
-    return std::make_unique<ast::while_statement>(while_token, std::move(expr), std::move(body));
+    return ast::make<ast::while_statement>(m_arena, while_token, std::move(expr), std::move(body));
   }
 
-  std::unique_ptr<ast::for_statement> parser::parse_for_statement()
+  ast::ptr<ast::for_statement> parser::parse_for_statement()
   {
     auto for_token = current_token();
-    std::unique_ptr<ast::statement> body;
-    std::unique_ptr<ast::statement> init = nullptr;
-    std::unique_ptr<ast::expression> cond = nullptr;
-    std::unique_ptr<ast::expression> inc = nullptr;
+    ast::ptr<ast::statement> body;
+    ast::ptr<ast::statement> init = nullptr;
+    ast::ptr<ast::expression> cond = nullptr;
+    ast::ptr<ast::expression> inc = nullptr;
     advance();
     if(current_token().type == token_type::tok_semicolon)
     {
@@ -675,11 +688,15 @@ namespace ok
       parse_error(
           error::code::expected_statement, tok.line, tok.offset, tok.raw_literal, "expected statement as 'for' body");
     }
-    return std::make_unique<ast::for_statement>(
-        for_token, std::move(body), std::move(init), std::move(cond), std::move(inc));
+    return ast::make<ast::for_statement>(m_arena,
+                                         for_token,
+                                         std::move(body),
+                                         std::move(init),
+                                         std::move(cond),
+                                         std::move(inc));
   }
 
-  std::unique_ptr<ast::let_declaration> parser::parse_let_declaration(ast::declaration_modifier p_declmods)
+  ast::ptr<ast::let_declaration> parser::parse_let_declaration(ast::declaration_modifier p_declmods)
   {
     auto let_tok = current_token();
     advance();
@@ -687,8 +704,8 @@ namespace ok
     const auto bindmods = parse_binding_modifiers(&mods_toks);
     validate_binding_modifiers(bindmods, let_bindmods, mods_toks);
 
-    std::unique_ptr<ast::binding> binding;
-    std::unique_ptr<ast::expression> value = std::make_unique<ast::null_expression>(let_tok);
+    ast::ptr<ast::binding> binding;
+    ast::ptr<ast::expression> value = ast::make<ast::null_expression>(m_arena, let_tok);
 
     auto expr = parse_expression();
     if(expr)
@@ -703,12 +720,12 @@ namespace ok
           goto EXPECTED_IDENT;
         }
         auto left_ident = (ast::identifier_expression*)left.get();
-        binding = std::make_unique<ast::binding>(left_ident->get_token(), left_ident->get_value(), bindmods);
+        binding = ast::make<ast::binding>(m_arena, left_ident->get_token(), left_ident->get_value(), bindmods);
       }
       else if(expr->get_type() == ast::node_type::nt_identifier_expr)
       {
         auto ident = (ast::identifier_expression*)expr.get();
-        binding = std::make_unique<ast::binding>(ident->get_token(), ident->get_value(), bindmods);
+        binding = ast::make<ast::binding>(m_arena, ident->get_token(), ident->get_value(), bindmods);
       }
       else
       {
@@ -733,17 +750,17 @@ namespace ok
           error::code::expected_token, tok.line, tok.offset, tok.raw_literal, "expected ';', after: let declaration");
     }
 
-    return std::make_unique<ast::let_declaration>(let_tok, std::move(binding), std::move(value), p_declmods);
+    return ast::make<ast::let_declaration>(m_arena, let_tok, std::move(binding), std::move(value), p_declmods);
   }
 
-  std::unique_ptr<ast::function_declaration> parser::parse_function_declaration(ast::declaration_modifier p_mods)
+  ast::ptr<ast::function_declaration> parser::parse_function_declaration(ast::declaration_modifier p_mods)
   {
     auto fu_token = current_token();
     advance();
     return parse_function_declaration_impl(fu_token, p_mods, function_bindmods, "function");
   }
 
-  std::unique_ptr<ast::function_declaration>
+  ast::ptr<ast::function_declaration>
   parser::parse_function_declaration_impl(token p_trigger,
                                           ast::declaration_modifier p_mods,
                                           ast::binding_modifier p_allowed_binding_mods,
@@ -751,7 +768,7 @@ namespace ok
                                           unique_overridable_operator_type p_allowed_overrides,
                                           unique_overridable_operator_type* p_out_op_type)
   {
-    std::unique_ptr<ast::binding> binding;
+    ast::ptr<ast::binding> binding;
     std::unordered_map<uint8_t, token> mods_toks;
     const auto mods = parse_binding_modifiers(&mods_toks);
     token tok;
@@ -796,7 +813,7 @@ namespace ok
           else
           {
             advance();
-            tok.raw_literal += current_token().raw_literal;
+            tok.raw_literal = expect == token_type::tok_right_paren ? "()" : "[]";
           }
         }
       }
@@ -820,7 +837,7 @@ namespace ok
     }
 
     validate_binding_modifiers(mods, p_allowed_binding_mods, mods_toks);
-    binding = std::make_unique<ast::binding>(tok, tok.raw_literal, mods);
+    binding = ast::make<ast::binding>(m_arena, tok, tok.raw_literal, mods);
     advance();
 
     // else keep it null, because mods doesnt affect anything, compiler will worn about this situation
@@ -831,7 +848,7 @@ namespace ok
           error::code::expected_token, tok.line, tok.offset, tok.raw_literal, "expected '(' in {} declaration", callit);
     }
     advance();
-    std::list<std::unique_ptr<ast::binding>> params;
+    ast::list<ast::binding> params(m_arena);
     if(current_token().type != token_type::tok_right_paren)
     {
       while(current_token().type != token_type::tok_right_paren && current_token().type != token_type::tok_eof)
@@ -841,7 +858,7 @@ namespace ok
         validate_binding_modifiers(mods, function_param_bindmods, mods_toks);
         auto tok = current_token();
         advance();
-        params.push_back(std::make_unique<ast::binding>(tok, tok.raw_literal, mods));
+        params.push_back(ast::make<ast::binding>(m_arena, tok, tok.raw_literal, mods));
         if(current_token().type == token_type::tok_comma)
         {
           advance();
@@ -883,7 +900,7 @@ namespace ok
       // {
       //   parse_error(error::code::expected_identifier, "expected identifier as {} parameter", callit);
       // }
-      // params.push_back(std::make_unique<ast::binding>(tok, tok.raw_literal(), mods));
+      // params.push_back(ast::make<ast::binding>(m_arena, tok, tok.raw_literal(), mods));
       // advance();
       // while(current_token().type == token_type::tok_comma)
       // {
@@ -901,10 +918,10 @@ namespace ok
       //   {
       //     parse_error(error::code::expected_identifier, "expected identifier as {} parameter", callit);
       //   }
-      //   params.push_back(std::make_unique<ast::binding>(tok, tok.raw_literal(), mods));
+      //   params.push_back(ast::make<ast::binding>(m_arena, tok, tok.raw_literal(), mods));
       // }
       // auto tok = current_token();
-      // params.push_back(std::make_unique<ast::identifier_expression>(tok, tok.raw_literal));
+      // params.push_back(ast::make<ast::identifier_expression>(m_arena, tok, tok.raw_literal));
       // while(lookahead_token().type == token_type::tok_comma)
       // {
       //   advance();
@@ -914,7 +931,7 @@ namespace ok
       //   {
       //     parse_error(error::code::expected_identifier, "expected identifier as {} parameter", callit);
       //   }
-      //   params.push_back(std::make_unique<ast::identifier_expression>(tok, tok.raw_literal));
+      //   params.push_back(ast::make<ast::identifier_expression>(m_arena, tok, tok.raw_literal));
       // }
       // advance();
     }
@@ -951,11 +968,15 @@ namespace ok
 
     auto body = parse_statement();
 
-    return std::make_unique<ast::function_declaration>(
-        p_trigger, std::move(body), std::move(binding), std::move(params), p_mods);
+    return ast::make<ast::function_declaration>(m_arena,
+                                                p_trigger,
+                                                std::move(body),
+                                                std::move(binding),
+                                                std::move(params),
+                                                p_mods);
   }
 
-  std::unique_ptr<ast::class_declaration> parser::parse_class_declaration(ast::declaration_modifier p_mods)
+  ast::ptr<ast::class_declaration> parser::parse_class_declaration(ast::declaration_modifier p_mods)
   {
     auto cls_token = current_token();
     advance();
@@ -969,8 +990,8 @@ namespace ok
     validate_binding_modifiers(mods, class_bindmods, mods_toks);
     auto tok = current_token();
     advance();
-    auto binding = std::make_unique<ast::binding>(tok, tok.raw_literal, mods);
-    std::unique_ptr<ast::identifier_expression> super = nullptr;
+    auto binding = ast::make<ast::binding>(m_arena, tok, tok.raw_literal, mods);
+    ast::ptr<ast::identifier_expression> super = nullptr;
     // advance();
 
     if(current_token().type == token_type::tok_inherits)
@@ -983,7 +1004,7 @@ namespace ok
       }
       advance();
       auto curr = current_token();
-      super = std::make_unique<ast::identifier_expression>(curr, curr.raw_literal);
+      super = ast::make<ast::identifier_expression>(m_arena, curr, curr.raw_literal);
       advance();
     }
 
@@ -995,7 +1016,7 @@ namespace ok
     }
     advance();
 
-    std::list<ast::class_declaration::method_declaration> methods;
+    std::pmr::vector<ast::class_declaration::method_declaration> methods(m_arena);
     while(current_token().type != token_type::tok_right_brace && current_token().type != token_type::tok_eof)
     {
       std::unordered_map<uint8_t, token> mods_toks;
@@ -1050,8 +1071,12 @@ namespace ok
     }
     // advance();
 
-    return std::make_unique<ast::class_declaration>(
-        cls_token, std::move(binding), std::move(methods), std::move(super), p_mods);
+    return ast::make<ast::class_declaration>(m_arena,
+                                             cls_token,
+                                             std::move(binding),
+                                             std::move(methods),
+                                             std::move(super),
+                                             p_mods);
   }
 
   ast::class_declaration::method_declaration parser::parse_operator_overload(ast::declaration_modifier p_dm)
@@ -1071,12 +1096,10 @@ namespace ok
 
   bool parser::advance()
   {
-    if(m_lookahead_token >= m_token_array.size() - 1)
-    {
-      m_current_token = m_lookahead_token;
+    m_current = m_lookahead;
+    if(m_current.type == token_type::tok_eof)
       return false; // cant advance, no more tokens!
-    }
-    m_current_token = m_lookahead_token++;
+    m_lookahead = m_lexer.next();
     return true;
   }
 
@@ -1104,14 +1127,14 @@ namespace ok
     return precedence::prec_lowest;
   }
 
-  token parser::current_token() const
+  const token& parser::current_token() const
   {
-    return m_token_array[m_current_token];
+    return m_current;
   }
 
-  token parser::lookahead_token() const
+  const token& parser::lookahead_token() const
   {
-    return m_token_array[m_lookahead_token];
+    return m_lookahead;
   }
 
   void parser::sync_state()
@@ -1146,6 +1169,16 @@ namespace ok
     return m_errors;
   }
 
+  auto parser::get_arena() const -> std::pmr::memory_resource*
+  {
+    return m_arena;
+  }
+
+  void parser::set_arena(std::pmr::memory_resource* p_arena)
+  {
+    m_arena = p_arena;
+  }
+
   std::string parser::get_line(size_t p_line)
   {
     std::stringstream ss;
@@ -2,10 +2,12 @@
 #define OK_PARSER_HPP
 
 #include "ast.hpp"
+#include "lexer.hpp"
 #include "operator.hpp"
 #include "token.hpp"
 #include "utility.hpp"
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -96,16 +98,24 @@ namespace ok
     };
 
   public:
-    parser(token_array& p_token_array, std::string_view p_file_path, std::string_view p_file_content);
-    std::unique_ptr<ast::program> parse_program();
-    std::unique_ptr<ast::expression> parse_expression(int p_precedence = precedence::prec_lowest);
+    // pulls tokens from p_lexer as it goes, the lexer has to be started on p_file_content.
+    // nodes are placed in p_arena, which has to outlive the returned trees
+    parser(lexer& p_lexer,
+           std::pmr::memory_resource* p_arena,
+           std::string_view p_file_path,
+           std::string_view p_file_content);
+    ast::ptr<ast::program> parse_program();
+    // parses one declaration of the program at a time, null for empty and failed ones, stop once at_end
+    ast::ptr<ast::statement> parse_top_level_declaration();
+    bool at_end() const;
+    ast::ptr<ast::expression> parse_expression(int p_precedence = precedence::prec_lowest);
     ast::binding_modifier parse_binding_modifiers(std::unordered_map<uint8_t, token>* p_out_tokens = nullptr);
 
     template <typename... Args>
     void parse_error(error::code p_code,
                      size_t p_line,
                      size_t p_offset,
-                     std::string p_raw,
+                     std::string_view p_raw,
                      std::format_string<Args...> p_fmt = "",
                      Args&&... args)
     {
@@ -119,36 +129,38 @@ namespace ok
                                  p_offset,
                                  std::string{m_file_name},
                                  content,
-                                 p_raw,
+                                 std::string{p_raw},
                                  std::format(p_fmt, std::forward<Args>(args)...));
     }
 
     bool advance();
     bool expect_next(token_type p_type);
 
-    token current_token() const;
-    token lookahead_token() const;
+    const token& current_token() const;
+    const token& lookahead_token() const;
     const errors& get_errors() const;
+    std::pmr::memory_resource* get_arena() const;
+    void set_arena(std::pmr::memory_resource* p_arena);
 
   private:
     int get_precedence(token_type p_type);
-    std::unique_ptr<ast::statement> parse_statement();
-    std::unique_ptr<ast::expression_statement> parse_expression_statement();
-    std::unique_ptr<ast::statement> parse_declaration();
-    std::unique_ptr<ast::print_statement> parse_print_statement();
-    std::unique_ptr<ast::block_statement> parse_block_statement();
-    std::unique_ptr<ast::if_statement> parse_if_statement();
-    std::unique_ptr<ast::while_statement> parse_while_statement();
-    std::unique_ptr<ast::for_statement> parse_for_statement();
-    std::unique_ptr<ast::control_flow_statement> parse_control_flow_statement();
-    std::unique_ptr<ast::return_statement> parse_return_statement();
+    ast::ptr<ast::statement> parse_statement();
+    ast::ptr<ast::expression_statement> parse_expression_statement();
+    ast::ptr<ast::statement> parse_declaration();
+    ast::ptr<ast::print_statement> parse_print_statement();
+    ast::ptr<ast::block_statement> parse_block_statement();
+    ast::ptr<ast::if_statement> parse_if_statement();
+    ast::ptr<ast::while_statement> parse_while_statement();
+    ast::ptr<ast::for_statement> parse_for_statement();
+    ast::ptr<ast::control_flow_statement> parse_control_flow_statement();
+    ast::ptr<ast::return_statement> parse_return_statement();
 
     ast::class_declaration::method_declaration parse_operator_overload(ast::declaration_modifier p_dm);
 
-    std::unique_ptr<ast::let_declaration> parse_let_declaration(ast::declaration_modifier p_modifiers);
-    std::unique_ptr<ast::function_declaration> parse_function_declaration(ast::declaration_modifier p_modifiers);
-    std::unique_ptr<ast::class_declaration> parse_class_declaration(ast::declaration_modifier p_modifiers);
-    std::unique_ptr<ast::function_declaration> parse_function_declaration_impl(
+    ast::ptr<ast::let_declaration> parse_let_declaration(ast::declaration_modifier p_modifiers);
+    ast::ptr<ast::function_declaration> parse_function_declaration(ast::declaration_modifier p_modifiers);
+    ast::ptr<ast::class_declaration> parse_class_declaration(ast::declaration_modifier p_modifiers);
+    ast::ptr<ast::function_declaration> parse_function_declaration_impl(
         token p_trigger,
         ast::declaration_modifier p_modifiers,
         ast::binding_modifier p_allowed_binding_mods,
@@ -172,11 +184,12 @@ namespace ok
     std::string get_line(size_t p_line);
 
   private:
-    token_array& m_token_array;
+    lexer& m_lexer;
+    std::pmr::memory_resource* m_arena = nullptr;
     std::string_view m_file_name = "";
     std::string_view m_file_content = "";
-    size_t m_current_token = 0;
-    size_t m_lookahead_token = 0;
+    token m_current{};
+    token m_lookahead{};
     bool m_paranoia = false;
     errors m_errors;
 
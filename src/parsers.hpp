@@ -5,17 +5,18 @@
 #include "operator.hpp"
 #include "parser.hpp"
 #include "token.hpp"
+#include <charconv>
 #include <cstdlib>
-#include <list>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 // is the ood best fit here? or just plain parse functions will do?
 namespace ok
 {
-  inline std::list<std::unique_ptr<ast::expression>> parse_expression_list(parser& p_parser, token expected_end)
+  inline ast::list<ast::expression> parse_expression_list(parser& p_parser, token expected_end)
   {
-    std::list<std::unique_ptr<ast::expression>> args;
+    ast::list<ast::expression> args(p_parser.get_arena());
     while(p_parser.lookahead_token().type != expected_end.type &&
           p_parser.lookahead_token().type != token_type::tok_eof)
     {
@@ -59,72 +60,81 @@ namespace ok
   {
     prefix_parser_base() = default;
     virtual ~prefix_parser_base() = default;
-    virtual std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const = 0;
+    virtual ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const = 0;
   };
 
   struct identifier_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      return std::make_unique<ast::identifier_expression>(p_tok, p_tok.raw_literal);
+      return ast::make<ast::identifier_expression>(p_parser.get_arena(), p_tok, p_tok.raw_literal);
     }
   };
 
   struct number_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      auto c_str = p_tok.raw_literal.c_str();
-      auto end = (char*)(c_str + p_tok.raw_literal.size());
-      double ret = std::strtod(c_str, &end);
-      if(ret == 0 && end == c_str) // error
+      // the literal views the source so it isnt null terminated, strtod would read past it
+      const auto literal = p_tok.raw_literal;
+      double ret = 0;
+      const auto result = std::from_chars(literal.data(), literal.data() + literal.size(), ret);
+      if(result.ec == std::errc::result_out_of_range)
+      {
+        // too large or too small for a double, from_chars leaves ret alone where strtod gave inf or the underflowed
+        // value, so go through strtod on a terminated copy
+        ret = std::strtod(std::string{literal}.c_str(), nullptr);
+      }
+      else if(result.ec != std::errc{}) // error
       {
         p_parser.parse_error(parser::error::code::malformed_number,
                              p_tok.line,
                              p_tok.offset,
                              p_tok.raw_literal,
                              "error converting: '{}', to a number",
-                             c_str);
+                             literal);
       }
-      return std::make_unique<ast::number_expression>(p_tok, ret);
+      return ast::make<ast::number_expression>(p_parser.get_arena(), p_tok, ret);
     }
   };
 
   struct string_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      return std::make_unique<ast::string_expression>(p_tok, p_tok.raw_literal);
+      return ast::make<ast::string_expression>(p_parser.get_arena(), p_tok, p_tok.raw_literal);
     }
   };
 
   struct boolean_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      return std::make_unique<ast::boolean_expression>(p_tok, p_tok.raw_literal == "true" ? true : false);
+      return ast::make<ast::boolean_expression>(p_parser.get_arena(),
+                                                p_tok,
+                                                p_tok.raw_literal == "true" ? true : false);
     }
   };
 
   struct null_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      return std::make_unique<ast::null_expression>(p_tok);
+      return ast::make<ast::null_expression>(p_parser.get_arena(), p_tok);
     }
   };
 
   struct this_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      return std::make_unique<ast::this_expression>(p_tok);
+      return ast::make<ast::this_expression>(p_parser.get_arena(), p_tok);
     }
   };
 
   struct super_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
       if(p_parser.lookahead_token().type != token_type::tok_dot)
       {
@@ -145,16 +155,17 @@ namespace ok
       p_parser.advance();
       auto method_tok = p_parser.current_token();
       bool is_invoke = false;
-      std::list<std::unique_ptr<ast::expression>> args;
+      ast::list<ast::expression> args(p_parser.get_arena());
       if(p_parser.lookahead_token().type == token_type::tok_left_paren)
       {
         p_parser.advance(); // skip to the paren
         args = parse_expression_list(p_parser, {token_type::tok_right_paren, "("});
         is_invoke = true;
       }
-      return std::make_unique<ast::super_expression>(
+      return ast::make<ast::super_expression>(
+          p_parser.get_arena(),
           p_tok,
-          std::make_unique<ast::identifier_expression>(method_tok, method_tok.raw_literal),
+          ast::make<ast::identifier_expression>(p_parser.get_arena(), method_tok, method_tok.raw_literal),
           std::move(args),
           is_invoke);
     }
@@ -162,18 +173,18 @@ namespace ok
 
   struct array_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
       auto elements = parse_expression_list(p_parser, {token_type::tok_right_bracket, "["});
-      return std::make_unique<ast::array_expression>(p_tok, std::move(elements));
+      return ast::make<ast::array_expression>(p_parser.get_arena(), p_tok, std::move(elements));
     }
   };
 
   struct map_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
-      std::unordered_map<std::unique_ptr<ast::expression>, std::unique_ptr<ast::expression>> entries;
+      std::unordered_map<ast::ptr<ast::expression>, ast::ptr<ast::expression>> entries;
       while(p_parser.lookahead_token().type != token_type::tok_right_brace &&
             p_parser.lookahead_token().type != token_type::tok_eof)
       {
@@ -220,13 +231,13 @@ namespace ok
       {
         p_parser.advance();
       }
-      return std::make_unique<ast::map_expression>(p_tok, std::move(entries));
+      return ast::make<ast::map_expression>(p_parser.get_arena(), p_tok, std::move(entries));
     }
   };
 
   struct group_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
       p_parser.advance();
       auto expr = p_parser.parse_expression();
@@ -236,12 +247,14 @@ namespace ok
 
   struct prefix_unary_parser : public prefix_parser_base
   {
-    std::unique_ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok) const override
     {
       p_parser.advance();
       auto opperand = p_parser.parse_expression(precedence::prec_prefix);
-      return std::make_unique<ast::prefix_unary_expression>(
-          p_tok, operator_type_from_string(p_tok.raw_literal), std::move(opperand));
+      return ast::make<ast::prefix_unary_expression>(p_parser.get_arena(),
+                                                     p_tok,
+                                                     operator_type_from_string(p_tok.raw_literal),
+                                                     std::move(opperand));
     }
   };
 
@@ -249,8 +262,7 @@ namespace ok
   {
     postfix_parser_base() = default;
     virtual ~postfix_parser_base() = default;
-    virtual std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const = 0;
+    virtual ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const = 0;
     virtual int get_precedence() const = 0;
   };
 
@@ -260,11 +272,12 @@ namespace ok
     {
     }
 
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
-      return std::make_unique<ast::postfix_unary_expression>(
-          p_tok, operator_type_from_string(p_tok.raw_literal), std::move(p_left));
+      return ast::make<ast::postfix_unary_expression>(p_parser.get_arena(),
+                                                      p_tok,
+                                                      operator_type_from_string(p_tok.raw_literal),
+                                                      std::move(p_left));
     }
 
     int get_precedence() const override
@@ -282,13 +295,15 @@ namespace ok
     {
     }
 
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
       p_parser.advance();
       auto right = p_parser.parse_expression(m_precedence - (m_is_right ? 1 : 0));
-      return std::make_unique<ast::infix_binary_expression>(
-          p_tok, operator_type_from_string(p_tok.raw_literal), std::move(p_left), std::move(right));
+      return ast::make<ast::infix_binary_expression>(p_parser.get_arena(),
+                                                     p_tok,
+                                                     operator_type_from_string(p_tok.raw_literal),
+                                                     std::move(p_left),
+                                                     std::move(right));
     }
 
     int get_precedence() const override
@@ -307,8 +322,7 @@ namespace ok
     {
     }
 
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
       p_parser.advance();
       auto name_tok = p_parser.current_token();
@@ -322,9 +336,9 @@ namespace ok
         return nullptr;
       }
 
-      auto property_expr = std::make_unique<ast::identifier_expression>(name_tok, name_tok.raw_literal);
-      // std::unique_ptr<ast::expression> val_expr = nullptr;
-      std::list<std::unique_ptr<ast::expression>> args = {};
+      auto property_expr = ast::make<ast::identifier_expression>(p_parser.get_arena(), name_tok, name_tok.raw_literal);
+      // ast::ptr<ast::expression> val_expr = nullptr;
+      ast::list<ast::expression> args(p_parser.get_arena());
       bool is_invoke = false;
 
       // if(p_parser.lookahead_token().type == token_type::tok_assign)
@@ -339,8 +353,12 @@ namespace ok
         args = parse_expression_list(p_parser, {token_type::tok_right_paren, "("});
         is_invoke = true;
       }
-      return std::make_unique<ast::access_expression>(
-          name_tok, std::move(p_left), std::move(property_expr), std::move(args), is_invoke);
+      return ast::make<ast::access_expression>(p_parser.get_arena(),
+                                               name_tok,
+                                               std::move(p_left),
+                                               std::move(property_expr),
+                                               std::move(args),
+                                               is_invoke);
     }
 
     int get_precedence() const override
@@ -359,8 +377,7 @@ namespace ok
     {
     }
 
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
       p_parser.advance();
       auto right = p_parser.parse_expression();
@@ -374,7 +391,7 @@ namespace ok
                              "expected ']' after subscript operator expression");
       }
       p_parser.advance();
-      return std::make_unique<ast::subscript_expression>(p_tok, std::move(p_left), std::move(right));
+      return ast::make<ast::subscript_expression>(p_parser.get_arena(), p_tok, std::move(p_left), std::move(right));
     }
 
     int get_precedence() const override
@@ -389,8 +406,7 @@ namespace ok
 
   struct conditional_parser : public postfix_parser_base
   {
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
       p_parser.advance();
       auto left = p_parser.parse_expression();
@@ -400,7 +416,11 @@ namespace ok
       // TODO(Qais): check!
       // p_parser.advance_if_equals(token_type::tok_colon);
       auto right = p_parser.parse_expression(precedence::prec_conditional - 1);
-      return std::make_unique<ast::conditional_expression>(p_tok, std::move(p_left), std::move(left), std::move(right));
+      return ast::make<ast::conditional_expression>(p_parser.get_arena(),
+                                                    p_tok,
+                                                    std::move(p_left),
+                                                    std::move(left),
+                                                    std::move(right));
     }
 
     int get_precedence() const override
@@ -411,11 +431,10 @@ namespace ok
 
   struct call_parser : public postfix_parser_base
   {
-    std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const override
+    ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const override
     {
       auto args = parse_expression_list(p_parser, {token_type::tok_right_paren, "("});
-      return std::make_unique<ast::call_expression>(p_tok, std::move(p_left), std::move(args));
+      return ast::make<ast::call_expression>(p_parser.get_arena(), p_tok, std::move(p_left), std::move(args));
     }
 
     int get_precedence() const override
@@ -427,8 +446,7 @@ namespace ok
   template <typename AssignExpr = ast::assign_expression>
   struct assign_parser : public postfix_parser_base
   {
-    virtual std::unique_ptr<ast::expression>
-    parse(parser& p_parser, token p_tok, std::unique_ptr<ast::expression> p_left) const
+    virtual ast::ptr<ast::expression> parse(parser& p_parser, token p_tok, ast::ptr<ast::expression> p_left) const
     {
       p_parser.advance();
       // always right associative, to allow a=b=c
@@ -443,8 +461,11 @@ namespace ok
                              "expected lvalue as assignment target");
       }
 
-      return std::make_unique<AssignExpr>(
-          AssignExpr(p_tok, operator_type_from_string(p_tok.raw_literal), std::move(p_left), std::move(right)));
+      return ast::make<AssignExpr>(p_parser.get_arena(),
+                                   p_tok,
+                                   operator_type_from_string(p_tok.raw_literal),
+                                   std::move(p_left),
+                                   std::move(right));
     }
 
     virtual int get_precedence() const
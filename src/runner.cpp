@@ -1,56 +1,314 @@
 #include "runner.hpp"
+#include "c_emitter.hpp"
+#include "debug.hpp"
+#include "image.hpp"
 #include "vm.hpp"
 #include "vm_stack.hpp"
+#include <cstdlib>
 #include <expected>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <print>
+#include <random>
 #include <sstream>
+#include <string_view>
+#if __has_include("build_id.hpp")
+#include "build_id.hpp"
+#else
+#define OK_BUILD_ID __DATE__ " " __TIME__ // built without cmake, when runner.cpp compiled stands in for the sources
+#endif
 
 namespace ok
 {
-  auto runner::start(const std::filesystem::path& p_file) -> std::expected<vm::interpret_result, error>
+  static auto check_readable(const std::filesystem::path& p_file) -> std::expected<void, runner::error>
   {
-    ok::vm vm;
-    ok::vm_guard guard{&vm};
-    vm.init();
-
     if(!std::filesystem::exists(p_file))
     {
-      return std::unexpected{error::file_not_found};
+      return std::unexpected{runner::error::file_not_found};
     }
 
     const auto status = std::filesystem::status(p_file);
     if(!std::filesystem::is_regular_file(status))
     {
-      return std::unexpected{error::not_a_file};
+      return std::unexpected{runner::error::not_a_file};
     }
     const auto perms = status.permissions();
     const auto read = (perms & std::filesystem::perms::owner_read) != std::filesystem::perms::none;
     if(!read)
     {
-      return std::unexpected{error::no_permission};
+      return std::unexpected{runner::error::no_permission};
+    }
+    return {};
+  }
+
+  static auto read_source(const std::filesystem::path& p_file) -> std::expected<std::string, runner::error>
+  {
+    if(const auto readable = check_readable(p_file); !readable.has_value())
+    {
+      return std::unexpected{readable.error()};
     }
 
     const std::ifstream fstream(p_file);
-    auto file_str = p_file.string();
     std::stringstream ss;
     ss << fstream.rdbuf();
-    const auto& src_str = ss.str();
+    return ss.str();
+  }
 
-    const auto res = vm.interpret(file_str, src_str);
-    switch(res)
+  static void show_errors(vm& p_vm, vm::interpret_result p_res)
+  {
+    switch(p_res)
     {
     case ok::vm::interpret_result::parse_error:
-      vm.get_parse_errors().show();
+      p_vm.get_parse_errors().show();
       break;
     case ok::vm::interpret_result::compile_error:
-      vm.get_compile_errors().show();
+      p_vm.get_compile_errors().show();
       break;
     case ok::vm::interpret_result::runtime_error:
     case ok::vm::interpret_result::ok:
+    case ok::vm::interpret_result::count:
       break;
     }
-    return res;
   }
-} // namespace ok
\ No newline at end of file
+
+  // where the image of p_source goes in $OK_CACHE_DIR, nullopt when it is not set. the name hashes the source with the
+  // build, the image version and the options that change the code, so an edit, another okc or other flags all miss. the
+  // image records its source too, a name that collides is caught when it is loaded
+  static std::optional<std::filesystem::path> cache_path(std::string_view p_source, const compiler::options& p_options)
+  {
+    const char* dir = std::getenv("OK_CACHE_DIR");
+    if(dir == nullptr || *dir == '\0')
+      return std::nullopt;
+    const auto options = std::format("{} {} {} {} {} {} {} {} {} {} {} {}",
+                                     OK_BUILD_ID,
+                                     image::version,
+                                     to_utype(p_options.backend),
+                                     p_options.constant_folding,
+                                     p_options.constant_globals,
+                                     p_options.inlining,
+                                     p_options.loop_invariants,
+                                     p_options.superinstructions,
+                                     p_options.type_inference,
+                                     p_options.peephole,
+                                     p_options.stream_declarations,
+                                     p_source.size());
+    // two fnv1a hashes with different offsets, a collision runs the wrong script so 64 bits are not quite enough
+    auto low = static_cast<uint64_t>(14695981039346656037ULL);
+    auto high = static_cast<uint64_t>(0x6c62272e07bb0142ULL);
+    for(const auto str : {std::string_view{options}, p_source})
+    {
+      for(const auto c : str)
+      {
+        low = (low ^ static_cast<byte>(c)) * 1099511628211ULL;
+        high = (high ^ static_cast<byte>(c)) * 1099511628211ULL;
+      }
+    }
+    return std::filesystem::path{dir} / std::format("{:016x}{:016x}{}", high, low, runner::compiled_extension);
+  }
+
+  // writes to a file of its own first and renames it over p_path, so a concurrent run never maps half an image.
+  // failing to cache is not an error, the script just compiles again next time
+  static void write_cache(const std::filesystem::path& p_path, const std::vector<byte>& p_bytes)
+  {
+    std::error_code ec;
+    std::filesystem::create_directories(p_path.parent_path(), ec);
+    auto temporary = p_path;
+    temporary += std::format(".{}.tmp", std::random_device{}());
+    {
+      std::ofstream output(temporary, std::ios::binary);
+      if(!output.write(reinterpret_cast<const char*>(p_bytes.data()), static_cast<std::streamsize>(p_bytes.size())))
+      {
+        output.close();
+        std::filesystem::remove(temporary, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(temporary, p_path, ec);
+    if(ec)
+      std::filesystem::remove(temporary, ec);
+  }
+
+  auto runner::start(const std::filesystem::path& p_file, const compiler::options& p_options)
+      -> std::expected<vm::interpret_result, error>
+  {
+    ok::vm vm;
+    ok::vm_guard guard{&vm};
+    vm.init();
+    vm.set_compile_options(p_options);
+
+    if(p_file.extension() == compiled_extension)
+    {
+      if(const auto readable = check_readable(p_file); !readable.has_value())
+      {
+        return std::unexpected{readable.error()};
+      }
+      const auto mapped = mapped_image::map(p_file);
+      const auto functions = mapped != nullptr ? image::read(&vm, mapped) : std::vector<function_object*>{};
+      if(functions.empty())
+      {
+        std::println(stderr, "can't load: '{}', it is not a compiled script of this version", p_file.string());
+        return vm::interpret_result::runtime_error;
+      }
+      return vm.execute(functions.front());
+    }
+
+    const auto src = read_source(p_file);
+    if(!src.has_value())
+    {
+      return std::unexpected{src.error()};
+    }
+
+    const auto cache = cache_path(src.value(), p_options);
+    if(!cache.has_value())
+    {
+      const auto res = vm.interpret(p_file.string(), src.value());
+      show_errors(vm, res);
+      return res;
+    }
+    // a cached image that is gone, torn, of another version or of another source just misses and is written again
+    const auto source = image::source::of(src.value());
+    if(const auto mapped = mapped_image::map(cache.value());
+       mapped != nullptr && image::source_of(mapped->bytes()) == source)
+    {
+      const auto functions = image::read(&vm, mapped);
+      if(!functions.empty())
+        return vm.execute(functions.front());
+    }
+    auto function = vm.compile(p_file.string(), src.value());
+    if(function == nullptr)
+    {
+      const auto res = vm.get_parse_errors().errs.empty() ? vm::interpret_result::compile_error
+                                                          : vm::interpret_result::parse_error;
+      show_errors(vm, res);
+      return res;
+    }
+    if(const auto bytes = image::write(function, source); bytes.has_value())
+      write_cache(cache.value(), bytes.value());
+    return vm.execute(function);
+  }
+
+  auto runner::compile(const std::filesystem::path& p_file,
+                       const std::filesystem::path& p_output,
+                       const compiler::options& p_options) -> std::expected<vm::interpret_result, error>
+  {
+    ok::vm vm;
+    ok::vm_guard guard{&vm};
+    vm.init();
+    vm.set_compile_options(p_options);
+
+    const auto src = read_source(p_file);
+    if(!src.has_value())
+    {
+      return std::unexpected{src.error()};
+    }
+
+    auto function = vm.compile(p_file.string(), src.value());
+    if(function == nullptr)
+    {
+      const auto res = vm.get_parse_errors().errs.empty() ? vm::interpret_result::compile_error
+                                                          : vm::interpret_result::parse_error;
+      show_errors(vm, res);
+      return res;
+    }
+    const auto bytes = image::write(function, image::source::of(src.value()));
+    if(!bytes.has_value())
+    {
+      std::println(stderr, "can't compile: '{}', it has constants an image can't hold", p_file.string());
+      return vm::interpret_result::compile_error;
+    }
+    std::ofstream output(p_output, std::ios::binary);
+    if(!output.write(reinterpret_cast<const char*>(bytes->data()), static_cast<std::streamsize>(bytes->size())))
+    {
+      return std::unexpected{error::cant_write};
+    }
+    return vm::interpret_result::ok;
+  }
+
+  auto runner::emit_c(const std::filesystem::path& p_file,
+                      const std::filesystem::path& p_output,
+                      const compiler::options& p_options) -> std::expected<vm::interpret_result, error>
+  {
+    ok::vm vm;
+    ok::vm_guard guard{&vm};
+    vm.init();
+    vm.set_compile_options(p_options);
+
+    const auto src = read_source(p_file);
+    if(!src.has_value())
+    {
+      return std::unexpected{src.error()};
+    }
+
+    auto function = vm.compile(p_file.string(), src.value());
+    if(function == nullptr)
+    {
+      const auto res = vm.get_parse_errors().errs.empty() ? vm::interpret_result::compile_error
+                                                          : vm::interpret_result::parse_error;
+      show_errors(vm, res);
+      return res;
+    }
+    const auto source = c_emitter::emit(function, p_file.filename().string());
+    if(!source.has_value())
+    {
+      std::println(stderr, "can't emit c++ for: '{}', it has constants or jumps an image can't hold", p_file.string());
+      return vm::interpret_result::compile_error;
+    }
+    if(p_output.empty())
+    {
+      std::print("{}", source.value());
+      return vm::interpret_result::ok;
+    }
+    std::ofstream output(p_output);
+    if(!(output << source.value()))
+    {
+      return std::unexpected{error::cant_write};
+    }
+    return vm::interpret_result::ok;
+  }
+
+  auto runner::mine_ngrams(const std::vector<std::filesystem::path>& p_paths, size_t p_n, size_t p_top)
+      -> std::expected<vm::interpret_result, error>
+  {
+    std::vector<std::filesystem::path> files;
+    for(const auto& path : p_paths)
+    {
+      if(!std::filesystem::is_directory(path))
+      {
+        files.push_back(path);
+        continue;
+      }
+      for(const auto& entry : std::filesystem::recursive_directory_iterator(path))
+      {
+        if(entry.is_regular_file() && entry.path().extension() == ".ok")
+          files.push_back(entry.path());
+      }
+    }
+
+    debug::ngram_miner miner{p_n};
+    for(const auto& file : files)
+    {
+      const auto src = read_source(file);
+      if(!src.has_value())
+      {
+        return std::unexpected{src.error()};
+      }
+
+      // fresh vm per script so globals dont leak between them, and the sequences are mined as the compiler emits them
+      ok::vm vm;
+      ok::vm_guard guard{&vm};
+      vm.init();
+      vm.set_compile_options({.superinstructions = false, .peephole = false});
+      auto function = vm.compile(file.string(), src.value());
+      if(function == nullptr)
+      {
+        std::println(stderr, "skipping: '{}', it doesnt compile", file.string());
+        continue;
+      }
+      miner.mine(function->associated_chunk);
+    }
+    miner.report(p_top);
+    return vm::interpret_result::ok;
+  }
+} // namespace ok
@@ -4,6 +4,8 @@
 #include "vm.hpp"
 #include <expected>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 namespace ok
 {
@@ -14,9 +16,27 @@ namespace ok
       file_not_found,
       no_permission,
       not_a_file,
+      cant_write,
     };
 
-    static std::expected<vm::interpret_result, error> start(const std::filesystem::path& file);
+    // the extension of the compiled scripts okc -c writes
+    static constexpr std::string_view compiled_extension = ".okb";
+
+    // runs a script, or a compiled one written by compile when the file ends with .okb
+    static std::expected<vm::interpret_result, error> start(const std::filesystem::path& file,
+                                                            const compiler::options& p_options = {});
+    // compiles p_file and writes it as an image to p_output, see image::write
+    static std::expected<vm::interpret_result, error> compile(const std::filesystem::path& p_file,
+                                                              const std::filesystem::path& p_output,
+                                                              const compiler::options& p_options = {});
+    // compiles p_file and writes it as c++ to p_output, or to stdout when it is empty. see c_emitter::emit
+    static std::expected<vm::interpret_result, error> emit_c(const std::filesystem::path& p_file,
+                                                             const std::filesystem::path& p_output,
+                                                             const compiler::options& p_options = {});
+    // compiles every script in p_paths (directories are searched for .ok files) without running them, and prints the
+    // p_top most frequent p_n instructions long sequences. scripts that dont compile are skipped
+    static std::expected<vm::interpret_result, error>
+    mine_ngrams(const std::vector<std::filesystem::path>& p_paths, size_t p_n, size_t p_top);
   };
 } // namespace ok
 
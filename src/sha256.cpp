@@ -0,0 +1,89 @@
+#include "sha256.hpp"
+#include <bit>
+#include <cstring>
+
+namespace ok
+{
+  namespace
+  {
+    constexpr std::array<uint32_t, 64> round_constants = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    void compress(std::array<uint32_t, 8>& p_state, const uint8_t* p_block)
+    {
+      std::array<uint32_t, 64> w;
+      for(size_t i = 0; i < 16; ++i)
+      {
+        w[i] = uint32_t{p_block[i * 4]} << 24 | uint32_t{p_block[i * 4 + 1]} << 16 | uint32_t{p_block[i * 4 + 2]} << 8 |
+               uint32_t{p_block[i * 4 + 3]};
+      }
+      for(size_t i = 16; i < 64; ++i)
+      {
+        const auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      auto [a, b, c, d, e, f, g, h] = p_state;
+      for(size_t i = 0; i < 64; ++i)
+      {
+        const auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        const auto choice = (e & f) ^ (~e & g);
+        const auto t1 = h + s1 + choice + round_constants[i] + w[i];
+        const auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        const auto majority = (a & b) ^ (a & c) ^ (b & c);
+        const auto t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+      }
+      const std::array<uint32_t, 8> working = {a, b, c, d, e, f, g, h};
+      for(size_t i = 0; i < 8; ++i)
+        p_state[i] += working[i];
+    }
+  } // namespace
+
+  std::array<uint8_t, 32> sha256(std::string_view p_data)
+  {
+    std::array<uint32_t, 8> state = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    const auto* data = reinterpret_cast<const uint8_t*>(p_data.data());
+    size_t offset = 0;
+    for(; p_data.size() - offset >= 64; offset += 64)
+      compress(state, data + offset);
+
+    // the rest, a one bit, zeros up to 8 bytes short of a block and the length in bits, big endian
+    std::array<uint8_t, 128> tail{};
+    const auto rest = p_data.size() - offset;
+    if(rest != 0)
+      std::memcpy(tail.data(), data + offset, rest);
+    tail[rest] = 0x80;
+    const size_t blocks = rest < 56 ? 1 : 2;
+    const uint64_t bits = static_cast<uint64_t>(p_data.size()) * 8;
+    for(size_t i = 0; i < 8; ++i)
+      tail[blocks * 64 - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    for(size_t i = 0; i < blocks; ++i)
+      compress(state, tail.data() + i * 64);
+
+    std::array<uint8_t, 32> digest;
+    for(size_t i = 0; i < 8; ++i)
+    {
+      for(size_t j = 0; j < 4; ++j)
+        digest[i * 4 + j] = static_cast<uint8_t>(state[i] >> (24 - 8 * j));
+    }
+    return digest;
+  }
+} // namespace ok
@@ -0,0 +1,14 @@
+#ifndef OK_SHA256_HPP
+#define OK_SHA256_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace ok
+{
+  // the sha-256 digest of p_data, for telling apart sources where a collision would run the wrong script
+  std::array<uint8_t, 32> sha256(std::string_view p_data);
+} // namespace ok
+
+#endif // OK_SHA256_HPP
@@ -1,7 +1,9 @@
 #ifndef OK_TOKEN_HPP
 #define OK_TOKEN_HPP
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ok
@@ -98,12 +100,11 @@ namespace ok
   struct token
   {
     token_type type;
-    std::string raw_literal; // copy and own = no headache, slight overhead on compile time nothing to worry about!
-    // Question(Qais): stupid if you have offset and line, then you must keep the original string for errors,
-    // thus copy above is redundant! unless you went with the not showing source route then you
-    // are annoying!
-    size_t line;
-    size_t offset;
+    // views the source (or a static string for errors and synthesized tokens), whoever lexes keeps the source alive
+    // for as long as the tokens and the ast built from them
+    std::string_view raw_literal;
+    uint32_t line;
+    uint32_t offset;
   };
 
   token_type lookup_identifier(const std::string_view p_raw);
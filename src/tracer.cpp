@@ -0,0 +1,561 @@
+#include "tracer.hpp"
+#include "utility.hpp"
+#include <functional>
+#include <type_traits>
+
+namespace ok
+{
+  namespace
+  {
+    constexpr size_t max_trace_length = 256; // recorded instructions, longer iterations are not worth a trace
+    constexpr uint32_t no_exit = trace_op::no_exit;
+
+    const value_t null_value{};
+    const value_t true_value{true};
+    const value_t false_value{false};
+
+    uint32_t push_slot(trace_context& p_context, const trace_op& p_op)
+    {
+      if(p_context.top >= p_context.limit)
+        return p_op.exit;
+      *p_context.top++ = p_context.slots[p_op.operands[0]];
+      return no_exit;
+    }
+
+    uint32_t store_slot(trace_context& p_context, const trace_op& p_op)
+    {
+      p_context.slots[p_op.operands[0]] = p_context.top[-1];
+      return no_exit;
+    }
+
+    uint32_t push_constant(trace_context& p_context, const trace_op& p_op)
+    {
+      if(p_context.top >= p_context.limit)
+        return p_op.exit;
+      *p_context.top++ = *p_op.constant;
+      return no_exit;
+    }
+
+    uint32_t pop(trace_context& p_context, const trace_op& p_op)
+    {
+      p_context.top -= p_op.operands[0];
+      return no_exit;
+    }
+
+    template <typename Operation>
+    constexpr bool is_division = std::is_same_v<Operation, std::divides<double>>;
+
+    // the unchecked forms were proven by the verifier, dividing by zero is left to the interpreter to report
+    template <typename Operation, bool Checked>
+    uint32_t arithmetic(trace_context& p_context, const trace_op& p_op)
+    {
+      auto& lhs = p_context.top[-2];
+      const auto& rhs = p_context.top[-1];
+      if constexpr(Checked)
+      {
+        if(!OK_IS_VALUE_NUMBER(lhs) || !OK_IS_VALUE_NUMBER(rhs))
+          return p_op.exit;
+      }
+      if constexpr(is_division<Operation>)
+      {
+        if(OK_VALUE_AS_NUMBER(rhs) == 0)
+          return p_op.exit;
+      }
+      OK_VALUE_AS_NUMBER(lhs) = Operation{}(OK_VALUE_AS_NUMBER(lhs), OK_VALUE_AS_NUMBER(rhs));
+      --p_context.top;
+      return no_exit;
+    }
+
+    template <typename Compare>
+    uint32_t compare(trace_context& p_context, const trace_op& p_op)
+    {
+      auto& lhs = p_context.top[-2];
+      const auto& rhs = p_context.top[-1];
+      if(!OK_IS_VALUE_NUMBER(lhs) || !OK_IS_VALUE_NUMBER(rhs))
+        return p_op.exit;
+      lhs = value_t{Compare{}(OK_VALUE_AS_NUMBER(lhs), OK_VALUE_AS_NUMBER(rhs))};
+      --p_context.top;
+      return no_exit;
+    }
+
+    uint32_t negate(trace_context& p_context, const trace_op& p_op)
+    {
+      auto& value = p_context.top[-1];
+      if(!OK_IS_VALUE_NUMBER(value))
+        return p_op.exit;
+      OK_VALUE_AS_NUMBER(value) = -OK_VALUE_AS_NUMBER(value);
+      return no_exit;
+    }
+
+    uint32_t logical_not(trace_context& p_context, const trace_op& p_op)
+    {
+      auto& value = p_context.top[-1];
+      if(!OK_IS_VALUE_BOOL(value))
+        return p_op.exit;
+      value = value_t{!OK_VALUE_AS_BOOL(value)};
+      return no_exit;
+    }
+
+    // operands[0] is the condition that keeps the trace going, the other way leaves with the condition popped
+    uint32_t branch(trace_context& p_context, const trace_op& p_op)
+    {
+      const auto& condition = p_context.top[-1];
+      if(!OK_IS_VALUE_BOOL(condition))
+        return p_op.exit;
+      --p_context.top;
+      return OK_VALUE_AS_BOOL(condition) == static_cast<bool>(p_op.operands[0]) ? no_exit : p_op.side_exit;
+    }
+
+    // a compare and the conditional jump on it
+    template <typename Compare>
+    uint32_t compare_branch(trace_context& p_context, const trace_op& p_op)
+    {
+      const auto& lhs = p_context.top[-2];
+      const auto& rhs = p_context.top[-1];
+      if(!OK_IS_VALUE_NUMBER(lhs) || !OK_IS_VALUE_NUMBER(rhs))
+        return p_op.exit;
+      const auto result = Compare{}(OK_VALUE_AS_NUMBER(lhs), OK_VALUE_AS_NUMBER(rhs));
+      p_context.top -= 2;
+      return result == static_cast<bool>(p_op.operands[0]) ? no_exit : p_op.side_exit;
+    }
+
+    // the register instructions, operands are the slots and p_op.constant the rhs of the _rk forms
+    template <typename Operation, bool ConstantRhs>
+    uint32_t register_arithmetic(trace_context& p_context, const trace_op& p_op)
+    {
+      const auto& lhs = p_context.slots[p_op.operands[1]];
+      const auto& rhs = ConstantRhs ? *p_op.constant : p_context.slots[p_op.operands[2]];
+      if(!OK_IS_VALUE_NUMBER(lhs) || !OK_IS_VALUE_NUMBER(rhs))
+        return p_op.exit;
+      if constexpr(is_division<Operation>)
+      {
+        if(OK_VALUE_AS_NUMBER(rhs) == 0)
+          return p_op.exit;
+      }
+      p_context.slots[p_op.operands[0]] = value_t{Operation{}(OK_VALUE_AS_NUMBER(lhs), OK_VALUE_AS_NUMBER(rhs))};
+      return no_exit;
+    }
+
+    // operands[0] is the compare result that keeps the trace going
+    template <typename Compare, bool ConstantRhs>
+    uint32_t register_branch(trace_context& p_context, const trace_op& p_op)
+    {
+      const auto& lhs = p_context.slots[p_op.operands[1]];
+      const auto& rhs = ConstantRhs ? *p_op.constant : p_context.slots[p_op.operands[2]];
+      if(!OK_IS_VALUE_NUMBER(lhs) || !OK_IS_VALUE_NUMBER(rhs))
+        return p_op.exit;
+      const auto result = Compare{}(OK_VALUE_AS_NUMBER(lhs), OK_VALUE_AS_NUMBER(rhs));
+      return result == static_cast<bool>(p_op.operands[0]) ? no_exit : p_op.side_exit;
+    }
+
+    // instructions a superinstruction stands for, the vm runs them all in one dispatch on its fast path
+    size_t sequence_length(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_get_local_get_local_add:
+        return 3;
+      case opcode::op_get_local_constant_less_jump:
+        return 4;
+      case opcode::op_get_local_constant_add_set_local_pop:
+        return 5;
+      default:
+        return 1;
+      }
+    }
+
+    bool is_conditional_jump(opcode p_op)
+    {
+      return p_op == opcode::op_conditional_jump || p_op == opcode::op_conditional_truthy_jump;
+    }
+
+    template <template <typename> typename Handler>
+    trace_op::handler_type compare_handler(opcode p_op)
+    {
+      switch(p_op)
+      {
+      case opcode::op_greater:
+      case opcode::op_greater_nn:
+      case opcode::op_greater_unchecked:
+        return Handler<std::greater<double>>::value;
+      case opcode::op_greater_equal:
+      case opcode::op_greater_equal_nn:
+      case opcode::op_greater_equal_unchecked:
+        return Handler<std::greater_equal<double>>::value;
+      case opcode::op_less:
+      case opcode::op_less_nn:
+      case opcode::op_less_unchecked:
+        return Handler<std::less<double>>::value;
+      case opcode::op_less_equal:
+      case opcode::op_less_equal_nn:
+      case opcode::op_less_equal_unchecked:
+        return Handler<std::less_equal<double>>::value;
+      case opcode::op_equal:
+        return Handler<std::equal_to<double>>::value;
+      default:
+        return nullptr;
+      }
+    }
+
+    template <typename Compare>
+    struct compare_value
+    {
+      static constexpr trace_op::handler_type value = compare<Compare>;
+    };
+
+    template <typename Compare>
+    struct compare_branch_value
+    {
+      static constexpr trace_op::handler_type value = compare_branch<Compare>;
+    };
+  } // namespace
+
+  uint32_t trace::run(trace_context& p_context) const
+  {
+    while(true)
+    {
+      for(const auto& op : ops)
+      {
+        if(const auto exit = op.handler(p_context, op); exit != no_exit)
+          return exit;
+      }
+    }
+  }
+
+  void trace_recorder::abort()
+  {
+    m_cache->counters[m_header] = trace_cache::blacklisted;
+    m_cache = nullptr;
+  }
+
+  void trace_recorder::record(
+      const chunk& p_chunk, size_t p_depth, size_t p_offset, const value_t* p_slots, const value_t* p_top)
+  {
+    // the iteration called or returned, traces stay within one frame
+    if(p_depth != m_depth)
+    {
+      abort();
+      return;
+    }
+    if(!m_recorded.empty())
+      m_recorded.back().next = p_offset;
+    if(p_offset == m_header && !m_recorded.empty())
+    {
+      auto compiled = compile(p_chunk);
+      if(!compiled)
+      {
+        abort();
+        return;
+      }
+      m_cache->traces.emplace(m_header, std::move(*compiled));
+      m_cache = nullptr;
+      return;
+    }
+    if(m_recorded.size() == max_trace_length)
+    {
+      abort();
+      return;
+    }
+
+    // a loop whose operands are not what the trace specializes on would only ever leave it right away
+    const auto numbers = [&](const value_t& p_lhs, const value_t& p_rhs)
+    { return OK_IS_VALUE_NUMBER(p_lhs) && OK_IS_VALUE_NUMBER(p_rhs); };
+    bool expected = true;
+    switch(static_cast<opcode>(p_chunk.code[p_offset]))
+    {
+    case opcode::op_add:
+    case opcode::op_subtract:
+    case opcode::op_multiply:
+    case opcode::op_divide:
+    case opcode::op_add_nn:
+    case opcode::op_subtract_nn:
+    case opcode::op_multiply_nn:
+    case opcode::op_divide_nn:
+    case opcode::op_greater:
+    case opcode::op_greater_equal:
+    case opcode::op_less:
+    case opcode::op_less_equal:
+    case opcode::op_greater_nn:
+    case opcode::op_greater_equal_nn:
+    case opcode::op_less_nn:
+    case opcode::op_less_equal_nn:
+    case opcode::op_equal:
+      expected = numbers(p_top[-2], p_top[-1]);
+      break;
+    case opcode::op_negate:
+      expected = OK_IS_VALUE_NUMBER(p_top[-1]);
+      break;
+    case opcode::op_not:
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+      expected = OK_IS_VALUE_BOOL(p_top[-1]);
+      break;
+    case opcode::op_add_rr:
+    case opcode::op_subtract_rr:
+    case opcode::op_multiply_rr:
+    case opcode::op_divide_rr:
+      expected = numbers(p_slots[p_chunk.code[p_offset + 2]], p_slots[p_chunk.code[p_offset + 3]]);
+      break;
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_equal_rr_jump:
+      expected = numbers(p_slots[p_chunk.code[p_offset + 1]], p_slots[p_chunk.code[p_offset + 2]]);
+      break;
+    default:
+      break;
+    }
+    if(!expected)
+    {
+      abort();
+      return;
+    }
+    m_recorded.push_back({.offset = static_cast<uint32_t>(p_offset)});
+  }
+
+  std::optional<trace> trace_recorder::compile(const chunk& p_chunk) const
+  {
+    const auto& code = p_chunk.code;
+
+    // a superinstruction that took its fast path ran its whole sequence, it is traced instruction by instruction
+    std::vector<recorded_instruction> flat;
+    for(const auto& recorded : m_recorded)
+    {
+      const auto count = sequence_length(static_cast<opcode>(code[recorded.offset]));
+      if(count == 1 || recorded.next == recorded.offset + 2)
+      {
+        flat.push_back(recorded);
+        continue;
+      }
+      auto offset = recorded.offset;
+      for(size_t i = 0; i < count; ++i)
+      {
+        const auto next = static_cast<uint32_t>(offset + instruction_length(p_chunk, offset));
+        flat.push_back({.offset = offset, .next = i + 1 == count ? recorded.next : next});
+        offset = next;
+      }
+    }
+
+    trace result;
+    for(size_t i = 0; i < flat.size(); ++i)
+    {
+      const auto offset = flat[i].offset;
+      const auto op = static_cast<opcode>(code[offset]);
+      const auto length = instruction_length(p_chunk, offset);
+      const auto short_operand = [&](size_t p_at = 1) -> uint32_t { return code[offset + p_at]; };
+      const auto long_operand = [&](size_t p_at = 1) { return decode_int<uint32_t, 3>(code, offset + p_at); };
+      trace_op step{.handler = nullptr, .exit = offset};
+      // where a branch went while recording decides what keeps the trace going, the other way is the side exit
+      const auto follow = [&](const recorded_instruction& p_branch, uint32_t p_fallthrough, uint32_t p_target)
+      {
+        const auto taken = p_branch.next != p_fallthrough;
+        step.side_exit = taken ? p_fallthrough : p_target;
+        return taken;
+      };
+
+      switch(op)
+      {
+      case opcode::op_get_local:
+      case opcode::op_get_local_long:
+      case opcode::op_get_local_get_local_add:
+      case opcode::op_get_local_constant_less_jump:
+      case opcode::op_get_local_constant_add_set_local_pop:
+        step.handler = push_slot;
+        step.operands[0] = op == opcode::op_get_local_long ? long_operand() : short_operand();
+        break;
+      case opcode::op_set_local:
+      case opcode::op_set_local_long:
+        step.handler = store_slot;
+        step.operands[0] = op == opcode::op_set_local ? short_operand() : long_operand();
+        break;
+      case opcode::op_constant:
+      case opcode::op_constant_long:
+        step.handler = push_constant;
+        step.constant = &p_chunk.constants[op == opcode::op_constant ? short_operand() : long_operand()];
+        break;
+      case opcode::op_null:
+      case opcode::op_true:
+      case opcode::op_false:
+        step.handler = push_constant;
+        step.constant = op == opcode::op_null ? &null_value : op == opcode::op_true ? &true_value : &false_value;
+        break;
+      case opcode::op_pop:
+      case opcode::op_pop_n:
+        step.handler = pop;
+        step.operands[0] = op == opcode::op_pop ? 1 : short_operand();
+        break;
+      case opcode::op_add:
+      case opcode::op_add_nn:
+        step.handler = arithmetic<std::plus<double>, true>;
+        break;
+      case opcode::op_subtract:
+      case opcode::op_subtract_nn:
+        step.handler = arithmetic<std::minus<double>, true>;
+        break;
+      case opcode::op_multiply:
+      case opcode::op_multiply_nn:
+        step.handler = arithmetic<std::multiplies<double>, true>;
+        break;
+      case opcode::op_divide:
+      case opcode::op_divide_nn:
+        step.handler = arithmetic<std::divides<double>, true>;
+        break;
+      case opcode::op_add_unchecked:
+        step.handler = arithmetic<std::plus<double>, false>;
+        break;
+      case opcode::op_subtract_unchecked:
+        step.handler = arithmetic<std::minus<double>, false>;
+        break;
+      case opcode::op_multiply_unchecked:
+        step.handler = arithmetic<std::multiplies<double>, false>;
+        break;
+      case opcode::op_divide_unchecked:
+        step.handler = arithmetic<std::divides<double>, false>;
+        break;
+      case opcode::op_greater:
+      case opcode::op_greater_equal:
+      case opcode::op_less:
+      case opcode::op_less_equal:
+      case opcode::op_greater_nn:
+      case opcode::op_greater_equal_nn:
+      case opcode::op_less_nn:
+      case opcode::op_less_equal_nn:
+      case opcode::op_greater_unchecked:
+      case opcode::op_greater_equal_unchecked:
+      case opcode::op_less_unchecked:
+      case opcode::op_less_equal_unchecked:
+      case opcode::op_equal:
+      {
+        // fused with the conditional jump on it so the bool never hits the stack
+        if(i + 1 < flat.size() && is_conditional_jump(static_cast<opcode>(code[flat[i + 1].offset])))
+        {
+          const auto& jump = flat[i + 1];
+          const auto jump_op = static_cast<opcode>(code[jump.offset]);
+          const auto fallthrough = jump.offset + static_cast<uint32_t>(instruction_length(p_chunk, jump.offset));
+          const auto taken = follow(jump, fallthrough, fallthrough + decode_int<uint32_t, 3>(code, jump.offset + 1));
+          step.handler = compare_handler<compare_branch_value>(op);
+          step.operands[0] = jump_op == opcode::op_conditional_jump ? !taken : taken;
+          ++i;
+          break;
+        }
+        step.handler = compare_handler<compare_value>(op);
+        break;
+      }
+      case opcode::op_negate:
+        step.handler = negate;
+        break;
+      case opcode::op_not:
+        step.handler = logical_not;
+        break;
+      case opcode::op_conditional_jump:
+      case opcode::op_conditional_truthy_jump:
+      {
+        const auto fallthrough = offset + static_cast<uint32_t>(length);
+        const auto taken = follow(flat[i], fallthrough, fallthrough + long_operand());
+        step.handler = branch;
+        step.operands[0] = op == opcode::op_conditional_jump ? !taken : taken;
+        break;
+      }
+      case opcode::op_jump:
+      case opcode::op_loop:
+        // the trace is straight line code that starts over at its end
+        continue;
+      case opcode::op_add_rr:
+        step.handler = register_arithmetic<std::plus<double>, false>;
+        break;
+      case opcode::op_add_rk:
+        step.handler = register_arithmetic<std::plus<double>, true>;
+        break;
+      case opcode::op_subtract_rr:
+        step.handler = register_arithmetic<std::minus<double>, false>;
+        break;
+      case opcode::op_subtract_rk:
+        step.handler = register_arithmetic<std::minus<double>, true>;
+        break;
+      case opcode::op_multiply_rr:
+        step.handler = register_arithmetic<std::multiplies<double>, false>;
+        break;
+      case opcode::op_multiply_rk:
+        step.handler = register_arithmetic<std::multiplies<double>, true>;
+        break;
+      case opcode::op_divide_rr:
+        step.handler = register_arithmetic<std::divides<double>, false>;
+        break;
+      case opcode::op_divide_rk:
+        step.handler = register_arithmetic<std::divides<double>, true>;
+        break;
+      case opcode::op_greater_rr_jump:
+        step.handler = register_branch<std::greater<double>, false>;
+        break;
+      case opcode::op_greater_rk_jump:
+        step.handler = register_branch<std::greater<double>, true>;
+        break;
+      case opcode::op_greater_equal_rr_jump:
+        step.handler = register_branch<std::greater_equal<double>, false>;
+        break;
+      case opcode::op_greater_equal_rk_jump:
+        step.handler = register_branch<std::greater_equal<double>, true>;
+        break;
+      case opcode::op_less_rr_jump:
+        step.handler = register_branch<std::less<double>, false>;
+        break;
+      case opcode::op_less_rk_jump:
+        step.handler = register_branch<std::less<double>, true>;
+        break;
+      case opcode::op_less_equal_rr_jump:
+        step.handler = register_branch<std::less_equal<double>, false>;
+        break;
+      case opcode::op_less_equal_rk_jump:
+        step.handler = register_branch<std::less_equal<double>, true>;
+        break;
+      default:
+        // calls, globals, properties and everything else stay in the interpreter
+        return std::nullopt;
+      }
+
+      switch(op)
+      {
+      case opcode::op_add_rk:
+      case opcode::op_subtract_rk:
+      case opcode::op_multiply_rk:
+      case opcode::op_divide_rk:
+        // the rhs of the _rk forms is a constant, of the _rr forms a slot
+        step.constant = &p_chunk.constants[short_operand(3)];
+        [[fallthrough]];
+      case opcode::op_add_rr:
+      case opcode::op_subtract_rr:
+      case opcode::op_multiply_rr:
+      case opcode::op_divide_rr:
+        // [op][dst][lhs][rhs][stub x3]
+        step.operands[0] = short_operand(1);
+        step.operands[1] = short_operand(2);
+        step.operands[2] = short_operand(3);
+        break;
+      case opcode::op_greater_rk_jump:
+      case opcode::op_greater_equal_rk_jump:
+      case opcode::op_less_rk_jump:
+      case opcode::op_less_equal_rk_jump:
+        step.constant = &p_chunk.constants[short_operand(2)];
+        [[fallthrough]];
+      case opcode::op_greater_rr_jump:
+      case opcode::op_greater_equal_rr_jump:
+      case opcode::op_less_rr_jump:
+      case opcode::op_less_equal_rr_jump:
+      {
+        // [op][lhs][rhs][exit x3][stub x3], falling through keeps going
+        const auto fallthrough = offset + static_cast<uint32_t>(length);
+        step.operands[0] = !follow(flat[i], fallthrough, fallthrough + long_operand(3));
+        step.operands[1] = short_operand(1);
+        step.operands[2] = short_operand(2);
+        break;
+      }
+      default:
+        break;
+      }
+      result.ops.push_back(step);
+    }
+    if(result.ops.empty())
+      return std::nullopt;
+    return result;
+  }
+} // namespace ok
@@ -0,0 +1,97 @@
+#ifndef OK_TRACER_HPP
+#define OK_TRACER_HPP
+
+#include "chunk.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace ok
+{
+  struct trace_context
+  {
+    value_t* slots;
+    value_t* top; // one past the top of the vm stack
+    const value_t* limit;
+  };
+
+  // one step of a compiled trace, handlers return no_exit to carry on or the offset the interpreter resumes at
+  struct trace_op
+  {
+    static constexpr uint32_t no_exit = std::numeric_limits<uint32_t>::max();
+    using handler_type = uint32_t (*)(trace_context& p_context, const trace_op& p_op);
+
+    handler_type handler;
+    uint32_t exit = 0;      // the instruction itself, taken on a type miss before anything changed
+    uint32_t side_exit = 0; // the other way of a branch that went this way while recording
+    uint32_t operands[3]{};
+    const value_t* constant = nullptr;
+  };
+
+  // the instructions of one loop iteration as they ran while recording, specialized to the types seen then. it runs in
+  // place on the vm stack and loops until a guard fails
+  struct trace
+  {
+    std::vector<trace_op> ops;
+
+    // returns the offset the interpreter resumes at, p_context.top is left at the stack top for it
+    uint32_t run(trace_context& p_context) const;
+  };
+
+  // the back edge counters and traces of one function, keyed by the offset of the loop header
+  struct trace_cache
+  {
+    static constexpr uint32_t blacklisted = std::numeric_limits<uint32_t>::max();
+
+    std::unordered_map<uint32_t, uint32_t> counters;
+    std::unordered_map<uint32_t, trace> traces;
+  };
+
+  // records the instructions a frame runs from a hot loop header until it gets back to it
+  class trace_recorder
+  {
+  public:
+    void start(trace_cache* p_cache, size_t p_depth, uint32_t p_header)
+    {
+      m_cache = p_cache;
+      m_depth = p_depth;
+      m_header = p_header;
+      m_recorded.clear();
+    }
+
+    // gives up on the recording without blacklisting the loop
+    void stop()
+    {
+      m_cache = nullptr;
+    }
+
+    bool recording() const
+    {
+      return m_cache != nullptr;
+    }
+
+    // called before every instruction while recording, p_top is one past the top of the vm stack. the trace is
+    // compiled once the frame is back at the header, anything it can not follow blacklists the loop
+    void record(const chunk& p_chunk, size_t p_depth, size_t p_offset, const value_t* p_slots, const value_t* p_top);
+
+  private:
+    struct recorded_instruction
+    {
+      uint32_t offset;
+      uint32_t next = 0; // the offset that ran after it
+    };
+
+    void abort();
+    std::optional<trace> compile(const chunk& p_chunk) const;
+
+    trace_cache* m_cache = nullptr;
+    size_t m_depth = 0;
+    uint32_t m_header = 0;
+    std::vector<recorded_instruction> m_recorded;
+  };
+} // namespace ok
+
+#endif // OK_TRACER_HPP
@@ -1,10 +1,15 @@
 #ifndef OK_UTF8_HPP
 #define OK_UTF8_HPP
 
+#include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <expected>
 #include <string_view>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 // FIXME(Qais): all calls here are nt safe fix this and define failure behavior!
 namespace ok::utf8
@@ -37,6 +42,39 @@ namespace ok::utf8
     return temp;
   }
 
+  // length of the ascii run at the start of str, source code is mostly ascii so this skips the bulk of it
+  inline size_t ascii_length(const std::string_view str)
+  {
+    const char* p = str.data();
+    const char* end = p + str.size();
+#if defined(__AVX2__)
+    for(; end - p >= 32; p += 32)
+    {
+      const auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)p));
+      if(mask != 0)
+        return p - str.data() + std::countr_zero(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    for(; end - p >= 16; p += 16)
+    {
+      const auto mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+      if(mask != 0)
+        return p - str.data() + std::countr_zero(mask);
+    }
+#endif
+    for(; end - p >= 8; p += 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, p, sizeof(word));
+      if((word & 0x8080808080808080ull) != 0)
+        break; // let the byte loop find it, endianness doesnt matter then
+    }
+    while(p < end && static_cast<uint8_t>(*p) < 0x80)
+      p++;
+    return p - str.data();
+  }
+
   struct validation_error
   {
     enum class leading
@@ -97,6 +135,17 @@ namespace ok::utf8
 
     while(p < end)
     {
+      // only long ascii runs go to the vector scan, the short ones between multibyte codepoints arent worth the call
+      if(end - p >= 8)
+      {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        if((word & 0x8080808080808080ull) == 0)
+        {
+          p += ascii_length({reinterpret_cast<const char*>(p), static_cast<size_t>(end - p)});
+          continue;
+        }
+      }
       auto len = validate_codepoint(p, end);
       if(!len)
         return std::unexpected(len.error());
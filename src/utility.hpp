@@ -1,6 +1,7 @@
 #ifndef OK_UTILITY_HPP
 #define OK_UTILITY_HPP
 
+#include <array>
 #include <cstdint>
 #include <span>
 #include <type_traits>
@@ -62,7 +63,7 @@ namespace ok
     requires std::is_integral_v<T> && (N <= sizeof(T))
   constexpr auto encode_int(T value)
   {
-    std::vector<uint8_t> bytes(N);
+    std::array<uint8_t, N> bytes{};
     for(auto i = 0; i < N; ++i)
     {
       bytes[i] = ((value >> (8 * i)) & 0xff);
@@ -79,10 +79,18 @@ namespace ok
       void* pointer;
     } as;
 
-    explicit value_t(bool p_bool);
+    // inline so filling the vm stack with nulls at startup, and every number pushed, is a couple of stores
+    explicit value_t(bool p_bool) : type(value_type::bool_val), as({.boolean = p_bool})
+    {
+    }
 
-    explicit value_t(double p_number);
-    explicit value_t();
+    explicit value_t(double p_number) : type(value_type::number_val), as({.number = p_number})
+    {
+    }
+
+    explicit value_t() : type(value_type::null_val), as({.number = 0})
+    {
+    }
 
     // explicit value_t(object* p_object);
     explicit value_t(const char* p_str, size_t p_length);
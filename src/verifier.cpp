@@ -0,0 +1,967 @@
+#include "verifier.hpp"
+#include "object.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+
+namespace ok
+{
+  namespace
+  {
+    enum class static_type : uint8_t
+    {
+      number,
+      unknown,
+    };
+
+    struct type_state
+    {
+      std::vector<static_type> stack; // the frame's slots, from the callee slot up to the top
+      static_type saved_slot = static_type::unknown;
+    };
+
+    struct analysis
+    {
+      std::vector<std::optional<type_state>> states; // state on entry of the instruction at each offset
+    };
+  } // namespace
+
+  static static_type join(static_type p_lhs, static_type p_rhs)
+  {
+    return p_lhs == p_rhs ? p_lhs : static_type::unknown;
+  }
+
+  static bool is_unchecked(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add_unchecked:
+    case opcode::op_subtract_unchecked:
+    case opcode::op_multiply_unchecked:
+    case opcode::op_divide_unchecked:
+    case opcode::op_greater_unchecked:
+    case opcode::op_greater_equal_unchecked:
+    case opcode::op_less_unchecked:
+    case opcode::op_less_equal_unchecked:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static bool is_specializable(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add:
+    case opcode::op_subtract:
+    case opcode::op_multiply:
+    case opcode::op_divide:
+    case opcode::op_greater:
+    case opcode::op_greater_equal:
+    case opcode::op_less:
+    case opcode::op_less_equal:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // the _rk register instructions, their rhs is a number constant
+  static bool is_constant_rhs(opcode p_op)
+  {
+    switch(p_op)
+    {
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rk:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rk_jump:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // slots handed to a closure as upvalues, read from the descriptors trailing every op_closure
+  static std::vector<bool> captured_slots(const chunk& p_chunk)
+  {
+    std::vector<bool> captured;
+    for(size_t offset = 0; offset < p_chunk.code.size(); offset += instruction_length(p_chunk, offset))
+    {
+      if(static_cast<opcode>(p_chunk.code[offset]) != opcode::op_closure)
+        continue;
+      const auto length = instruction_length(p_chunk, offset);
+      const auto descriptors = offset + 1 + instruction_length(p_chunk, offset + 1);
+      for(auto upvalue = descriptors; upvalue < offset + length; upvalue += 4)
+      {
+        if(!p_chunk.code[upvalue])
+          continue;
+        const auto index = decode_int<uint32_t, 3>(p_chunk.code, upvalue + 1);
+        if(index >= captured.size())
+          captured.resize(index + 1);
+        captured[index] = true;
+      }
+    }
+    return captured;
+  }
+
+  // applies the instruction at p_offset to p_state and collects where control goes next, false if it is not modeled
+  static bool step(const chunk& p_chunk,
+                   const std::vector<bool>& p_captured,
+                   size_t p_offset,
+                   type_state& p_state,
+                   std::vector<std::pair<size_t, type_state>>& p_successors)
+  {
+    const auto& code = p_chunk.code;
+    auto& stack = p_state.stack;
+    const auto op = static_cast<opcode>(code[p_offset]);
+    const auto next = p_offset + instruction_length(p_chunk, p_offset);
+    const auto short_operand = [&]() -> uint32_t { return code[p_offset + 1]; };
+    const auto long_operand = [&]() { return decode_int<uint32_t, 3>(code, p_offset + 1); };
+    const auto pop = [&](size_t p_count)
+    {
+      if(stack.size() < p_count)
+        return false;
+      stack.resize(stack.size() - p_count);
+      return true;
+    };
+    const auto read_slot = [&](uint32_t p_index, static_type& p_out)
+    {
+      if(p_index >= stack.size())
+        return false;
+      const auto captured = p_index < p_captured.size() && p_captured[p_index];
+      p_out = captured ? static_type::unknown : stack[p_index];
+      return true;
+    };
+    const auto jump_target = [&]()
+    {
+      const auto operand = long_operand();
+      return op == opcode::op_loop ? next - operand : next + operand;
+    };
+
+    switch(op)
+    {
+    case opcode::op_pop:
+      if(!pop(1))
+        return false;
+      break;
+    case opcode::op_pop_n:
+      if(!pop(short_operand()))
+        return false;
+      break;
+    case opcode::op_constant:
+    case opcode::op_constant_long:
+    {
+      const auto index = op == opcode::op_constant ? short_operand() : long_operand();
+      if(index >= p_chunk.constants.size())
+        return false;
+      stack.push_back(OK_IS_VALUE_NUMBER(p_chunk.constants[index]) ? static_type::number : static_type::unknown);
+      break;
+    }
+    case opcode::op_get_local:
+    case opcode::op_get_local_long:
+    // superinstructions fall back to the op_get_local they were written over, the rest of the sequence follows
+    case opcode::op_get_local_get_local_add:
+    case opcode::op_get_local_constant_less_jump:
+    case opcode::op_get_local_constant_add_set_local_pop:
+    {
+      static_type type;
+      if(!read_slot(op == opcode::op_get_local_long ? long_operand() : short_operand(), type))
+        return false;
+      stack.push_back(type);
+      break;
+    }
+    case opcode::op_set_local:
+    case opcode::op_set_local_long:
+    {
+      const auto index = op == opcode::op_set_local ? short_operand() : long_operand();
+      if(stack.empty() || index >= stack.size())
+        return false;
+      stack[index] = stack.back();
+      break;
+    }
+    case opcode::op_set_if_local:
+    case opcode::op_set_if_local_long:
+    {
+      // the set happens only if the trailing compare says so, the value is popped either way
+      const auto index = op == opcode::op_set_if_local ? short_operand() : long_operand();
+      if(stack.empty() || index >= stack.size())
+        return false;
+      stack[index] = join(stack[index], stack.back());
+      stack.pop_back();
+      break;
+    }
+    case opcode::op_null:
+    case opcode::op_true:
+    case opcode::op_false:
+    case opcode::op_get_global:
+    case opcode::op_get_global_long:
+    case opcode::op_get_upvalue:
+    case opcode::op_get_upvalue_long:
+    case opcode::op_closure:
+    case opcode::op_class:
+    case opcode::op_class_long:
+      stack.push_back(static_type::unknown);
+      break;
+    case opcode::op_set_global:
+    case opcode::op_set_global_long:
+    case opcode::op_set_upvalue:
+    case opcode::op_set_upvalue_long:
+    case opcode::op_close_upvalue:
+      if(stack.empty())
+        return false;
+      break;
+    case opcode::op_set_if_global:
+    case opcode::op_set_if_global_long:
+    case opcode::op_define_global:
+    case opcode::op_define_global_long:
+    case opcode::op_print:
+    case opcode::op_method:
+    case opcode::op_method_long:
+    case opcode::op_special_method:
+    case opcode::op_inherit:
+      if(!pop(1))
+        return false;
+      break;
+    case opcode::op_return:
+      return !stack.empty();
+    case opcode::op_jump:
+    case opcode::op_loop:
+      p_successors.emplace_back(jump_target(), p_state);
+      return true;
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+      if(!pop(1))
+        return false;
+      p_successors.emplace_back(jump_target(), p_state);
+      break;
+    case opcode::op_conditional_jump_leave:
+    case opcode::op_conditional_truthy_jump_leave:
+      // the condition is popped either way, falling through also pops the value under it
+      if(!pop(1))
+        return false;
+      p_successors.emplace_back(jump_target(), p_state);
+      if(!pop(1))
+        return false;
+      break;
+    case opcode::op_call:
+    case opcode::op_invoke:
+    case opcode::op_invoke_long:
+    case opcode::op_invoke_super:
+    case opcode::op_invoke_super_long:
+    {
+      // the callee or receiver and the arguments are replaced by the result, super invokes also pop the superclass
+      const auto argc = op == opcode::op_call                                                ? code[p_offset + 1]
+                        : op == opcode::op_invoke || op == opcode::op_invoke_super ? code[p_offset + 2]
+                                                                                   : code[p_offset + 4];
+      const auto super = op == opcode::op_invoke_super || op == opcode::op_invoke_super_long;
+      if(!pop(argc + 1 + super))
+        return false;
+      stack.push_back(static_type::unknown);
+      break;
+    }
+    case opcode::op_get_super:
+    case opcode::op_get_super_long:
+    case opcode::op_set_property:
+    case opcode::op_set_property_long:
+      if(!pop(2))
+        return false;
+      stack.push_back(static_type::unknown);
+      break;
+    case opcode::op_get_property:
+    case opcode::op_get_property_long:
+    case opcode::op_not:
+    case opcode::op_tiled:
+    case opcode::op_postincrement:
+    case opcode::op_postdecrement:
+      if(!pop(1))
+        return false;
+      stack.push_back(static_type::unknown);
+      break;
+    case opcode::op_negate:
+    case opcode::op_additive:
+    case opcode::op_preincrement:
+    case opcode::op_predecrement:
+      // a number stays a number and anything else may end up anything
+      if(stack.empty())
+        return false;
+      break;
+    case opcode::op_save_slot:
+      if(stack.empty())
+        return false;
+      p_state.saved_slot = stack.back();
+      break;
+    case opcode::op_push_saved_slot:
+      stack.push_back(p_state.saved_slot);
+      p_state.saved_slot = static_type::unknown;
+      break;
+    case opcode::op_add:
+    case opcode::op_subtract:
+    case opcode::op_multiply:
+    case opcode::op_divide:
+    case opcode::op_add_nn:
+    case opcode::op_subtract_nn:
+    case opcode::op_multiply_nn:
+    case opcode::op_divide_nn:
+    case opcode::op_add_unchecked:
+    case opcode::op_subtract_unchecked:
+    case opcode::op_multiply_unchecked:
+    case opcode::op_divide_unchecked:
+    {
+      if(stack.size() < 2)
+        return false;
+      const auto numbers = stack.back() == static_type::number && stack[stack.size() - 2] == static_type::number;
+      stack.pop_back();
+      stack.back() = numbers ? static_type::number : static_type::unknown;
+      break;
+    }
+    case opcode::op_modulo:
+    case opcode::op_xor:
+    case opcode::op_or:
+    case opcode::op_and:
+    case opcode::op_shift_left:
+    case opcode::op_shift_right:
+    case opcode::op_equal:
+    case opcode::op_not_equal:
+    case opcode::op_greater:
+    case opcode::op_less:
+    case opcode::op_greater_equal:
+    case opcode::op_less_equal:
+    case opcode::op_greater_nn:
+    case opcode::op_greater_equal_nn:
+    case opcode::op_less_nn:
+    case opcode::op_less_equal_nn:
+    case opcode::op_greater_unchecked:
+    case opcode::op_greater_equal_unchecked:
+    case opcode::op_less_unchecked:
+    case opcode::op_less_equal_unchecked:
+    case opcode::op_add_assign:
+    case opcode::op_subtract_assign:
+    case opcode::op_multiply_assign:
+    case opcode::op_divide_assign:
+    case opcode::op_modulo_assign:
+    case opcode::op_and_assign:
+    case opcode::op_xor_assign:
+    case opcode::op_or_assign:
+    case opcode::op_shift_left_assign:
+    case opcode::op_shift_right_assign:
+    case opcode::op_as:
+      if(!pop(2))
+        return false;
+      stack.push_back(static_type::unknown);
+      break;
+    case opcode::op_add_rr:
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rr:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rr:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rr:
+    case opcode::op_divide_rk:
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rr_jump:
+    case opcode::op_less_equal_rk_jump:
+    {
+      // the stub is entered with both operands pushed, the fast path only runs on numbers
+      const auto arithmetic = next - p_offset == 7;
+      const auto operands = p_offset + (arithmetic ? 2 : 1);
+      const auto constant_rhs = is_constant_rhs(op);
+      static_type lhs;
+      static_type rhs = static_type::number;
+      if(!read_slot(code[operands], lhs) || (!constant_rhs && !read_slot(code[operands + 1], rhs)))
+        return false;
+      auto miss = p_state;
+      miss.stack.push_back(lhs);
+      miss.stack.push_back(rhs);
+      p_successors.emplace_back(next + decode_int<uint32_t, 3>(code, next - 3), std::move(miss));
+      if(arithmetic)
+      {
+        const auto dst = code[p_offset + 1];
+        if(dst >= stack.size())
+          return false;
+        stack[dst] = static_type::number;
+      }
+      else
+      {
+        p_successors.emplace_back(next + decode_int<uint32_t, 3>(code, p_offset + 3), p_state);
+      }
+      break;
+    }
+    default:
+      // op_convert_method and op_set_if_property have stack effects that depend on the runtime values
+      return false;
+    }
+    p_successors.emplace_back(next, p_state);
+    return true;
+  }
+
+  static std::optional<analysis> analyze(const chunk& p_chunk, uint8_t p_arity)
+  {
+    const auto& code = p_chunk.code;
+    analysis result;
+    if(code.empty())
+      return result;
+
+    const auto captured = captured_slots(p_chunk);
+    std::vector<bool> starts(code.size(), false);
+    for(size_t offset = 0; offset < code.size(); offset += instruction_length(p_chunk, offset))
+    {
+      starts[offset] = true;
+    }
+
+    // the callee or this, then the parameters. nothing is known about any of them
+    result.states.resize(code.size());
+    result.states[0] = type_state{.stack = std::vector<static_type>(1 + p_arity, static_type::unknown)};
+    std::vector<size_t> worklist{0};
+    std::vector<std::pair<size_t, type_state>> successors;
+    while(!worklist.empty())
+    {
+      const auto offset = worklist.back();
+      worklist.pop_back();
+      auto state = *result.states[offset];
+      successors.clear();
+      if(!step(p_chunk, captured, offset, state, successors))
+        return std::nullopt;
+
+      for(auto& [target, successor] : successors)
+      {
+        if(target >= code.size() || !starts[target])
+          return std::nullopt;
+        auto& known = result.states[target];
+        if(!known)
+        {
+          known = std::move(successor);
+          worklist.push_back(target);
+          continue;
+        }
+        if(known->stack.size() != successor.stack.size())
+          return std::nullopt;
+        bool changed = false;
+        for(size_t i = 0; i < successor.stack.size(); ++i)
+        {
+          const auto joined = join(known->stack[i], successor.stack[i]);
+          changed |= joined != known->stack[i];
+          known->stack[i] = joined;
+        }
+        const auto saved = join(known->saved_slot, successor.saved_slot);
+        changed |= saved != known->saved_slot;
+        known->saved_slot = saved;
+        if(changed && std::find(worklist.begin(), worklist.end(), target) == worklist.end())
+          worklist.push_back(target);
+      }
+    }
+    return result;
+  }
+
+  static bool number_operands_at(const analysis& p_analysis, size_t p_offset)
+  {
+    const auto& stack = p_analysis.states[p_offset]->stack;
+    return stack.size() >= 2 && stack.back() == static_type::number && stack[stack.size() - 2] == static_type::number;
+  }
+
+  // the length of the instruction at p_offset if it fits in the code and refers to constants, identifiers and upvalues
+  // that exist, 0 otherwise. where it may jump to is added to p_targets. slots are checked by the depth walk
+  static size_t checked_length(const chunk& p_chunk,
+                               size_t p_offset,
+                               uint32_t p_upvalues,
+                               std::vector<size_t>& p_targets)
+  {
+    const auto& code = p_chunk.code;
+    const auto op = static_cast<opcode>(code[p_offset]);
+    if(op == opcode::op_invalid || op > opcode::op_less_equal_rk_jump)
+      return 0;
+    const auto fits = [&](size_t p_length) { return p_length <= code.size() - p_offset; };
+    const auto short_operand = [&](size_t p_at) -> uint32_t { return code[p_offset + p_at]; };
+    const auto long_operand = [&](size_t p_at) { return decode_int<uint32_t, 3>(code, p_offset + p_at); };
+    const auto constant = [&](uint32_t p_index) { return p_index < p_chunk.constants.size(); };
+    const auto identifier = [&](uint32_t p_index)
+    { return p_index < p_chunk.identifiers.size() && OK_IS_VALUE_STRING_OBJECT(p_chunk.identifiers[p_index]); };
+    const auto follows = [&](size_t p_at, std::initializer_list<opcode> p_ops)
+    { return fits(p_at + 1) && std::ranges::find(p_ops, static_cast<opcode>(code[p_offset + p_at])) != p_ops.end(); };
+
+    // op_closure is the only instruction whose length depends on what it refers to
+    if(op == opcode::op_closure)
+    {
+      const auto is_long = follows(1, {opcode::op_constant_long});
+      if(!is_long && !follows(1, {opcode::op_constant}))
+        return 0;
+      const size_t length = is_long ? 5 : 3;
+      if(!fits(length))
+        return 0;
+      const auto index = is_long ? long_operand(2) : short_operand(2);
+      if(!constant(index) || !OK_IS_VALUE_FUNCTION_OBJECT(p_chunk.constants[index]))
+        return 0;
+      const auto upvalues = OK_VALUE_AS_FUNCTION_OBJECT(p_chunk.constants[index])->upvalues;
+      if(upvalues > (code.size() - p_offset - length) / 4)
+        return 0;
+      // a local descriptor captures a slot of this frame, the others one of this closure's upvalues
+      for(size_t at = length; at < length + upvalues * 4; at += 4)
+      {
+        const auto local = short_operand(at);
+        if(local > 1 || (!local && long_operand(at + 1) >= p_upvalues))
+          return 0;
+      }
+      return length + upvalues * 4;
+    }
+
+    const auto length = instruction_length(p_chunk, p_offset);
+    if(!fits(length))
+      return 0;
+    const auto next = p_offset + length;
+    const auto add = {opcode::op_add, opcode::op_add_nn, opcode::op_add_unchecked};
+    const auto less = {opcode::op_less, opcode::op_less_nn, opcode::op_less_unchecked};
+    switch(op)
+    {
+    case opcode::op_constant:
+      return constant(short_operand(1)) ? length : 0;
+    case opcode::op_constant_long:
+      return constant(long_operand(1)) ? length : 0;
+    case opcode::op_define_global:
+    case opcode::op_get_global:
+    case opcode::op_set_global:
+    case opcode::op_set_if_global:
+    case opcode::op_get_property:
+    case opcode::op_set_property:
+    case opcode::op_set_if_property:
+    case opcode::op_class:
+    case opcode::op_method:
+    case opcode::op_invoke:
+    case opcode::op_get_super:
+    case opcode::op_invoke_super:
+      return identifier(short_operand(1)) ? length : 0;
+    case opcode::op_define_global_long:
+    case opcode::op_get_global_long:
+    case opcode::op_set_global_long:
+    case opcode::op_set_if_global_long:
+    case opcode::op_get_property_long:
+    case opcode::op_set_property_long:
+    case opcode::op_set_if_property_long:
+    case opcode::op_class_long:
+    case opcode::op_method_long:
+    case opcode::op_invoke_long:
+    case opcode::op_get_super_long:
+    case opcode::op_invoke_super_long:
+      return identifier(long_operand(1)) ? length : 0;
+    case opcode::op_get_upvalue:
+    case opcode::op_set_upvalue:
+    case opcode::op_set_if_upvalue:
+      return short_operand(1) < p_upvalues ? length : 0;
+    case opcode::op_get_upvalue_long:
+    case opcode::op_set_upvalue_long:
+    case opcode::op_set_if_upvalue_long:
+      return long_operand(1) < p_upvalues ? length : 0;
+    // the fast path of a superinstruction reads the rest of its sequence, the walk checks the operands in there. the
+    // operator in it may have been quickened or specialized since
+    case opcode::op_get_local_get_local_add:
+      return follows(2, {opcode::op_get_local}) && follows(4, add) ? length : 0;
+    case opcode::op_get_local_constant_less_jump:
+      return follows(2, {opcode::op_constant}) && follows(4, less) && follows(5, {opcode::op_conditional_jump})
+                 ? length
+                 : 0;
+    case opcode::op_get_local_constant_add_set_local_pop:
+      return follows(2, {opcode::op_constant}) && follows(4, add) && follows(5, {opcode::op_set_local}) &&
+                     follows(7, {opcode::op_pop})
+                 ? length
+                 : 0;
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+    case opcode::op_conditional_jump_leave:
+    case opcode::op_conditional_truthy_jump_leave:
+    case opcode::op_jump:
+      p_targets.push_back(next + long_operand(1));
+      return length;
+    case opcode::op_loop:
+      if(long_operand(1) > next)
+        return 0;
+      p_targets.push_back(next - long_operand(1));
+      return length;
+    case opcode::op_add_rr:
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rr:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rr:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rr:
+    case opcode::op_divide_rk:
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rr_jump:
+    case opcode::op_less_equal_rk_jump:
+    {
+      const auto arithmetic = length == 7;
+      if(is_constant_rhs(op) && !constant(short_operand(arithmetic ? 3 : 2)))
+        return 0;
+      p_targets.push_back(next + long_operand(length - 3));
+      if(!arithmetic)
+        p_targets.push_back(next + long_operand(3));
+      return length;
+    }
+    default:
+      return length;
+    }
+  }
+
+  // where control goes from the instruction at p_offset entered with p_depth values in the frame, callee slot
+  // included, and how many values there are then. false if it takes more values than there are above the callee slot
+  // or reads a slot that is not there
+  static bool depth_step(const chunk& p_chunk,
+                         size_t p_offset,
+                         size_t p_next,
+                         size_t p_depth,
+                         std::vector<std::pair<size_t, size_t>>& p_successors)
+  {
+    const auto& code = p_chunk.code;
+    const auto op = static_cast<opcode>(code[p_offset]);
+    const auto short_operand = [&](size_t p_at) -> uint32_t { return code[p_offset + p_at]; };
+    const auto long_operand = [&](size_t p_at) { return decode_int<uint32_t, 3>(code, p_offset + p_at); };
+    // the callee slot belongs to the frame, only op_return discards it
+    const auto operands = [&](size_t p_count) { return p_depth > p_count; };
+    const auto slot = [&](uint32_t p_index) { return p_index < p_depth; };
+    size_t pops = 0;
+    size_t pushes = 0;
+
+    switch(op)
+    {
+    case opcode::op_pop:
+      pops = 1;
+      break;
+    case opcode::op_pop_n:
+      pops = short_operand(1);
+      break;
+    case opcode::op_constant:
+    case opcode::op_constant_long:
+    case opcode::op_null:
+    case opcode::op_true:
+    case opcode::op_false:
+    case opcode::op_get_global:
+    case opcode::op_get_global_long:
+    case opcode::op_get_upvalue:
+    case opcode::op_get_upvalue_long:
+    case opcode::op_class:
+    case opcode::op_class_long:
+    case opcode::op_push_saved_slot:
+      pushes = 1;
+      break;
+    case opcode::op_closure:
+    {
+      // a local function can capture itself, it is in the slot the closure is pushed to
+      const auto length = static_cast<opcode>(code[p_offset + 1]) == opcode::op_constant_long ? 5 : 3;
+      for(auto at = p_offset + length; at < p_next; at += 4)
+      {
+        if(code[at] && decode_int<uint32_t, 3>(code, at + 1) > p_depth)
+          return false;
+      }
+      pushes = 1;
+      break;
+    }
+    case opcode::op_get_local:
+    case opcode::op_get_local_long:
+      if(!slot(op == opcode::op_get_local ? short_operand(1) : long_operand(1)))
+        return false;
+      pushes = 1;
+      break;
+    // the fast paths read the slots of the whole sequence at the depth of its first instruction
+    case opcode::op_get_local_get_local_add:
+      if(!slot(short_operand(1)) || !slot(short_operand(3)))
+        return false;
+      pushes = 1;
+      break;
+    case opcode::op_get_local_constant_less_jump:
+      if(!slot(short_operand(1)))
+        return false;
+      pushes = 1;
+      break;
+    case opcode::op_get_local_constant_add_set_local_pop:
+      if(!slot(short_operand(1)) || !slot(short_operand(6)))
+        return false;
+      pushes = 1;
+      break;
+    case opcode::op_set_local:
+    case opcode::op_set_local_long:
+      if(!operands(1) || !slot(op == opcode::op_set_local ? short_operand(1) : long_operand(1)))
+        return false;
+      break;
+    case opcode::op_set_if_local:
+    case opcode::op_set_if_local_long:
+      if(!slot(op == opcode::op_set_if_local ? short_operand(1) : long_operand(1)))
+        return false;
+      pops = 1;
+      break;
+    case opcode::op_set_global:
+    case opcode::op_set_global_long:
+    case opcode::op_set_upvalue:
+    case opcode::op_set_upvalue_long:
+    case opcode::op_close_upvalue:
+    case opcode::op_save_slot:
+      if(!operands(1))
+        return false;
+      break;
+    case opcode::op_set_if_global:
+    case opcode::op_set_if_global_long:
+    case opcode::op_set_if_upvalue:
+    case opcode::op_set_if_upvalue_long:
+    case opcode::op_define_global:
+    case opcode::op_define_global_long:
+    case opcode::op_print:
+      pops = 1;
+      break;
+    case opcode::op_method:
+    case opcode::op_method_long:
+    case opcode::op_special_method:
+    case opcode::op_inherit:
+      // the class stays under the method or the subclass
+      if(!operands(2))
+        return false;
+      pops = 1;
+      break;
+    case opcode::op_convert_method:
+      if(!operands(3))
+        return false;
+      pops = 2;
+      break;
+    case opcode::op_set_if_property:
+    case opcode::op_set_if_property_long:
+      pops = 2;
+      break;
+    case opcode::op_return:
+      return operands(1);
+    case opcode::op_jump:
+      p_successors.emplace_back(p_next + long_operand(1), p_depth);
+      return true;
+    case opcode::op_loop:
+      p_successors.emplace_back(p_next - long_operand(1), p_depth);
+      return true;
+    case opcode::op_conditional_jump:
+    case opcode::op_conditional_truthy_jump:
+      if(!operands(1))
+        return false;
+      p_successors.emplace_back(p_next + long_operand(1), p_depth - 1);
+      pops = 1;
+      break;
+    case opcode::op_conditional_jump_leave:
+    case opcode::op_conditional_truthy_jump_leave:
+      // the condition is popped either way, falling through also pops the value under it
+      if(!operands(2))
+        return false;
+      p_successors.emplace_back(p_next + long_operand(1), p_depth - 1);
+      pops = 2;
+      break;
+    case opcode::op_call:
+      pops = short_operand(1) + 1;
+      pushes = 1;
+      break;
+    case opcode::op_invoke:
+      pops = short_operand(2) + 1;
+      pushes = 1;
+      break;
+    case opcode::op_invoke_long:
+      pops = short_operand(4) + 1;
+      pushes = 1;
+      break;
+    // the superclass is popped on top of the receiver and the arguments
+    case opcode::op_invoke_super:
+      pops = short_operand(2) + 2;
+      pushes = 1;
+      break;
+    case opcode::op_invoke_super_long:
+      pops = short_operand(4) + 2;
+      pushes = 1;
+      break;
+    case opcode::op_get_property:
+    case opcode::op_get_property_long:
+    case opcode::op_not:
+    case opcode::op_tiled:
+    case opcode::op_additive:
+    case opcode::op_negate:
+    case opcode::op_preincrement:
+    case opcode::op_predecrement:
+    case opcode::op_postincrement:
+    case opcode::op_postdecrement:
+      pops = 1;
+      pushes = 1;
+      break;
+    case opcode::op_get_super:
+    case opcode::op_get_super_long:
+    case opcode::op_set_property:
+    case opcode::op_set_property_long:
+    case opcode::op_add:
+    case opcode::op_subtract:
+    case opcode::op_multiply:
+    case opcode::op_divide:
+    case opcode::op_modulo:
+    case opcode::op_xor:
+    case opcode::op_or:
+    case opcode::op_and:
+    case opcode::op_shift_left:
+    case opcode::op_shift_right:
+    case opcode::op_equal:
+    case opcode::op_not_equal:
+    case opcode::op_greater:
+    case opcode::op_less:
+    case opcode::op_greater_equal:
+    case opcode::op_less_equal:
+    case opcode::op_add_assign:
+    case opcode::op_subtract_assign:
+    case opcode::op_multiply_assign:
+    case opcode::op_divide_assign:
+    case opcode::op_modulo_assign:
+    case opcode::op_and_assign:
+    case opcode::op_xor_assign:
+    case opcode::op_or_assign:
+    case opcode::op_shift_left_assign:
+    case opcode::op_shift_right_assign:
+    case opcode::op_as:
+    case opcode::op_add_nn:
+    case opcode::op_subtract_nn:
+    case opcode::op_multiply_nn:
+    case opcode::op_divide_nn:
+    case opcode::op_greater_nn:
+    case opcode::op_greater_equal_nn:
+    case opcode::op_less_nn:
+    case opcode::op_less_equal_nn:
+    case opcode::op_add_unchecked:
+    case opcode::op_subtract_unchecked:
+    case opcode::op_multiply_unchecked:
+    case opcode::op_divide_unchecked:
+    case opcode::op_greater_unchecked:
+    case opcode::op_greater_equal_unchecked:
+    case opcode::op_less_unchecked:
+    case opcode::op_less_equal_unchecked:
+      pops = 2;
+      pushes = 1;
+      break;
+    case opcode::op_add_rr:
+    case opcode::op_add_rk:
+    case opcode::op_subtract_rr:
+    case opcode::op_subtract_rk:
+    case opcode::op_multiply_rr:
+    case opcode::op_multiply_rk:
+    case opcode::op_divide_rr:
+    case opcode::op_divide_rk:
+    case opcode::op_greater_rr_jump:
+    case opcode::op_greater_rk_jump:
+    case opcode::op_greater_equal_rr_jump:
+    case opcode::op_greater_equal_rk_jump:
+    case opcode::op_less_rr_jump:
+    case opcode::op_less_rk_jump:
+    case opcode::op_less_equal_rr_jump:
+    case opcode::op_less_equal_rk_jump:
+    {
+      // the stub is entered with both operands pushed
+      const auto arithmetic = p_next - p_offset == 7;
+      const size_t lhs = arithmetic ? 2 : 1;
+      if((arithmetic && !slot(short_operand(1))) || !slot(short_operand(lhs)) ||
+         (!is_constant_rhs(op) && !slot(short_operand(lhs + 1))))
+        return false;
+      p_successors.emplace_back(p_next + decode_int<uint32_t, 3>(code, p_next - 3), p_depth + 2);
+      if(!arithmetic)
+        p_successors.emplace_back(p_next + long_operand(3), p_depth);
+      break;
+    }
+    default:
+      return false;
+    }
+    if(!operands(pops))
+      return false;
+    p_successors.emplace_back(p_next, p_depth - pops + pushes);
+    return true;
+  }
+
+  std::optional<std::vector<size_t>> verifier::number_operands(const chunk& p_chunk, uint8_t p_arity)
+  {
+    const auto result = analyze(p_chunk, p_arity);
+    if(!result)
+      return std::nullopt;
+
+    std::vector<size_t> offsets;
+    for(size_t offset = 0; offset < result->states.size(); ++offset)
+    {
+      if(result->states[offset] && is_specializable(static_cast<opcode>(p_chunk.code[offset])) &&
+         number_operands_at(*result, offset))
+        offsets.push_back(offset);
+    }
+    return offsets;
+  }
+
+  bool verifier::verify(const chunk& p_chunk, uint8_t p_arity)
+  {
+    bool has_unchecked = false;
+    for(size_t offset = 0; offset < p_chunk.code.size(); offset += instruction_length(p_chunk, offset))
+      has_unchecked |= is_unchecked(static_cast<opcode>(p_chunk.code[offset]));
+    if(!has_unchecked)
+      return true;
+
+    const auto result = analyze(p_chunk, p_arity);
+    if(!result)
+      return false;
+    // unreachable code is never run, so it does not matter what it holds
+    for(size_t offset = 0; offset < result->states.size(); ++offset)
+    {
+      if(result->states[offset] && is_unchecked(static_cast<opcode>(p_chunk.code[offset])) &&
+         !number_operands_at(*result, offset))
+        return false;
+    }
+    return true;
+  }
+
+  bool verifier::well_formed(const chunk& p_chunk, uint8_t p_arity, uint32_t p_upvalues)
+  {
+    const auto& code = p_chunk.code;
+    std::vector<size_t> lengths(code.size(), 0);
+    std::vector<size_t> targets;
+    for(size_t offset = 0; offset < code.size(); offset += lengths[offset])
+    {
+      lengths[offset] = checked_length(p_chunk, offset, p_upvalues, targets);
+      if(lengths[offset] == 0)
+        return false;
+    }
+    if(!std::ranges::all_of(targets, [&](size_t p_target) { return p_target < code.size() && lengths[p_target]; }))
+      return false;
+    if(code.empty())
+      return true;
+
+    // every path has to reach an instruction with the same number of values in the frame, so the slots an instruction
+    // refers to are there whichever way it was reached. the callee and the parameters are there on entry
+    constexpr auto unreached = std::numeric_limits<size_t>::max();
+    std::vector<size_t> depths(code.size(), unreached);
+    depths[0] = 1 + p_arity;
+    std::vector<size_t> worklist{0};
+    std::vector<std::pair<size_t, size_t>> successors;
+    while(!worklist.empty())
+    {
+      const auto offset = worklist.back();
+      worklist.pop_back();
+      successors.clear();
+      if(!depth_step(p_chunk, offset, offset + lengths[offset], depths[offset], successors))
+        return false;
+      for(const auto [target, depth] : successors)
+      {
+        if(target >= code.size() || !lengths[target])
+          return false;
+        if(depths[target] == unreached)
+        {
+          depths[target] = depth;
+          worklist.push_back(target);
+        }
+        else if(depths[target] != depth)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+} // namespace ok
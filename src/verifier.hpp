@@ -0,0 +1,29 @@
+#ifndef OK_VERIFIER_HPP
+#define OK_VERIFIER_HPP
+
+#include "chunk.hpp"
+#include <optional>
+#include <vector>
+
+namespace ok
+{
+  // flow sensitive type inference over a function chunk. it walks every path with a model of the stack whose slots are
+  // either proven numbers or anything, locals included since they live in the frame's stack slots. slots captured by a
+  // closure can be written through an upvalue at any call so they are never proven
+  struct verifier
+  {
+    // offsets of the arithmetic and comparison instructions that can only ever see two number operands, nullopt when
+    // the chunk has an instruction the analysis does not model
+    static std::optional<std::vector<size_t>> number_operands(const chunk& p_chunk, uint8_t p_arity);
+    // rejects the chunk if any unchecked instruction can be reached with an operand that is not proven to be a number,
+    // or if the chunk has unchecked instructions and can not be analysed
+    static bool verify(const chunk& p_chunk, uint8_t p_arity);
+    // rejects the chunk unless every instruction fits in the code, refers to constants, identifiers and upvalues that
+    // exist and every jump lands on an instruction. every path must reach an instruction with the same stack depth and
+    // no instruction may pop the callee slot or refer to a slot above the depth. bytes that did not pass it must not be
+    // decoded
+    static bool well_formed(const chunk& p_chunk, uint8_t p_arity, uint32_t p_upvalues);
+  };
+} // namespace ok
+
+#endif // OK_VERIFIER_HPP
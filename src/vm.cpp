@@ -4,6 +4,7 @@
 #include "compiler.hpp"
 #include "copy.hpp"
 #include "debug.hpp"
+#include "jit.hpp"
 #include "log.hpp"
 #include "macros.hpp"
 #include "object.hpp"
@@ -1121,32 +1122,55 @@ namespace ok
     define_native_function("rand", rand_native);
   }
 
-  auto vm::interpret(const std::string_view p_filename, const std::string_view p_source) -> interpret_result
+  function_object* vm::compile(const std::string_view p_filename, const std::string_view p_source)
   {
     m_compiler = compiler{}; // reinitialize and clear previous state
+    m_compiler.set_options(m_compile_options);
     push_call_frame(call_frame{.ip = nullptr, .slots = 0, .top = 0, .closure = nullptr});
-    auto compile_result = m_compiler.compile(
+    return m_compiler.compile(
         this,
         p_filename,
         p_source,
         new_tobject<string_object>("main", get_builtin_class(object_type::obj_string), get_objects_list()));
+  }
+
+  auto vm::interpret(const std::string_view p_filename, const std::string_view p_source) -> interpret_result
+  {
+    auto compile_result = compile(p_filename, p_source);
     if(!compile_result)
     {
       if(m_compiler.get_parse_errors().errs.empty())
         return interpret_result::compile_error;
       return interpret_result::parse_error;
     }
+    return execute(compile_result);
+  }
+
+  bool vm::compile_lazy(function_object* p_function)
+  {
+    if(m_compiler.compile_lazy(p_function))
+      return true;
+    m_compiler.get_compile_errors().show();
+    return false;
+  }
+
+  auto vm::execute(function_object* p_script) -> interpret_result
+  {
     m_call_frames = {};
     m_call_frames.reserve(s_call_frame_max_size);
     stack_resize(0);
-    m_stack.push(value_t{copy{(object*)compile_result}});
+    m_stack.push(value_t{copy{(object*)p_script}});
     auto closure =
-        new_tobject<closure_object>(compile_result, get_builtin_class(object_type::obj_closure), get_objects_list());
+        new_tobject<closure_object>(p_script, get_builtin_class(object_type::obj_closure), get_objects_list());
     m_stack.top() = value_t{copy{(object*)closure}};
     if(!push_call_frame(call_frame{closure, closure->function->associated_chunk.code.data(), 0, 0}))
     {
       return interpret_result::runtime_error;
     }
+    if(p_script->jitted != nullptr)
+    {
+      enter_jit(m_call_frames.back());
+    }
     auto res = run();
 #if !defined(OK_NOT_GARBAGE_COLLECTED)
     m_gc.collect();
@@ -1163,11 +1187,27 @@ namespace ok
   auto vm::run() -> interpret_result
   {
     auto* frame = &m_call_frames.back();
+    m_recorder.stop(); // a loop an earlier run left half recorded
     // auto end = m_chunk->code.data() + m_chunk->code.size();
     void* endptr =
         frame->closure->function->associated_chunk.code.data() + frame->closure->function->associated_chunk.code.size();
     auto end = (byte*)endptr;
     auto& ip = frame->ip;
+    // register instructions, ip is at their first operand. the rhs is a slot or for the _rk forms a constant
+    const auto register_operands = [&](bool p_constant_rhs, size_t p_lhs)
+    {
+      const auto lhs = m_stack[frame->slots + frame->ip[p_lhs]];
+      const auto rhs = p_constant_rhs ? frame->closure->function->associated_chunk.constants[frame->ip[p_lhs + 1]]
+                                      : m_stack[frame->slots + frame->ip[p_lhs + 1]];
+      return std::pair{lhs, rhs};
+    };
+    // type miss, the stub runs the stack instructions the register instruction replaced on the pushed operands
+    const auto register_miss = [&](value_t p_lhs, value_t p_rhs, size_t p_length)
+    {
+      m_stack.push(p_lhs);
+      m_stack.push(p_rhs);
+      frame->ip += p_length + decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + p_length - 3, 3}, 0);
+    };
     while(true)
     {
 #ifdef PARANOID
@@ -1184,6 +1224,15 @@ namespace ok
           frame->closure->function->associated_chunk,
           static_cast<size_t>(frame->ip - frame->closure->function->associated_chunk.code.data()));
 #endif
+      if(m_recorder.recording()) [[unlikely]]
+      {
+        const auto& chunk = frame->closure->function->associated_chunk;
+        m_recorder.record(chunk,
+                          m_call_frames.size(),
+                          frame->ip - chunk.code.data(),
+                          m_stack.value_ptr(frame->slots),
+                          m_stack.value_ptr(m_stack.size()));
+      }
       // TODO(Qais): computed goto
       switch(uint8_t instruction = read_byte())
       {
@@ -1209,6 +1258,10 @@ namespace ok
         }
         frame = &m_call_frames.back();
         m_stack.push(res);
+        if(frame->closure->function->jitted != nullptr)
+        {
+          enter_jit(*frame);
+        }
         break;
       }
       case to_utype(opcode::op_pop):
@@ -1314,6 +1367,10 @@ namespace ok
       }
       case to_utype(opcode::op_add):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_add_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_plus>();
         if(!ret)
         {
@@ -1324,6 +1381,10 @@ namespace ok
       }
       case to_utype(opcode::op_subtract):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_subtract_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_minus>();
         if(!ret)
         {
@@ -1334,6 +1395,10 @@ namespace ok
       }
       case to_utype(opcode::op_multiply):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_multiply_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_asterisk>();
         if(!ret)
         {
@@ -1344,6 +1409,10 @@ namespace ok
       }
       case to_utype(opcode::op_divide):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_divide_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_slash>();
         if(!ret)
         {
@@ -1459,6 +1528,10 @@ namespace ok
       }
       case to_utype(opcode::op_greater):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_greater_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_greater>();
         if(!ret)
         {
@@ -1469,6 +1542,10 @@ namespace ok
       }
       case to_utype(opcode::op_greater_equal):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_greater_equal_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_greater_equal>();
         if(!ret)
         {
@@ -1479,6 +1556,10 @@ namespace ok
       }
       case to_utype(opcode::op_less):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_less_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_less>();
         if(!ret)
         {
@@ -1489,6 +1570,10 @@ namespace ok
       }
       case to_utype(opcode::op_less_equal):
       {
+        if(OK_IS_VALUE_NUMBER(m_stack.top(1)) && OK_IS_VALUE_NUMBER(m_stack.top()))
+        {
+          quicken(opcode::op_less_equal_nn);
+        }
         auto ret = perform_binary_infix<operator_type::op_less_equal>();
         if(!ret)
         {
@@ -1497,6 +1582,402 @@ namespace ok
         frame = &m_call_frames.back();
         break;
       }
+      // quickened instructions, the generic ones above rewrite themselves to these once they see number operands, they
+      // operate on the stack slots in place and rewrite themselves back on the first type miss
+      case to_utype(opcode::op_add_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          OK_VALUE_AS_NUMBER(lhs) += OK_VALUE_AS_NUMBER(rhs);
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_add); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_plus>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_subtract_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          OK_VALUE_AS_NUMBER(lhs) -= OK_VALUE_AS_NUMBER(rhs);
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_subtract); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_minus>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_multiply_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          OK_VALUE_AS_NUMBER(lhs) *= OK_VALUE_AS_NUMBER(rhs);
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_multiply); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_asterisk>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_divide_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs) && OK_VALUE_AS_NUMBER(rhs) != 0) [[likely]]
+        {
+          OK_VALUE_AS_NUMBER(lhs) /= OK_VALUE_AS_NUMBER(rhs);
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_divide); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_slash>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_greater_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto result = OK_VALUE_AS_NUMBER(lhs) > OK_VALUE_AS_NUMBER(rhs);
+          lhs.type = value_type::bool_val;
+          OK_VALUE_AS_BOOL(lhs) = result;
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_greater); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_greater>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_greater_equal_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto result = OK_VALUE_AS_NUMBER(lhs) >= OK_VALUE_AS_NUMBER(rhs);
+          lhs.type = value_type::bool_val;
+          OK_VALUE_AS_BOOL(lhs) = result;
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_greater_equal); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_greater_equal>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_less_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto result = OK_VALUE_AS_NUMBER(lhs) < OK_VALUE_AS_NUMBER(rhs);
+          lhs.type = value_type::bool_val;
+          OK_VALUE_AS_BOOL(lhs) = result;
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_less); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_less>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      case to_utype(opcode::op_less_equal_nn):
+      {
+        auto& lhs = m_stack.top(1);
+        const auto& rhs = m_stack.top();
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto result = OK_VALUE_AS_NUMBER(lhs) <= OK_VALUE_AS_NUMBER(rhs);
+          lhs.type = value_type::bool_val;
+          OK_VALUE_AS_BOOL(lhs) = result;
+          m_stack.pop();
+          break;
+        }
+        quicken(opcode::op_less_equal); // type miss, go back to the generic instruction
+        if(!perform_binary_infix<operator_type::op_less_equal>())
+        {
+          return interpret_result::runtime_error;
+        }
+        frame = &m_call_frames.back();
+        break;
+      }
+      // unchecked instructions, the verifier proved both operands are numbers so the tags are not tested
+      case to_utype(opcode::op_add_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        OK_VALUE_AS_NUMBER(m_stack.top()) += OK_VALUE_AS_NUMBER(rhs);
+        break;
+      }
+      case to_utype(opcode::op_subtract_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        OK_VALUE_AS_NUMBER(m_stack.top()) -= OK_VALUE_AS_NUMBER(rhs);
+        break;
+      }
+      case to_utype(opcode::op_multiply_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        OK_VALUE_AS_NUMBER(m_stack.top()) *= OK_VALUE_AS_NUMBER(rhs);
+        break;
+      }
+      case to_utype(opcode::op_divide_unchecked):
+      {
+        if(OK_VALUE_AS_NUMBER(m_stack.top()) == 0) [[unlikely]]
+        {
+          // still a runtime error, let the generic path report it
+          if(!perform_binary_infix<operator_type::op_slash>())
+          {
+            return interpret_result::runtime_error;
+          }
+          frame = &m_call_frames.back();
+          break;
+        }
+        const auto rhs = m_stack.pop();
+        OK_VALUE_AS_NUMBER(m_stack.top()) /= OK_VALUE_AS_NUMBER(rhs);
+        break;
+      }
+      case to_utype(opcode::op_greater_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        auto& lhs = m_stack.top();
+        lhs = value_t{OK_VALUE_AS_NUMBER(lhs) > OK_VALUE_AS_NUMBER(rhs)};
+        break;
+      }
+      case to_utype(opcode::op_greater_equal_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        auto& lhs = m_stack.top();
+        lhs = value_t{OK_VALUE_AS_NUMBER(lhs) >= OK_VALUE_AS_NUMBER(rhs)};
+        break;
+      }
+      case to_utype(opcode::op_less_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        auto& lhs = m_stack.top();
+        lhs = value_t{OK_VALUE_AS_NUMBER(lhs) < OK_VALUE_AS_NUMBER(rhs)};
+        break;
+      }
+      case to_utype(opcode::op_less_equal_unchecked):
+      {
+        const auto rhs = m_stack.pop();
+        auto& lhs = m_stack.top();
+        lhs = value_t{OK_VALUE_AS_NUMBER(lhs) <= OK_VALUE_AS_NUMBER(rhs)};
+        break;
+      }
+      // superinstructions, ip is at the operand of the op_get_local they replaced and the rest of the original sequence
+      // follows it untouched. the fast path executes the whole sequence at once, otherwise they behave as op_get_local
+      case to_utype(opcode::op_get_local_get_local_add):
+      {
+        // [op_get_local_get_local_add][lhs][op_get_local][rhs][op_add]
+        const auto lhs = m_stack[frame->slots + frame->ip[0]];
+        const auto rhs = m_stack[frame->slots + frame->ip[2]];
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          m_stack.push(value_t{OK_VALUE_AS_NUMBER(lhs) + OK_VALUE_AS_NUMBER(rhs)});
+          frame->ip += 4;
+          break;
+        }
+        m_stack.push(lhs);
+        frame->ip += 1;
+        break;
+      }
+      case to_utype(opcode::op_get_local_constant_less_jump):
+      {
+        // [op_get_local_constant_less_jump][lhs][op_constant][rhs][op_less][op_conditional_jump][jump x3]
+        const auto lhs = m_stack[frame->slots + frame->ip[0]];
+        const auto rhs = frame->closure->function->associated_chunk.constants[frame->ip[2]];
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto jump = decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + 5, 3}, 0);
+          frame->ip += 8;
+          if(!(OK_VALUE_AS_NUMBER(lhs) < OK_VALUE_AS_NUMBER(rhs)))
+          {
+            frame->ip += jump;
+          }
+          break;
+        }
+        m_stack.push(lhs);
+        frame->ip += 1;
+        break;
+      }
+      case to_utype(opcode::op_get_local_constant_add_set_local_pop):
+      {
+        // [op_get_local_constant_add_set_local_pop][lhs][op_constant][rhs][op_add][op_set_local][target][op_pop]
+        const auto lhs = m_stack[frame->slots + frame->ip[0]];
+        const auto rhs = frame->closure->function->associated_chunk.constants[frame->ip[2]];
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          m_stack[frame->slots + frame->ip[5]] = value_t{OK_VALUE_AS_NUMBER(lhs) + OK_VALUE_AS_NUMBER(rhs)};
+          frame->ip += 7;
+          break;
+        }
+        m_stack.push(lhs);
+        frame->ip += 1;
+        break;
+      }
+      case to_utype(opcode::op_add_rr):
+      case to_utype(opcode::op_add_rk):
+      {
+        // [op_add_rr][dst][lhs][rhs][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_add_rk), 1);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          m_stack[frame->slots + frame->ip[0]] = value_t{OK_VALUE_AS_NUMBER(lhs) + OK_VALUE_AS_NUMBER(rhs)};
+          frame->ip += 6;
+          break;
+        }
+        register_miss(lhs, rhs, 6);
+        break;
+      }
+      case to_utype(opcode::op_subtract_rr):
+      case to_utype(opcode::op_subtract_rk):
+      {
+        // [op_subtract_rr][dst][lhs][rhs][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_subtract_rk), 1);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          m_stack[frame->slots + frame->ip[0]] = value_t{OK_VALUE_AS_NUMBER(lhs) - OK_VALUE_AS_NUMBER(rhs)};
+          frame->ip += 6;
+          break;
+        }
+        register_miss(lhs, rhs, 6);
+        break;
+      }
+      case to_utype(opcode::op_multiply_rr):
+      case to_utype(opcode::op_multiply_rk):
+      {
+        // [op_multiply_rr][dst][lhs][rhs][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_multiply_rk), 1);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          m_stack[frame->slots + frame->ip[0]] = value_t{OK_VALUE_AS_NUMBER(lhs) * OK_VALUE_AS_NUMBER(rhs)};
+          frame->ip += 6;
+          break;
+        }
+        register_miss(lhs, rhs, 6);
+        break;
+      }
+      case to_utype(opcode::op_divide_rr):
+      case to_utype(opcode::op_divide_rk):
+      {
+        // [op_divide_rr][dst][lhs][rhs][stub x3], dividing by zero is reported by the stub
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_divide_rk), 1);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs) && OK_VALUE_AS_NUMBER(rhs) != 0) [[likely]]
+        {
+          m_stack[frame->slots + frame->ip[0]] = value_t{OK_VALUE_AS_NUMBER(lhs) / OK_VALUE_AS_NUMBER(rhs)};
+          frame->ip += 6;
+          break;
+        }
+        register_miss(lhs, rhs, 6);
+        break;
+      }
+      case to_utype(opcode::op_greater_rr_jump):
+      case to_utype(opcode::op_greater_rk_jump):
+      {
+        // [op_greater_rr_jump][lhs][rhs][exit x3][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_greater_rk_jump), 0);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto exit = decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + 2, 3}, 0);
+          frame->ip += 8;
+          if(!(OK_VALUE_AS_NUMBER(lhs) > OK_VALUE_AS_NUMBER(rhs)))
+          {
+            frame->ip += exit;
+          }
+          break;
+        }
+        register_miss(lhs, rhs, 8);
+        break;
+      }
+      case to_utype(opcode::op_greater_equal_rr_jump):
+      case to_utype(opcode::op_greater_equal_rk_jump):
+      {
+        // [op_greater_equal_rr_jump][lhs][rhs][exit x3][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_greater_equal_rk_jump), 0);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto exit = decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + 2, 3}, 0);
+          frame->ip += 8;
+          if(!(OK_VALUE_AS_NUMBER(lhs) >= OK_VALUE_AS_NUMBER(rhs)))
+          {
+            frame->ip += exit;
+          }
+          break;
+        }
+        register_miss(lhs, rhs, 8);
+        break;
+      }
+      case to_utype(opcode::op_less_rr_jump):
+      case to_utype(opcode::op_less_rk_jump):
+      {
+        // [op_less_rr_jump][lhs][rhs][exit x3][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_less_rk_jump), 0);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto exit = decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + 2, 3}, 0);
+          frame->ip += 8;
+          if(!(OK_VALUE_AS_NUMBER(lhs) < OK_VALUE_AS_NUMBER(rhs)))
+          {
+            frame->ip += exit;
+          }
+          break;
+        }
+        register_miss(lhs, rhs, 8);
+        break;
+      }
+      case to_utype(opcode::op_less_equal_rr_jump):
+      case to_utype(opcode::op_less_equal_rk_jump):
+      {
+        // [op_less_equal_rr_jump][lhs][rhs][exit x3][stub x3]
+        const auto [lhs, rhs] = register_operands(instruction == to_utype(opcode::op_less_equal_rk_jump), 0);
+        if(OK_IS_VALUE_NUMBER(lhs) && OK_IS_VALUE_NUMBER(rhs)) [[likely]]
+        {
+          const auto exit = decode_int<uint32_t, 3>(std::span<const byte>{frame->ip + 2, 3}, 0);
+          frame->ip += 8;
+          if(!(OK_VALUE_AS_NUMBER(lhs) <= OK_VALUE_AS_NUMBER(rhs)))
+          {
+            frame->ip += exit;
+          }
+          break;
+        }
+        register_miss(lhs, rhs, 8);
+        break;
+      }
       case to_utype(opcode::op_add_assign):
       {
         auto ret = perform_binary_infix<operator_type::op_plus_equal>();
@@ -1768,6 +2249,14 @@ namespace ok
       {
         auto loop = decode_int<uint32_t, 3>(read_bytes<3>(), 0);
         frame->ip -= loop;
+        if(frame->closure->function->jitted != nullptr)
+        {
+          enter_jit(*frame);
+        }
+        else if(m_compile_options.trace_threshold != 0)
+        {
+          back_edge(*frame);
+        }
         break;
       }
       case to_utype(opcode::op_call):
@@ -1778,6 +2267,10 @@ namespace ok
         if(!res)
           return interpret_result::runtime_error;
         frame = &m_call_frames.back();
+        if(m_compile_options.jit_threshold != 0 || frame->closure->function->jitted != nullptr)
+        {
+          enter_jit(*frame);
+        }
         break;
       }
       case to_utype(opcode::op_closure):
@@ -1960,6 +2453,10 @@ namespace ok
           return interpret_result::runtime_error;
         }
         frame = &m_call_frames.back();
+        if(m_compile_options.jit_threshold != 0 || frame->closure->function->jitted != nullptr)
+        {
+          enter_jit(*frame);
+        }
         break;
       }
       case to_utype(opcode::op_inherit):
@@ -2088,6 +2585,57 @@ namespace ok
     return frame->closure->function->associated_chunk.identifiers[index];
   }
 
+  void vm::enter_jit(call_frame& p_frame)
+  {
+    auto* function = p_frame.closure->function;
+    auto& chunk = function->associated_chunk;
+    if(function->jitted == nullptr)
+    {
+      // only fresh calls count
+      const auto threshold = m_compile_options.jit_threshold;
+      if(p_frame.ip != chunk.code.data() || function->calls > threshold || ++function->calls < threshold)
+        return;
+      ++function->calls;
+      function->jitted = jit::compile(chunk);
+      if(function->jitted == nullptr)
+        return;
+    }
+    value_t* top = nullptr;
+    const auto offset = function->jitted->run(m_stack.value_ptr(p_frame.slots),
+                                              m_stack.value_ptr(m_stack.size()),
+                                              chunk.constants.data(),
+                                              &top,
+                                              p_frame.ip - chunk.code.data(),
+                                              m_stack.value_ptr(m_stack.capacity() - 1));
+    m_stack.resize(top - m_stack.value_ptr());
+    p_frame.ip = chunk.code.data() + offset;
+  }
+
+  void vm::back_edge(call_frame& p_frame)
+  {
+    if(m_recorder.recording())
+      return;
+    auto* function = p_frame.closure->function;
+    if(function->traces == nullptr)
+      function->traces = new trace_cache{};
+    auto& traces = *function->traces;
+    const auto header = static_cast<uint32_t>(p_frame.ip - function->associated_chunk.code.data());
+    if(const auto found = traces.traces.find(header); found != traces.traces.end())
+    {
+      trace_context context{.slots = m_stack.value_ptr(p_frame.slots),
+                            .top = m_stack.value_ptr(m_stack.size()),
+                            .limit = m_stack.value_ptr(m_stack.capacity() - 1)};
+      const auto offset = found->second.run(context);
+      m_stack.resize(context.top - m_stack.value_ptr());
+      p_frame.ip = function->associated_chunk.code.data() + offset;
+      return;
+    }
+    auto& counter = traces.counters[header];
+    if(counter == trace_cache::blacklisted || ++counter < m_compile_options.trace_threshold)
+      return;
+    m_recorder.start(&traces, m_call_frames.size(), header);
+  }
+
   bool vm::call_value(value_t p_callee, value_t p_this, uint8_t p_argc)
   {
     TRACELN("call value: argc: {}, callee: {}", p_argc, (uint32_t)p_callee.type);
@@ -2224,6 +2772,7 @@ namespace ok
     auto method = m_stack.top();
     auto class_ = OK_VALUE_AS_CLASS_OBJECT(m_stack.top(1));
     class_->specials.operations[p_mt] = method;
+    m_user_operators |= p_mt != method_type::mt_ctor && p_mt != method_type::mt_dtor;
     m_stack.pop();
   }
 
@@ -2232,6 +2781,7 @@ namespace ok
     auto convertee = m_stack.top();
     auto method = m_stack.top(1);
     auto class_ = OK_VALUE_AS_CLASS_OBJECT(m_stack.top(2));
+    m_user_operators = true;
 
     if(!(OK_IS_VALUE_OBJECT(convertee) && OK_VALUE_AS_OBJECT(convertee)->is_class()))
     {
@@ -2258,9 +2808,15 @@ namespace ok
       return false;
     }
 
-    auto bound = new_object<bound_method_object>(
-        m_stack.top(), it->second, get_builtin_class(object_type::obj_bound_method), get_objects_list());
-    m_stack.top() = value_t{copy{bound}};
+    // receiver is always an instance here (property access and super are only valid on instances)
+    auto instance = OK_VALUE_AS_INSTANCE_OBJECT(m_stack.top());
+    auto& cached = instance->bound_methods[it->second.as.pointer];
+    if(cached == nullptr)
+    {
+      cached = new_tobject<bound_method_object>(
+          m_stack.top(), it->second, get_builtin_class(object_type::obj_bound_method), get_objects_list());
+    }
+    m_stack.top() = value_t{copy{cached}};
     return true;
   }
 
@@ -2326,11 +2882,14 @@ namespace ok
   // i cant believe i did this
   std::expected<bool, bool> vm::set_if()
   {
-    auto fcn = (compiler::compare_function)decode_int<uint64_t, 8>(read_bytes<8>(), 0);
-    if(fcn == nullptr)
+    // the index of the compare plus one, see compiler::set_if_compare_functions
+    const auto index = decode_int<uint64_t, 8>(read_bytes<8>(), 0);
+    const auto functions = compiler::set_if_compare_functions();
+    if(index == 0 || index > functions.size())
     {
       return std::unexpected(false);
     }
+    auto fcn = functions[index - 1];
     if(fcn(m_stack.top()))
     {
       return true;
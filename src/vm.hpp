@@ -120,6 +120,11 @@ namespace ok
       return m_top;
     }
 
+    size_t capacity() const
+    {
+      return m_storeage.size();
+    }
+
     bool empty() const
     {
       return m_top == 0 || m_storeage.empty();
@@ -188,6 +193,24 @@ namespace ok
     vm();
     ~vm();
     interpret_result interpret(const std::string_view p_filename, const std::string_view p_source);
+    // compiles the top level script function without running it, returns nullptr on parse or compile errors
+    function_object* compile(const std::string_view p_filename, const std::string_view p_source);
+    // runs a script function from compile or one read back from an image
+    interpret_result execute(function_object* p_script);
+    // compiles a function body compile left for its first call, see compiler::compile_lazy. shows the errors if any
+    bool compile_lazy(function_object* p_function);
+
+    inline void set_compile_options(const compiler::options& p_options)
+    {
+      m_compile_options = p_options;
+    }
+
+    // a class with operator, print or conversion overloads has been defined, the compiler can no longer assume those
+    // never run user code
+    inline bool has_user_operators() const
+    {
+      return m_user_operators;
+    }
 
     inline object*& get_objects_list()
     {
@@ -360,6 +383,19 @@ namespace ok
     value_t& read_local(bool is_long);
     byte read_byte();
 
+    // runs the frame's function as machine code from its ip when the jit has it, a fresh call counts towards
+    // compiler::options::jit_threshold. the interpreter picks up where the machine code leaves off
+    void enter_jit(call_frame& p_frame);
+    // a loop back edge to the frame's ip. runs the loop's trace when it has one, otherwise counts towards
+    // compiler::options::trace_threshold and starts recording the loop once it is crossed
+    void back_edge(call_frame& p_frame);
+
+    // rewrites the instruction that was just read in place, used to (de)quicken instructions
+    inline void quicken(opcode p_op)
+    {
+      *(m_call_frames.back().ip - 1) = to_utype(p_op);
+    }
+
     template <size_t N>
     std::array<byte, N> read_bytes()
     {
@@ -447,10 +483,13 @@ namespace ok
     // maybe do it when adding optimization pass
     std::unordered_map<string_object*, global_entry> m_globals;
 
-    std::array<object*, 10> m_builtins;
+    std::array<object*, object_type::obj_last> m_builtins;
     // value_operations m_value_operations;
     logger m_logger;
     compiler m_compiler; // temporary
+    compiler::options m_compile_options;
+    trace_recorder m_recorder;
+    bool m_user_operators = false;
     statics m_statics;
     constexpr static size_t s_call_frame_max_size = 64;
     constexpr static size_t s_stack_base_size = (UINT8_MAX + 1) * s_call_frame_max_size;